@@ -101,6 +101,12 @@ PIDX_variable variable;
 char type_name[512];
 static PIDX_point global_bounds;
 unsigned char *data;
+static int point_query = 0;
+static int restart_read = 0;
+static double tolerance = 0;
+static int read_precision = 0;
+static int serial_read_threads = 0;
+static PIDX_block_cache block_cache = NULL;
 
 static char *usage = "Serial Usage: ./idx_read -g 32x32x32 -l 32x32x32 -v 0 -f input_idx_file_name\n"
                      "Parallel Usage: mpirun -n 8 ./idx_read -g 32x32x32 -l 16x16x16 -f -v 0 input_idx_file_name\n"
@@ -108,12 +114,19 @@ static char *usage = "Serial Usage: ./idx_read -g 32x32x32 -l 32x32x32 -v 0 -f i
                      "  -l: local (per-process) dimensions\n"
                      "  -f: IDX input filename\n"
                      "  -t: time step index to read\n"
-                     "  -v: variable index to read";
+                     "  -v: variable index to read\n"
+                     "  -q: read the local domain as a batch of points (PIDX_read_points)\n"
+                     "  -r: read with the N-to-M restart path (PIDX_set_restart_read)\n"
+                     "  -e: largest error accepted on float values (lossy compression)\n"
+                     "  -s: most significant bytes read of every value (PIDX_set_read_precision)\n"
+                     "  -m: open with PIDX_serial_file_open and read with this many threads, twice (the second read hits the block cache)";
 
 static void parse_args(int argc, char **argv);
 static void set_pidx_variable_and_create_buffer();
 static int verify_read_results();
+static int matches(double value, double expected);
 static void set_pidx_file(int ts);
+static void read_points();
 
 
 int main(int argc, char **argv)
@@ -142,18 +155,36 @@ int main(int argc, char **argv)
   set_pidx_variable_and_create_buffer();
 
   // Read the data into a local buffer (data) in row major order
-  PIDX_variable_read_data_layout(variable, local_offset, local_size, data, PIDX_row_major);
+  if (point_query)
+    read_points();
+  else
+    PIDX_variable_read_data_layout(variable, local_offset, local_size, data, PIDX_row_major);
 
   // PIDX_close triggers the actual write on the disk
   // of the variables that we just set
   PIDX_close(file);
 
+  // Compare the data that we just against the syntethic data
+  int ret = verify_read_results();
+
+  // Open and read the box again, the binary file headers and the blocks now come from the block cache
+  if (serial_read_threads > 0)
+  {
+    free(data);
+    set_pidx_file(current_ts);
+    set_pidx_variable_and_create_buffer();
+    PIDX_variable_read_data_layout(variable, local_offset, local_size, data, PIDX_row_major);
+    PIDX_close(file);
+
+    if (verify_read_results() != 0)
+      ret = 1;
+
+    PIDX_free_block_cache(block_cache);
+  }
+
   // Close PIDX_access
   PIDX_close_access(p_access);
 
-  // Compare the data that we just against the syntethic data
-  int ret = verify_read_results();
-  
   free(data);
   shutdown_mpi();
   
@@ -162,7 +193,7 @@ int main(int argc, char **argv)
 
 static void parse_args(int argc, char **argv)
 {
-  char flags[] = "g:l:f:t:v:";
+  char flags[] = "g:l:f:t:v:qre:s:m:";
   int one_opt = 0;
   char input_file_template[512];
 
@@ -199,6 +230,29 @@ static void parse_args(int argc, char **argv)
         terminate_with_error_msg("Invalid variable file\n%s", usage);
       break;
 
+    case('q'): // point query
+      point_query = 1;
+      break;
+
+    case('r'): // restart read
+      restart_read = 1;
+      break;
+
+    case('e'): // error tolerance
+      if (sscanf(optarg, "%lf", &tolerance) < 0 || tolerance < 0)
+        terminate_with_error_msg("Invalid tolerance\n%s", usage);
+      break;
+
+    case('s'): // read precision
+      if (sscanf(optarg, "%d", &read_precision) < 0 || read_precision < 0)
+        terminate_with_error_msg("Invalid read precision\n%s", usage);
+      break;
+
+    case('m'): // serial read threads
+      if (sscanf(optarg, "%d", &serial_read_threads) < 0 || serial_read_threads < 0)
+        terminate_with_error_msg("Invalid thread count\n%s", usage);
+      break;
+
     default:
       terminate_with_error_msg("Wrong arguments\n%s", usage);
     }
@@ -257,14 +311,39 @@ static void set_pidx_file(int ts)
 {
   PIDX_return_code ret;
 
-  // Open IDX file
-  ret = PIDX_file_open(input_file_name, PIDX_MODE_RDONLY, p_access, global_bounds, &file);
-  if (ret != PIDX_success)  terminate_with_error_msg("PIDX_file_open\n");
+  // Open IDX file, every process reads its own box without communicating in serial mode
+  if (serial_read_threads > 0)
+  {
+    ret = PIDX_serial_file_open(input_file_name, PIDX_MODE_RDONLY, global_bounds, &file);
+    if (ret != PIDX_success)  terminate_with_error_msg("PIDX_serial_file_open\n");
+
+    PIDX_set_read_thread_count(file, serial_read_threads);
+
+    // large enough for the whole box, so that the second read never goes to disk
+    if (block_cache == NULL)
+    {
+      ret = PIDX_create_block_cache(64 * 1024 * 1024, &block_cache);
+      if (ret != PIDX_success)  terminate_with_error_msg("PIDX_create_block_cache\n");
+    }
+    PIDX_set_block_cache(file, block_cache);
+  }
+  else
+  {
+    ret = PIDX_file_open(input_file_name, PIDX_MODE_RDONLY, p_access, global_bounds, &file);
+    if (ret != PIDX_success)  terminate_with_error_msg("PIDX_file_open\n");
+  }
 
   PIDX_query_box(file, global_size);
 
   // Set the current timestep
   PIDX_set_current_time_step(file, ts);
+
+  if (restart_read)
+    PIDX_set_restart_read(file, 1);
+
+  if (read_precision > 0)
+    PIDX_set_read_precision(file, read_precision);
+
   // Get the total number of variables
   PIDX_get_variable_count(file, &variable_count);
 }
@@ -294,6 +373,44 @@ static void set_pidx_variable_and_create_buffer()
   memset(data, 0, (bits_per_sample/8) * local_box_size[0] * local_box_size[1] * local_box_size[2]  * values_per_sample);
 }
 
+//----------------------------------------------------------------
+static void read_points()
+{
+  uint64_t point_count = local_box_size[0] * local_box_size[1] * local_box_size[2];
+  int sample_bytes = (bits_per_sample/8) * values_per_sample;
+
+  PIDX_point* points = malloc(sizeof(*points) * point_count);
+  memset(points, 0, sizeof(*points) * point_count);
+  unsigned char* values = malloc(sample_bytes * point_count);
+  memset(values, 0, sample_bytes * point_count);
+
+  // the points are requested last sample first, so that they are not in HZ order
+  uint64_t i, j, k;
+  for (k = 0; k < local_box_size[2]; k++)
+    for (j = 0; j < local_box_size[1]; j++)
+      for (i = 0; i < local_box_size[0]; i++)
+      {
+        uint64_t index = (uint64_t) (local_box_size[0] * local_box_size[1] * k) + (local_box_size[0] * j) + i;
+        PIDX_set_point(points[point_count - 1 - index], local_box_offset[0] + i, local_box_offset[1] + j, local_box_offset[2] + k);
+      }
+
+  if (PIDX_read_points(file, variable, point_count, points, values) != PIDX_success)
+    terminate_with_error_msg("PIDX_read_points\n");
+
+  uint64_t p;
+  for (p = 0; p < point_count; p++)
+    memcpy(data + (point_count - 1 - p) * sample_bytes, values + p * sample_bytes, sample_bytes);
+
+  free(values);
+  free(points);
+}
+
+//----------------------------------------------------------------
+static int matches(double value, double expected)
+{
+  return (value > expected) ? (value - expected <= tolerance) : (expected - value <= tolerance);
+}
+
 //----------------------------------------------------------------
 static int verify_read_results()
 {
@@ -339,7 +456,7 @@ static int verify_read_results()
           for (vps = 0; vps < values_per_sample; vps++)
           {
             memcpy(&double_val, data + (index * values_per_sample + vps) * bits_per_sample, bits_per_sample);
-            if (double_val != var + 100 + vps + ((global_bounds[0] * global_bounds[1]*(local_box_offset[2] + k))+(global_bounds[0]*(local_box_offset[1] + j)) + (local_box_offset[0] + i)))
+            if (!matches(double_val, var + 100 + vps + ((global_bounds[0] * global_bounds[1]*(local_box_offset[2] + k))+(global_bounds[0]*(local_box_offset[1] + j)) + (local_box_offset[0] + i))))
             {
               read_error_count++;
               //if (rank == 0)
@@ -359,7 +476,7 @@ static int verify_read_results()
           for (vps = 0; vps < values_per_sample; vps++)
           {
             memcpy(&float_val, data + (index * values_per_sample + vps) * bits_per_sample, bits_per_sample);
-            if (float_val != var + 100 + vps + ((global_bounds[0] * global_bounds[1]*(local_box_offset[2] + k))+(global_bounds[0]*(local_box_offset[1] + j)) + (local_box_offset[0] + i)))
+            if (!matches(float_val, var + 100 + vps + ((global_bounds[0] * global_bounds[1]*(local_box_offset[2] + k))+(global_bounds[0]*(local_box_offset[1] + j)) + (local_box_offset[0] + i))))
             {
               read_error_count++;
 //              if (rank == 1)
@@ -107,7 +107,13 @@ char *usage = "Serial Usage: ./idx_write -g 32x32x32 -l 32x32x32 -v 2 -t 4 -f ou
                      "  -r: restructured box dimension\n"
                      "  -f: file name template (without .idx)\n"
                      "  -t: number of timesteps\n"
-                     "  -v: number of variables (or file containing a list of variables)\n";
+                     "  -v: number of variables (or file containing a list of variables)\n"
+                     "  -c: compression type (PIDX_CHUNKING_ZFP by default)\n"
+                     "  -b: ZFP bit rate (bits of a value by default)\n"
+                     "  -a: ZFP tolerance, fixed accuracy mode instead of fixed rate\n"
+                     "  -p: ZFP precision, fixed precision mode instead of fixed rate\n"
+                     "  -m: compression type of the odd variables (block compression types only)\n"
+                     "  -n: ZFP bit rate of the odd variables\n";
 
 static int generate_vars();
 static void parse_args(int argc, char **argv);
@@ -117,6 +123,11 @@ static void set_pidx_variable(int var);
 static void set_pidx_file(int ts);
 static void destroy_synthetic_simulation_data();
 static uint32_t bit_rate = 0;
+static int compression_type = PIDX_CHUNKING_ZFP;
+static double tolerance = 0;
+static int precision = 0;
+static int odd_compression_type = -1;
+static uint32_t odd_bit_rate = 0;
 
 int main(int argc, char **argv)
 {
@@ -179,7 +190,7 @@ int main(int argc, char **argv)
 //----------------------------------------------------------------
 static void parse_args(int argc, char **argv)
 {
-  char flags[] = "g:l:f:t:v:b:";
+  char flags[] = "g:l:f:t:v:b:c:a:p:m:n:";
   int one_opt = 0;
 
   while ((one_opt = getopt(argc, argv, flags)) != EOF)
@@ -227,6 +238,31 @@ static void parse_args(int argc, char **argv)
         terminate_with_error_msg("Invalid bit rate\n%s", usage);
       break;
 
+    case('c'): // compression type
+      if (sscanf(optarg, "%d", &compression_type) < 0)
+        terminate_with_error_msg("Invalid compression type\n%s", usage);
+      break;
+
+    case('a'): // compression tolerance
+      if (sscanf(optarg, "%lf", &tolerance) < 0)
+        terminate_with_error_msg("Invalid tolerance\n%s", usage);
+      break;
+
+    case('p'): // compression precision
+      if (sscanf(optarg, "%d", &precision) < 0)
+        terminate_with_error_msg("Invalid precision\n%s", usage);
+      break;
+
+    case('m'): // compression type of the odd variables
+      if (sscanf(optarg, "%d", &odd_compression_type) < 0)
+        terminate_with_error_msg("Invalid compression type\n%s", usage);
+      break;
+
+    case('n'): // compression bit rate of the odd variables
+      if (sscanf(optarg, "%d", &odd_bit_rate) < 0)
+        terminate_with_error_msg("Invalid bit rate\n%s", usage);
+      break;
+
     default:
       terminate_with_error_msg("Wrong arguments\n%s", usage);
     }
@@ -253,7 +289,26 @@ static void set_pidx_variable(int var)
   if(!bit_rate)
     bit_rate = bpv[0];
 
-  PIDX_set_lossy_compression_bit_rate(file, variable[var], bit_rate);
+  if (tolerance > 0)
+    ret = PIDX_set_lossy_compression_tolerance(file, variable[var], tolerance);
+  else if (precision > 0)
+    ret = PIDX_set_lossy_compression_precision(file, variable[var], precision);
+  else
+    ret = PIDX_set_lossy_compression_bit_rate(file, variable[var], bit_rate);
+  if (ret != PIDX_success)  terminate_with_error_msg("PIDX_set_lossy_compression\n");
+
+  // the odd variables can be stored with their own codec and rate
+  if (var % 2 == 1 && odd_compression_type >= 0)
+  {
+    ret = PIDX_set_variable_compression_type(file, variable[var], odd_compression_type);
+    if (ret != PIDX_success)  terminate_with_error_msg("PIDX_set_variable_compression_type\n");
+  }
+
+  if (var % 2 == 1 && odd_bit_rate > 0)
+  {
+    ret = PIDX_set_lossy_compression_bit_rate(file, variable[var], odd_bit_rate);
+    if (ret != PIDX_success)  terminate_with_error_msg("PIDX_set_lossy_compression_bit_rate\n");
+  }
 
   return;
 }
@@ -478,7 +533,7 @@ static void set_pidx_file(int ts)
   // we can instruct PIDX to cache and reuse these information for the next timesteps
   PIDX_set_cache_time_step(file, 0);
 
-  PIDX_set_compression_type(file, PIDX_CHUNKING_ZFP);
+  PIDX_set_compression_type(file, compression_type);
 
   return;
 }
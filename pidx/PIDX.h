@@ -449,6 +449,9 @@ PIDX_return_code PIDX_get_last_time_step(PIDX_file file, int* tstep);
 
 ///
 /// \brief PIDX_set_compression_type
+/// PIDX_CHUNKING_ZFP_BLOCK, PIDX_ZFP_BLOCK and PIDX_LOSSLESS_BLOCK compress every IDX block on its own at the aggregators,
+/// PIDX_LOSSLESS_BLOCK keeps the data exact (integer masks, material ids, checkpoints).
+/// PIDX_PRECISION_BLOCK stores the bytes of the values by significance, so that reads can fetch a coarse precision.
 /// \param file
 /// \param compression_type
 /// \return
@@ -467,10 +470,35 @@ PIDX_return_code PIDX_get_compression_type(PIDX_file file, int *compression_type
 
 
 
+///
+/// \brief PIDX_set_variable_compression_type Compresses one variable of a block compressed file with its own codec.
+/// It takes PIDX_NO_COMPRESSION, PIDX_LOSSLESS_BLOCK, PIDX_PRECISION_BLOCK or the ZFP type of the file (PIDX_CHUNKING_ZFP_BLOCK or PIDX_ZFP_BLOCK),
+/// the rate, tolerance and precision setters given the variable then only change that variable.
+/// \param file
+/// \param var
+/// \param compression_type
+/// \return
+///
+PIDX_return_code PIDX_set_variable_compression_type(PIDX_file file, PIDX_variable var, int compression_type);
+
+
+
+///
+/// \brief PIDX_get_variable_compression_type
+/// \param file
+/// \param var
+/// \param compression_type
+/// \return
+///
+PIDX_return_code PIDX_get_variable_compression_type(PIDX_file file, PIDX_variable var, int *compression_type);
+
+
+
 
 
 ///
 /// \brief PIDX_set_lossy_compression_bit_rate
+/// With block compression the rate is the one of var, it is file wide when var is NULL.
 /// \param file
 /// \param var
 /// \param compression_bit_rate
@@ -500,6 +528,32 @@ PIDX_return_code PIDX_get_lossy_compression_bit_rate(PIDX_file file, int *compre
 
 
 
+///
+/// \brief PIDX_set_lossy_compression_tolerance ZFP fixed accuracy mode, every value is within tolerance of the original.
+/// Blocks get a variable size, so it needs the PIDX_CHUNKING_ZFP_BLOCK or PIDX_ZFP_BLOCK compression type.
+/// Only var is changed, all the variables are when var is NULL.
+/// \param file
+/// \param var
+/// \param tolerance absolute error bound
+/// \return
+///
+PIDX_return_code PIDX_set_lossy_compression_tolerance(PIDX_file file, PIDX_variable var, double tolerance);
+
+
+
+///
+/// \brief PIDX_set_lossy_compression_precision ZFP fixed precision mode, keeps precision uncompressed bit planes.
+/// Blocks get a variable size, so it needs the PIDX_CHUNKING_ZFP_BLOCK or PIDX_ZFP_BLOCK compression type.
+/// Only var is changed, all the variables are when var is NULL.
+/// \param file
+/// \param var
+/// \param precision number of bit planes
+/// \return
+///
+PIDX_return_code PIDX_set_lossy_compression_precision(PIDX_file file, PIDX_variable var, int precision);
+
+
+
 ///
 /// \brief PIDX_set_io_mode
 /// \param file
@@ -520,6 +574,140 @@ PIDX_return_code PIDX_get_io_mode(PIDX_file file, enum PIDX_io_type* io_type);
 
 
 
+///
+/// \brief PIDX_set_restart_read Reads PIDX_IDX_IO data without the restructuring and aggregation
+/// phases. Meant for restarts on a different number of processes: the blocks needed by every
+/// process are read once and redistributed with a single all-to-all. Uncompressed data only,
+/// compressed data falls back to the regular read.
+/// \param file
+/// \param enable 1 to enable, 0 to disable
+/// \return
+///
+PIDX_return_code PIDX_set_restart_read(PIDX_file file, int enable);
+
+
+
+///
+/// \brief PIDX_get_restart_read
+/// \param file
+/// \param enable
+/// \return
+///
+PIDX_return_code PIDX_get_restart_read(PIDX_file file, int* enable);
+
+
+
+///
+/// \brief PIDX_set_read_thread_count Number of threads used to read a file opened with
+/// PIDX_serial_file_open. Blocks are read with pread and scattered into the patches in parallel.
+/// \param file
+/// \param thread_count 0 (default) uses one thread per core
+/// \return
+///
+PIDX_return_code PIDX_set_read_thread_count(PIDX_file file, int thread_count);
+
+
+
+///
+/// \brief PIDX_get_read_thread_count
+/// \param file
+/// \param thread_count
+/// \return
+///
+PIDX_return_code PIDX_get_read_thread_count(PIDX_file file, int* thread_count);
+
+
+
+///
+/// \brief PIDX_set_read_precision Number of most significant bytes of every value read from blocks
+/// stored with PIDX_PRECISION_BLOCK, the lower bytes are not read and come back as zeros.
+/// Together with the HZ level of a query it picks both the resolution and the precision of a read,
+/// e.g. 2 reads float32 values with their sign, exponent and the 7 high bits of the mantissa.
+/// \param file
+/// \param bytes 0 (default) reads the full values
+/// \return
+///
+PIDX_return_code PIDX_set_read_precision(PIDX_file file, int bytes);
+
+
+
+///
+/// \brief PIDX_get_read_precision
+/// \param file
+/// \param bytes
+/// \return
+///
+PIDX_return_code PIDX_get_read_precision(PIDX_file file, int* bytes);
+
+
+
+///
+/// \brief PIDX_set_compression_thread_count Number of threads each process uses to run ZFP.
+/// Fixed rate chunks are split among the threads, with block compression the blocks are.
+/// \param file
+/// \param thread_count 0 (default) and 1 compress on the calling thread
+/// \return
+///
+PIDX_return_code PIDX_set_compression_thread_count(PIDX_file file, int thread_count);
+
+
+
+///
+/// \brief PIDX_get_compression_thread_count
+/// \param file
+/// \param thread_count
+/// \return
+///
+PIDX_return_code PIDX_get_compression_thread_count(PIDX_file file, int* thread_count);
+
+
+
+///
+/// \brief PIDX_set_sparse_rst_meta_data Builds the restructuring meta data without gathering the
+/// extents of every patch on every process. Each patch is sent only to the owners of the
+/// restructured boxes it intersects (non-blocking consensus with MPI-3, all-to-all otherwise).
+/// Meant for runs with a large number of processes.
+/// \param file
+/// \param enable 1 to enable, 0 to disable (default)
+/// \return
+///
+PIDX_return_code PIDX_set_sparse_rst_meta_data(PIDX_file file, int enable);
+
+
+
+///
+/// \brief PIDX_get_sparse_rst_meta_data
+/// \param file
+/// \param enable
+/// \return
+///
+PIDX_return_code PIDX_get_sparse_rst_meta_data(PIDX_file file, int* enable);
+
+
+
+///
+/// \brief PIDX_set_restructuring_overlap Posts the restructuring messages of all the variables at
+/// once and copies every patch into its super patch as soon as it arrives (MPI_Waitsome), instead
+/// of waiting for all the messages of a variable and copying afterwards. Only these copies overlap
+/// the messages, chunking and HZ encoding run after the restructuring as without overlap.
+/// \param file
+/// \param enable 1 to enable, 0 to disable (default)
+/// \return
+///
+PIDX_return_code PIDX_set_restructuring_overlap(PIDX_file file, int enable);
+
+
+
+///
+/// \brief PIDX_get_restructuring_overlap
+/// \param file
+/// \param enable
+/// \return
+///
+PIDX_return_code PIDX_get_restructuring_overlap(PIDX_file file, int* enable);
+
+
+
 #if 0
 ///
 /// \brief PIDX_set_wavelet_level
@@ -864,6 +1052,24 @@ PIDX_return_code PIDX_read_variable(PIDX_file file, PIDX_variable variable, PIDX
 PIDX_return_code PIDX_write_variable(PIDX_file file, PIDX_variable variable, PIDX_point offset, PIDX_point dims, const void* src_buffer, PIDX_data_layout layout);
 
 
+/*
+ * Implementation in PIDX_point_query.c
+ */
+///
+/// \brief PIDX_read_points Reads the values of a variable at a batch of scattered sample locations
+/// for the current time step. Every idx block that contains a requested point is read only once.
+/// When the file is opened by more than one process the call is collective, the points are
+/// exchanged so that every binary file is read by exactly one process.
+/// \param file
+/// \param variable
+/// \param point_count Number of points requested by this process
+/// \param points Global (x, y, z) index of every point
+/// \param values Output buffer of point_count samples (vps * bpv/8 bytes each), in the order of points
+/// \return PIDX_err_point if a point is outside the bounds of the dataset
+///
+PIDX_return_code PIDX_read_points(PIDX_file file, PIDX_variable variable, uint64_t point_count, PIDX_point* points, void* values);
+
+
 /*
  * Implementation in PIDX_meta_data.c
  */
@@ -888,6 +1094,54 @@ PIDX_return_code PIDX_get_meta_data_cache(PIDX_file file, PIDX_metadata_cache* c
 
 
 
+///
+/// \brief PIDX_set_block_cache Attaches a block cache (created with PIDX_create_block_cache) to the file.
+/// Reads then look up binary file headers and idx blocks in the cache before going to disk: the serial reader
+/// (PIDX_serial_file_open, used by the viewer and VisIt plugins), the partitioned local read, the restart read
+/// and PIDX_read_points. The parallel aggregated read only uses it to pick up prefetched time steps.
+/// Writing a dataset evicts its entries. The cache is owned by the caller, it can be shared across files and
+/// must outlive them. Pass NULL to disable.
+/// \param file
+/// \param cache
+/// \return
+///
+PIDX_return_code PIDX_set_block_cache(PIDX_file file, PIDX_block_cache cache);
+
+
+
+///
+/// \brief PIDX_get_block_cache
+/// \param file
+/// \param cache
+/// \return
+///
+PIDX_return_code PIDX_get_block_cache(PIDX_file file, PIDX_block_cache* cache);
+
+
+
+///
+/// \brief PIDX_set_time_step_prefetch Enables prefetching for loops reading the same box over time steps.
+/// Once two consecutive flushes show the same time step stride, the blocks read at a time step are read at
+/// the next one by thread_count background threads into the block cache (PIDX_set_block_cache is required),
+/// so the following PIDX_flush is served from memory. Pass 0 to disable.
+/// \param file
+/// \param thread_count
+/// \return
+///
+PIDX_return_code PIDX_set_time_step_prefetch(PIDX_file file, int thread_count);
+
+
+
+///
+/// \brief PIDX_get_time_step_prefetch
+/// \param file
+/// \param thread_count 0 when prefetching is disabled
+/// \return
+///
+PIDX_return_code PIDX_get_time_step_prefetch(PIDX_file file, int* thread_count);
+
+
+
 
 ///
 /// Gets the number of boxes.
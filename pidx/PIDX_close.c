@@ -58,7 +58,26 @@ PIDX_return_code PIDX_flush(PIDX_file file)
     return PIDX_err_variable;
   }
 
-  file->io = PIDX_io_init(file->idx, file->idx_c, file->idx_dbg, file->meta_data_cache, file->idx_b, file->restructured_grid, file->time, file->fs_block_size, file->variable_index_tracker);
+  // a variable selected only to be queried with PIDX_read_points has no patch for the flush to read,
+  // PIDX_read_points is collective so every process sees the same points_read
+  if (file->flags == PIDX_MODE_RDONLY && file->points_read == 1)
+  {
+    file->points_read = 0;
+
+    int patch_count = 0, global_patch_count = 0;
+    for (int j = file->local_variable_index; j < file->local_variable_index + file->local_variable_count; j++)
+      patch_count = patch_count + file->idx->variable[j]->sim_patch_count;
+
+    MPI_Allreduce(&patch_count, &global_patch_count, 1, MPI_INT, MPI_MAX, file->idx_c->simulation_comm);
+    if (global_patch_count == 0)
+    {
+      file->local_variable_index = file->variable_index_tracker;
+      file->local_variable_count = 0;
+      return PIDX_success;
+    }
+  }
+
+  file->io = PIDX_io_init(file->idx, file->idx_c, file->idx_dbg, file->meta_data_cache, file->block_cache, file->prefetch, file->idx_b, file->restructured_grid, file->time, file->fs_block_size, file->variable_index_tracker);
   if (file->io == NULL)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
@@ -86,19 +105,32 @@ PIDX_return_code PIDX_flush(PIDX_file file)
       fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
       return PIDX_err_io;
     }
+
+    // blocks cached before the write are stale now
+    if (file->block_cache != NULL)
+      PIDX_block_cache_drop_dataset(file->block_cache, file->idx->filename);
   }
 
   else if (file->flags == PIDX_MODE_RDONLY)
   {
+    if (file->prefetch != NULL)
+      PIDX_time_step_prefetch_begin(file->prefetch, file->idx->current_time_step);
+
     if (PIDX_read(file->io, lvi, (lvi + lvc), file->idx->io_type) != PIDX_success)
     {
       fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
       return PIDX_err_io;
     }
+
+    // overlaps the reads of the next time step with the computation of the caller
+    if (file->prefetch != NULL)
+      PIDX_time_step_prefetch_launch(file->prefetch, file->idx, file->block_cache);
   }
 
-  // Output to stderr the timmings of all the io phases
-  PIDX_debug_output(file, lvi, (lvi + lvc), file->idx->io_type);
+  // Output to stderr the timmings of all the io phases,
+  // files opened with PIDX_serial_file_open have no communicator to reduce them over
+  if (file->idx_c->simulation_nprocs != 0)
+    PIDX_debug_output(file, lvi, (lvi + lvc), file->idx->io_type);
 
   // delete timming buffers
   PIDX_delete_timming_buffers1(time, file->idx->variable_count);
@@ -144,6 +176,7 @@ PIDX_return_code PIDX_close(PIDX_file file)
       free(file->idx->variable[j]->sim_patch[k]);
       file->idx->variable[j]->sim_patch[k] = 0;
     }
+    PIDX_variable_free_patches(file->idx->variable[j]);
     free(file->idx->variable[j]);
     file->idx->variable[j] = 0;
   }
@@ -152,10 +185,17 @@ PIDX_return_code PIDX_close(PIDX_file file)
 
   PIDX_dump_state_finalize(file);
 
+  // waits for the in flight reads, the block cache is owned by the caller
+  if (file->prefetch != NULL)
+    PIDX_free_time_step_prefetch(file->prefetch);
+
+  PIDX_variable_table_free(file->idx);
+  free(file->idx->compressed_file_size);
   free(file->idx);
   free(file->restructured_grid);
   free(file->time);
   free(file->idx_dbg);
+  free_cached_communicators(file->idx_c);
   free(file->idx_c);
   free(file->idx_b);
 
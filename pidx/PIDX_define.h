@@ -49,7 +49,7 @@ extern "C" {
 #define O_BINARY 0
 #endif
 
-#define PIDX_CURR_METADATA_VERSION "6.1"
+#define PIDX_CURR_METADATA_VERSION "6.2"
   
 #define PIDX_MAX_DIMENSIONS 3
 #define MULTI_BOX 0
@@ -107,6 +107,20 @@ enum boundary_type {power_two_block = 1,
 #define PIDX_NO_COMPRESSION 0
 #define PIDX_CHUNKING_ONLY 1
 #define PIDX_CHUNKING_ZFP 2
+// Chunking, then every IDX block is compressed with ZFP at the aggregator and stored with its own size
+#define PIDX_CHUNKING_ZFP_BLOCK 3
+// No chunking, raw HZ samples are aggregated and every IDX block is compressed with ZFP (1D) at the aggregator
+#define PIDX_ZFP_BLOCK 4
+// No chunking, every IDX block of raw HZ samples is compressed without loss at the aggregator
+#define PIDX_LOSSLESS_BLOCK 5
+// No chunking, every IDX block of raw HZ samples is stored as byte planes, most significant first, so that reads
+// can stop after the first planes (see PIDX_set_read_precision)
+#define PIDX_PRECISION_BLOCK 6
+
+// ZFP modes, fixed accuracy and fixed precision produce variable size blocks (PIDX_CHUNKING_ZFP_BLOCK and PIDX_ZFP_BLOCK)
+#define PIDX_ZFP_FIXED_RATE 0
+#define PIDX_ZFP_FIXED_ACCURACY 1
+#define PIDX_ZFP_FIXED_PRECISION 2
 
 // Data in buffer is in row order
 #define PIDX_row_major                           0
@@ -138,10 +152,6 @@ enum PIDX_endian_type{
 
 #define PIDX_FILE_PATH_LENGTH                    1024
 
-#ifndef PIDX_MAX_VARIABLE_COUNT
-#define PIDX_MAX_VARIABLE_COUNT                  768
-#endif
-
 /// Create the file if it does not exist.
 #define PIDX_MODE_CREATE              1
 
@@ -57,6 +57,7 @@ struct PIDX_file_descriptor
   int variable_index_tracker;                   ///< tracking upto which variable io has been done (used for flushing)
   int local_variable_index;                     ///< starting index of variable that needs to be written out before a flush
   int local_variable_count;                     ///< total number of variables that is written out in a flush
+  int points_read;                              ///< 1 if PIDX_read_points was called since the last flush
 
   // IDX related
   idx_dataset idx;                              ///< Contains all IDX related info
@@ -73,6 +74,10 @@ struct PIDX_file_descriptor
   // for caching HZ indices
   PIDX_metadata_cache meta_data_cache;          ///< enables caching across time steps
 
+  // for caching idx blocks and binary file headers across reads
+  PIDX_block_cache block_cache;                 ///< LRU block cache (NULL when disabled)
+  PIDX_time_step_prefetch prefetch;             ///< prefetches the next time step into block_cache (NULL when disabled)
+
   // for restructuring and partitioning
   PIDX_restructured_grid restructured_grid;     ///< contains information of the restructured grid
 };
@@ -191,6 +191,7 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
   MPI_Bcast(&((*file)->idx->endian), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->pidx_version), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->metadata_version), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast(&((*file)->idx->chunk_component_planes), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->blocks_per_file), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->bits_per_block), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->variable_count), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
@@ -200,6 +201,9 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
   MPI_Bcast((*file)->idx->partition_offset, PIDX_MAX_DIMENSIONS, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->compression_bit_rate), 1, MPI_FLOAT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->compression_type), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast(&((*file)->idx->compression_mode), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast(&((*file)->idx->compression_tolerance), 1, MPI_DOUBLE, 0, (*file)->idx_c->simulation_comm);
+  MPI_Bcast(&((*file)->idx->compression_precision), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->idx->io_type), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
   MPI_Bcast(&((*file)->fs_block_size), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
 
@@ -233,6 +237,9 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
 
   if ((*file)->idx_c->simulation_rank != 0)
   {
+    if (PIDX_variable_table_reserve((*file)->idx, (*file)->idx->variable_count) != PIDX_success)
+      return PIDX_err_variable;
+
     for (var = 0; var < (*file)->idx->variable_count; var++)
     {
       (*file)->idx->variable[var] = malloc(sizeof (*((*file)->idx->variable[var])));
@@ -246,6 +253,12 @@ PIDX_return_code PIDX_file_open(const char* filename, PIDX_flags flags, PIDX_acc
     MPI_Bcast(&((*file)->idx->variable[var]->vps), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
     MPI_Bcast((*file)->idx->variable[var]->var_name, 512, MPI_CHAR, 0, (*file)->idx_c->simulation_comm);
     MPI_Bcast((*file)->idx->variable[var]->type_name, 512, MPI_CHAR, 0, (*file)->idx_c->simulation_comm);
+    MPI_Bcast(&((*file)->idx->variable[var]->compression_override), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+    MPI_Bcast(&((*file)->idx->variable[var]->compression_type), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+    MPI_Bcast(&((*file)->idx->variable[var]->compression_mode), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
+    MPI_Bcast(&((*file)->idx->variable[var]->compression_bit_rate), 1, MPI_FLOAT, 0, (*file)->idx_c->simulation_comm);
+    MPI_Bcast(&((*file)->idx->variable[var]->compression_tolerance), 1, MPI_DOUBLE, 0, (*file)->idx_c->simulation_comm);
+    MPI_Bcast(&((*file)->idx->variable[var]->compression_precision), 1, MPI_INT, 0, (*file)->idx_c->simulation_comm);
 
     (*file)->idx->variable[var]->sim_patch_count = 0;
   }
@@ -442,6 +455,13 @@ PIDX_return_code PIDX_serial_file_open(const char* filename, PIDX_flags flags, P
 
   (*file)->idx->variable_count = (*file)->idx->variable_count;
 
+  if ((*file)->idx->io_type == PIDX_IDX_IO)
+  {
+    (*file)->idx->maxh = strlen((*file)->idx->bitSequence);
+    for (uint32_t i = 0; i <= (*file)->idx->maxh; i++)
+      (*file)->idx->bitPattern[i] = RegExBitmaskBit((*file)->idx->bitSequence, i);
+  }
+
   if ((*file)->idx->io_type != PIDX_RAW_IO)
     (*file)->idx->samples_per_block = (int)pow(2, (*file)->idx->bits_per_block);
 
@@ -76,6 +76,83 @@ PIDX_return_code PIDX_get_meta_data_cache(PIDX_file file, PIDX_metadata_cache* c
 }
 
 
+
+PIDX_return_code PIDX_set_block_cache(PIDX_file file, PIDX_block_cache cache)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  file->block_cache = cache;
+
+  // a dataset opened for write replaces whatever the cache holds for it
+  if (cache != NULL && file->flags == MPI_MODE_CREATE)
+    return PIDX_block_cache_drop_dataset(cache, file->idx->filename);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_block_cache(PIDX_file file, PIDX_block_cache* cache)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!cache)
+    return PIDX_err_file;
+
+  *cache = file->block_cache;
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_time_step_prefetch(PIDX_file file, int thread_count)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (thread_count < 0)
+    return PIDX_err_file;
+
+  if (file->prefetch != NULL)
+  {
+    PIDX_free_time_step_prefetch(file->prefetch);
+    file->prefetch = NULL;
+  }
+
+  if (thread_count == 0)
+    return PIDX_success;
+
+#if PIDX_HAVE_PTHREADS
+  // prefetched blocks are staged in the block cache
+  if (file->block_cache == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
+  }
+
+  return PIDX_create_time_step_prefetch(thread_count, &file->prefetch);
+#else
+  return PIDX_err_not_implemented;
+#endif
+}
+
+
+
+PIDX_return_code PIDX_get_time_step_prefetch(PIDX_file file, int* thread_count)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!thread_count)
+    return PIDX_err_file;
+
+  *thread_count = (file->prefetch != NULL) ? file->prefetch->thread_count : 0;
+  return PIDX_success;
+}
+
+
 PIDX_return_code PIDX_set_variable_count(PIDX_file file, int  variable_count)
 {
   if (!file)
@@ -84,6 +161,9 @@ PIDX_return_code PIDX_set_variable_count(PIDX_file file, int  variable_count)
   if (variable_count <= 0)
     return PIDX_err_count;
 
+  if (PIDX_variable_table_reserve(file->idx, variable_count) != PIDX_success)
+    return PIDX_err_variable;
+
   file->idx->variable_count = variable_count;
   file->idx->variable_pipe_length = file->idx->variable_count;
 
@@ -149,6 +229,10 @@ PIDX_return_code PIDX_set_current_time_step(PIDX_file file, const int current_ti
 
   file->idx->current_time_step = current_time_step;
 
+  // the compressed blocks of a new time step go to new files
+  free(file->idx->compressed_file_size);
+  file->idx->compressed_file_size = NULL;
+
   return PIDX_success;
 }
 
@@ -579,18 +663,22 @@ PIDX_return_code PIDX_set_compression_type(PIDX_file file, int compression_type)
   if (!file)
     return PIDX_err_file;
 
-  if (compression_type != PIDX_NO_COMPRESSION && compression_type != PIDX_CHUNKING_ONLY && compression_type != PIDX_CHUNKING_ZFP)
+  if (compression_type != PIDX_NO_COMPRESSION && compression_type != PIDX_CHUNKING_ONLY && compression_type != PIDX_CHUNKING_ZFP && compression_type != PIDX_CHUNKING_ZFP_BLOCK && compression_type != PIDX_ZFP_BLOCK && compression_type != PIDX_LOSSLESS_BLOCK && compression_type != PIDX_PRECISION_BLOCK)
     return PIDX_err_unsupported_compression_type;
 
   file->idx->compression_type = compression_type;
 
-  if (file->idx->compression_type == PIDX_NO_COMPRESSION)
+  if (file->idx->compression_type == PIDX_NO_COMPRESSION || file->idx->compression_type == PIDX_ZFP_BLOCK || file->idx->compression_type == PIDX_LOSSLESS_BLOCK || file->idx->compression_type == PIDX_PRECISION_BLOCK)
     return PIDX_success;
-  else if (file->idx->compression_type == PIDX_CHUNKING_ONLY || file->idx->compression_type == PIDX_CHUNKING_ZFP)
+  else if (file->idx->compression_type == PIDX_CHUNKING_ONLY || file->idx->compression_type == PIDX_CHUNKING_ZFP || file->idx->compression_type == PIDX_CHUNKING_ZFP_BLOCK)
   {
-    file->idx->chunk_size[0] = 4;
-    file->idx->chunk_size[1] = 4;
-    file->idx->chunk_size[2] = 4;
+    // chunks follow the dimensionality of the dataset (4x4x1 for 2D data, 4x1x1 for 1D data), flat axes
+    // are not padded to 4 and the HZ bitmask is built over the chunked box
+    int d;
+    for (d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+      file->idx->chunk_size[d] = (file->idx->box_bounds[d] > 1) ? 4 : 1;
+    if (file->idx->chunk_size[0] * file->idx->chunk_size[1] * file->idx->chunk_size[2] == 1)
+      file->idx->chunk_size[0] = 4;
 
     int reduce_by_sample = 1;
     uint64_t total_chunk_size = file->idx->chunk_size[0] * file->idx->chunk_size[1] * file->idx->chunk_size[2];
@@ -625,6 +713,71 @@ PIDX_return_code PIDX_get_compression_type(PIDX_file file, int *compression_type
 }
 
 
+// the first setting given to a variable starts from the ones of the file
+static void override_variable_compression(PIDX_file file, PIDX_variable var)
+{
+  if (var->compression_override)
+    return;
+
+  var->compression_override = 1;
+  var->compression_type = file->idx->compression_type;
+  var->compression_mode = file->idx->compression_mode;
+  var->compression_bit_rate = file->idx->compression_bit_rate;
+  var->compression_tolerance = file->idx->compression_tolerance;
+  var->compression_precision = file->idx->compression_precision;
+}
+
+
+
+// ZFP settings only apply to variables that are compressed with ZFP
+static int variable_uses_zfp(PIDX_file file, PIDX_variable var)
+{
+  int compression_type = (var != NULL && var->compression_override) ? var->compression_type : file->idx->compression_type;
+  return (compression_type == PIDX_CHUNKING_ZFP_BLOCK || compression_type == PIDX_ZFP_BLOCK);
+}
+
+
+
+PIDX_return_code PIDX_set_variable_compression_type(PIDX_file file, PIDX_variable var, int compression_type)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!var)
+    return PIDX_err_variable;
+
+  // every block of a variable is compressed on its own, so only block compressed files can mix codecs
+  if (!PIDX_compression_block_container(file->idx))
+    return PIDX_err_unsupported_compression_type;
+
+  // the chunking is shared by all variables, ZFP has to match the one of the file
+  int zfp_type = (file->idx->compression_type == PIDX_CHUNKING_ZFP_BLOCK) ? PIDX_CHUNKING_ZFP_BLOCK : PIDX_ZFP_BLOCK;
+  if (compression_type != PIDX_NO_COMPRESSION && compression_type != PIDX_LOSSLESS_BLOCK && compression_type != PIDX_PRECISION_BLOCK && compression_type != zfp_type)
+    return PIDX_err_unsupported_compression_type;
+
+  override_variable_compression(file, var);
+  var->compression_type = compression_type;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_variable_compression_type(PIDX_file file, PIDX_variable var, int *compression_type)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!var)
+    return PIDX_err_variable;
+
+  *compression_type = var->compression_override ? var->compression_type : file->idx->compression_type;
+
+  return PIDX_success;
+}
+
+
+
 PIDX_return_code PIDX_set_average_compression_factor(PIDX_file file, int compression_factor, float bit_rate)
 {
   if (!file)
@@ -648,12 +801,36 @@ PIDX_return_code PIDX_set_lossy_compression_bit_rate(PIDX_file file, PIDX_variab
   if (file->idx->compression_type == PIDX_CHUNKING_ONLY)
     return PIDX_success;
 
-  file->idx->compression_bit_rate = compression_bit_rate;
+  // blocks keep their size in the pipeline and are compressed at the aggregators, so every variable can have its own rate
+  if (PIDX_compression_block_container(file->idx) && var != NULL)
+  {
+    if (compression_bit_rate <= 0)
+      return PIDX_err_unsupported_compression_type;
+
+    override_variable_compression(file, var);
+    var->compression_mode = PIDX_ZFP_FIXED_RATE;
+    var->compression_bit_rate = compression_bit_rate;
+    return PIDX_success;
+  }
+
+  if (PIDX_compression_block_container(file->idx))
+  {
+    file->idx->compression_bit_rate = compression_bit_rate;
+    file->idx->compression_mode = PIDX_ZFP_FIXED_RATE;
+    return PIDX_success;
+  }
 
   // TODO Super-confusing: bps (bits per sample) is used in the code as n_components*bits_one_sample vps is always one
           //here we use bpv from PIDX_get_datatype_details which is actually the size of one sample
   int bpv, vps;
   PIDX_get_datatype_details(var->type_name, &vps, &bpv);
+
+  // the chunked buffer is encoded in place, a stream larger than the samples would overrun it
+  if (compression_bit_rate <= 0 || compression_bit_rate > bpv)
+    return PIDX_err_unsupported_compression_type;
+
+  file->idx->compression_bit_rate = compression_bit_rate;
+  file->idx->compression_mode = PIDX_ZFP_FIXED_RATE;
   file->idx->compression_factor = bpv/compression_bit_rate;
 
   if (file->idx->compression_bit_rate == 64)
@@ -735,6 +912,60 @@ PIDX_return_code PIDX_get_lossy_compression_bit_rate(PIDX_file file, int *compre
 
 
 
+PIDX_return_code PIDX_set_lossy_compression_tolerance(PIDX_file file, PIDX_variable var, double tolerance)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!PIDX_compression_block_container(file->idx) || !variable_uses_zfp(file, var))
+    return PIDX_err_unsupported_compression_type;
+
+  if (tolerance <= 0)
+    return PIDX_err_unsupported_compression_type;
+
+  if (var != NULL)
+  {
+    override_variable_compression(file, var);
+    var->compression_mode = PIDX_ZFP_FIXED_ACCURACY;
+    var->compression_tolerance = tolerance;
+    return PIDX_success;
+  }
+
+  file->idx->compression_mode = PIDX_ZFP_FIXED_ACCURACY;
+  file->idx->compression_tolerance = tolerance;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_lossy_compression_precision(PIDX_file file, PIDX_variable var, int precision)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!PIDX_compression_block_container(file->idx) || !variable_uses_zfp(file, var))
+    return PIDX_err_unsupported_compression_type;
+
+  if (precision <= 0 || precision > 64)
+    return PIDX_err_unsupported_compression_type;
+
+  if (var != NULL)
+  {
+    override_variable_compression(file, var);
+    var->compression_mode = PIDX_ZFP_FIXED_PRECISION;
+    var->compression_precision = precision;
+    return PIDX_success;
+  }
+
+  file->idx->compression_mode = PIDX_ZFP_FIXED_PRECISION;
+  file->idx->compression_precision = precision;
+
+  return PIDX_success;
+}
+
+
+
 PIDX_return_code PIDX_set_io_mode(PIDX_file file, enum PIDX_io_type io_type)
 {
   if (file == NULL)
@@ -759,6 +990,159 @@ PIDX_return_code PIDX_get_io_mode(PIDX_file file, enum PIDX_io_type* io_type)
 
 
 
+PIDX_return_code PIDX_set_restart_read(PIDX_file file, int enable)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  file->idx->restart_read = (enable != 0) ? 1 : 0;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_restart_read(PIDX_file file, int* enable)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *enable = file->idx->restart_read;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_read_thread_count(PIDX_file file, int thread_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (thread_count < 0)
+    return PIDX_err_size;
+
+  file->idx->read_thread_count = thread_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_read_thread_count(PIDX_file file, int* thread_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *thread_count = file->idx->read_thread_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_read_precision(PIDX_file file, int bytes)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (bytes < 0)
+    return PIDX_err_size;
+
+  file->idx->read_precision = bytes;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_read_precision(PIDX_file file, int* bytes)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *bytes = file->idx->read_precision;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_compression_thread_count(PIDX_file file, int thread_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  if (thread_count < 0)
+    return PIDX_err_size;
+
+  file->idx->compression_thread_count = thread_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_compression_thread_count(PIDX_file file, int* thread_count)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *thread_count = file->idx->compression_thread_count;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_sparse_rst_meta_data(PIDX_file file, int enable)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  file->idx->sparse_rst_meta_data = (enable != 0) ? 1 : 0;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_sparse_rst_meta_data(PIDX_file file, int* enable)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *enable = file->idx->sparse_rst_meta_data;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_restructuring_overlap(PIDX_file file, int enable)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  file->idx->rst_overlap = (enable != 0) ? 1 : 0;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_get_restructuring_overlap(PIDX_file file, int* enable)
+{
+  if (file == NULL)
+    return PIDX_err_file;
+
+  *enable = file->idx->rst_overlap;
+
+  return PIDX_success;
+}
+
+
+
 #if 0
 PIDX_return_code PIDX_set_wavelet_level(PIDX_file file, int w_level)
 {
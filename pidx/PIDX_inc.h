@@ -66,6 +66,10 @@
 
 #include <mpi.h>
 
+#if PIDX_HAVE_PTHREADS
+  #include <pthread.h>
+#endif
+
 #if PIDX_HAVE_ZFP
   #include <zfp.h>
 #endif
@@ -91,13 +95,18 @@ extern "C" {
 #include "./utils/PIDX_file_name.h"
 #include "./utils/PIDX_file_access_modes.h"
 #include "./utils/PIDX_buffer.h"
+#include "./utils/PIDX_thread_pool.h"
 
 #include "./comm/PIDX_comm.h"
 
 #include "./metadata/PIDX_metadata_cache.h"
+#include "./metadata/PIDX_block_cache.h"
 
 #include "./data_handle/PIDX_blocks.h"
 #include "./data_handle/PIDX_data_structs.h"
+#include "./data_handle/PIDX_variable_table.h"
+
+#include "./metadata/PIDX_time_step_prefetch.h"
 
 #include "./core/PIDX_header/PIDX_header_io.h"
 #include "./core/PIDX_raw_rst/PIDX_raw_rst.h"
@@ -106,6 +115,7 @@ extern "C" {
 #include "./core/PIDX_hz/PIDX_hz_encode.h"
 #include "./core/PIDX_block_rst/PIDX_block_restructure.h"
 #include "./core/PIDX_cmp/PIDX_compression.h"
+#include "./core/PIDX_cmp/PIDX_lossless.h"
 #include "./core/PIDX_agg/PIDX_agg.h"
 #include "./core/PIDX_file_io/PIDX_file_io.h"
 
@@ -0,0 +1,415 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file PIDX_point_query.c
+ *
+ * Batched point queries. The points are converted to HZ addresses, the
+ * requests for a binary file are routed to a single process, and every
+ * idx block that holds at least one requested sample is read exactly once.
+ *
+ */
+
+#include "PIDX_file_handler.h"
+
+// A single sample request, the HZ address of the sample and its position in the result buffer
+struct PIDX_point_request_struct
+{
+  uint64_t hz;
+  uint64_t index;
+};
+typedef struct PIDX_point_request_struct PIDX_point_request;
+
+static int compare_point_request(const void* a, const void* b);
+static void reverse_sample_endian(unsigned char* sample, int bytes_per_value, int value_count);
+static PIDX_return_code read_point_requests(PIDX_file file, int vi, char* filename_template, PIDX_point_request* requests, uint64_t request_count, unsigned char* values);
+
+
+PIDX_return_code PIDX_read_points(PIDX_file file, PIDX_variable variable, uint64_t point_count, PIDX_point* points, void* values)
+{
+  if (!file)
+    return PIDX_err_file;
+
+  if (!variable)
+    return PIDX_err_variable;
+
+  // samples are addressed directly in HZ space, which is only the case for plain (non partitioned, uncompressed) idx
+  if (file->idx->io_type != PIDX_IDX_IO)
+    return PIDX_err_not_implemented;
+
+  if (file->idx->compression_type != PIDX_NO_COMPRESSION)
+    return PIDX_err_unsupported_compression_type;
+
+  int vi = -1;
+  for (uint32_t v = 0; v < file->idx->variable_count; v++)
+  {
+    if (file->idx->variable[v] == variable)
+    {
+      vi = (int)v;
+      break;
+    }
+  }
+  if (vi == -1)
+    return PIDX_err_variable;
+
+  // the flush that follows checks whether the variable also has patches to read
+  file->points_read = 1;
+
+  int nprocs = file->idx_c->simulation_nprocs;
+  int bytes_per_sample = (variable->bpv / 8) * variable->vps;
+
+  // the points are checked before any exchange, and all the processes give up together if one of them has a bad point
+  int local_error = 0, global_error = 0;
+  if (point_count != 0 && (points == NULL || values == NULL))
+    local_error = 1;
+
+  for (uint64_t p = 0; p < point_count && local_error == 0; p++)
+  {
+    if (points[p][0] >= file->idx->bounds[0] || points[p][1] >= file->idx->bounds[1] || points[p][2] >= file->idx->bounds[2])
+    {
+      fprintf(stderr, "[%s] [%d] point (%lld %lld %lld) is outside the dataset bounds\n", __FILE__, __LINE__, (long long)points[p][0], (long long)points[p][1], (long long)points[p][2]);
+      local_error = 1;
+    }
+  }
+
+  global_error = local_error;
+  if (nprocs > 1)
+    MPI_Allreduce(&local_error, &global_error, 1, MPI_INT, MPI_MAX, file->idx_c->simulation_comm);
+  if (global_error != 0)
+    return PIDX_err_point;
+
+  // convert all the points to HZ addresses
+  PIDX_point_request* requests = malloc(sizeof(*requests) * (point_count + 1));
+  memset(requests, 0, sizeof(*requests) * (point_count + 1));
+
+  for (uint64_t p = 0; p < point_count; p++)
+  {
+    Point3D xyz;
+    xyz.x = (int)points[p][0];
+    xyz.y = (int)points[p][1];
+    xyz.z = (int)points[p][2];
+
+    requests[p].hz = xyz_to_HZ(file->idx->bitPattern, file->idx->maxh - 1, xyz);
+    requests[p].index = p;
+  }
+
+  char filename_template[PIDX_FILE_PATH_LENGTH];
+  generate_file_name_template(file->idx->maxh, file->idx->bits_per_block, file->idx->filename, file->idx->filename_time_template, file->idx->current_time_step, filename_template);
+
+  // Serial (or single process) query, no need to exchange the points
+  if (nprocs <= 1)
+  {
+    PIDX_return_code ret = read_point_requests(file, vi, filename_template, requests, point_count, values);
+    free(requests);
+    return ret;
+  }
+
+  PIDX_return_code ret = PIDX_success;
+  uint64_t samples_per_file = (uint64_t)file->idx->samples_per_block * file->idx->blocks_per_file;
+  uint64_t *recv_hz = NULL;
+  PIDX_point_request* served = NULL;
+  unsigned char* served_values = NULL;
+  unsigned char* gathered_values = NULL;
+
+  // file f is served by process f % nprocs, this way every binary file is opened by only one process
+  int *send_count = malloc(sizeof(*send_count) * nprocs);
+  int *send_offset = malloc(sizeof(*send_offset) * nprocs);
+  int *recv_count = malloc(sizeof(*recv_count) * nprocs);
+  int *recv_offset = malloc(sizeof(*recv_offset) * nprocs);
+  memset(send_count, 0, sizeof(*send_count) * nprocs);
+  memset(send_offset, 0, sizeof(*send_offset) * nprocs);
+  memset(recv_count, 0, sizeof(*recv_count) * nprocs);
+  memset(recv_offset, 0, sizeof(*recv_offset) * nprocs);
+
+  for (uint64_t p = 0; p < point_count; p++)
+    send_count[(requests[p].hz / samples_per_file) % nprocs]++;
+
+  for (int r = 1; r < nprocs; r++)
+    send_offset[r] = send_offset[r - 1] + send_count[r - 1];
+
+  // group the HZ addresses by the serving process, origin keeps track of where the value has to go back to
+  uint64_t *send_hz = malloc(sizeof(*send_hz) * (point_count + 1));
+  uint64_t *origin = malloc(sizeof(*origin) * (point_count + 1));
+  int *fill = malloc(sizeof(*fill) * nprocs);
+  memcpy(fill, send_offset, sizeof(*fill) * nprocs);
+  for (uint64_t p = 0; p < point_count; p++)
+  {
+    int dest = (requests[p].hz / samples_per_file) % nprocs;
+    send_hz[fill[dest]] = requests[p].hz;
+    origin[fill[dest]] = p;
+    fill[dest]++;
+  }
+  free(fill);
+  free(requests);
+
+  // every collective is followed by an agreement on its outcome, so that all the processes leave at the same step
+  local_error = (MPI_Alltoall(send_count, 1, MPI_INT, recv_count, 1, MPI_INT, file->idx_c->simulation_comm) != MPI_SUCCESS);
+  MPI_Allreduce(&local_error, &global_error, 1, MPI_INT, MPI_MAX, file->idx_c->simulation_comm);
+  if (global_error != 0)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    ret = PIDX_err_mpi;
+    goto cleanup;
+  }
+
+  uint64_t recv_total = recv_count[0];
+  for (int r = 1; r < nprocs; r++)
+  {
+    recv_offset[r] = recv_offset[r - 1] + recv_count[r - 1];
+    recv_total = recv_total + recv_count[r];
+  }
+
+  recv_hz = malloc(sizeof(*recv_hz) * (recv_total + 1));
+  local_error = (MPI_Alltoallv(send_hz, send_count, send_offset, MPI_UNSIGNED_LONG_LONG, recv_hz, recv_count, recv_offset, MPI_UNSIGNED_LONG_LONG, file->idx_c->simulation_comm) != MPI_SUCCESS);
+  MPI_Allreduce(&local_error, &global_error, 1, MPI_INT, MPI_MAX, file->idx_c->simulation_comm);
+  if (global_error != 0)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    ret = PIDX_err_mpi;
+    goto cleanup;
+  }
+
+  // serve the requests of all the processes for the files owned by this process
+  served = malloc(sizeof(*served) * (recv_total + 1));
+  memset(served, 0, sizeof(*served) * (recv_total + 1));
+  for (uint64_t i = 0; i < recv_total; i++)
+  {
+    served[i].hz = recv_hz[i];
+    served[i].index = i;
+  }
+
+  served_values = malloc(bytes_per_sample * (recv_total + 1));
+  memset(served_values, 0, bytes_per_sample * (recv_total + 1));
+  local_error = (read_point_requests(file, vi, filename_template, served, recv_total, served_values) != PIDX_success);
+  MPI_Allreduce(&local_error, &global_error, 1, MPI_INT, MPI_MAX, file->idx_c->simulation_comm);
+  if (global_error != 0)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    ret = PIDX_err_io;
+    goto cleanup;
+  }
+
+  // send the values back to the processes that asked for them
+  MPI_Datatype sample_type;
+  MPI_Type_contiguous(bytes_per_sample, MPI_BYTE, &sample_type);
+  MPI_Type_commit(&sample_type);
+
+  gathered_values = malloc(bytes_per_sample * (point_count + 1));
+  local_error = (MPI_Alltoallv(served_values, recv_count, recv_offset, sample_type, gathered_values, send_count, send_offset, sample_type, file->idx_c->simulation_comm) != MPI_SUCCESS);
+  MPI_Type_free(&sample_type);
+  MPI_Allreduce(&local_error, &global_error, 1, MPI_INT, MPI_MAX, file->idx_c->simulation_comm);
+  if (global_error != 0)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    ret = PIDX_err_mpi;
+    goto cleanup;
+  }
+
+  for (uint64_t p = 0; p < point_count; p++)
+    memcpy((unsigned char*)values + origin[p] * bytes_per_sample, gathered_values + p * bytes_per_sample, bytes_per_sample);
+
+cleanup:
+  free(gathered_values);
+  free(served_values);
+  free(served);
+  free(recv_hz);
+  free(send_hz);
+  free(origin);
+  free(send_count);
+  free(send_offset);
+  free(recv_count);
+  free(recv_offset);
+
+  return ret;
+}
+
+
+
+static PIDX_return_code read_point_requests(PIDX_file file, int vi, char* filename_template, PIDX_point_request* requests, uint64_t request_count, unsigned char* values)
+{
+  if (request_count == 0)
+    return PIDX_success;
+
+  // sorting by HZ address also sorts the requests by file and then by block
+  qsort(requests, request_count, sizeof(*requests), compare_point_request);
+
+  PIDX_variable var = file->idx->variable[vi];
+  int bytes_per_sample = (var->bpv / 8) * var->vps;
+  uint64_t samples_per_block = file->idx->samples_per_block;
+  uint64_t blocks_per_file = file->idx->blocks_per_file;
+  uint64_t block_size = samples_per_block * bytes_per_sample;
+
+  // endianness is flipped per component, a 3*float64 sample is three 8 byte values
+  int component_count = 0;
+  int component_bits = 0;
+  PIDX_get_datatype_details(var->type_name, &component_count, &component_bits);
+  int component_bytes = component_bits / 8;
+  if (component_bytes <= 0 || bytes_per_sample % component_bytes != 0)
+    component_bytes = bytes_per_sample;
+
+  PIDX_return_code ret = PIDX_success;
+
+  // decoded (offset, size) of every block of every variable of the current file
+  uint64_t *block_table = malloc(sizeof(*block_table) * 2 * blocks_per_file * file->idx->variable_count);
+  memset(block_table, 0, sizeof(*block_table) * 2 * blocks_per_file * file->idx->variable_count);
+
+  unsigned char* block_buffer = malloc(block_size);
+  memset(block_buffer, 0, block_size);
+
+  char file_name[PATH_MAX];
+  MPI_File fp = 0;
+  int is_open = 0;
+  int file_is_loaded = 0;
+  int block_is_loaded = 0;
+  uint64_t current_file = 0, current_block = 0;
+
+  for (uint64_t r = 0; r < request_count; r++)
+  {
+    uint64_t hz = requests[r].hz;
+    uint64_t file_number = hz / (samples_per_block * blocks_per_file);
+    uint64_t block_number = hz / samples_per_block;
+
+    // look at the header of every binary file only once (the file is opened only if something is not cached)
+    if (file_is_loaded == 0 || file_number != current_file)
+    {
+      if (is_open == 1)
+      {
+        MPI_File_close(&fp);
+        is_open = 0;
+      }
+
+      if (generate_file_name(file->idx->blocks_per_file, filename_template, (unsigned int) file_number, file_name, PATH_MAX) == 1)
+      {
+        fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+        ret = PIDX_err_io;
+        goto cleanup;
+      }
+
+      if (PIDX_block_cache_read_header(file->block_cache, file_name, file->idx->current_time_step, file->idx->blocks_per_file, file->idx->variable_count, &fp, &is_open, block_table) != PIDX_success)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        ret = PIDX_err_io;
+        goto cleanup;
+      }
+
+      current_file = file_number;
+      file_is_loaded = 1;
+      block_is_loaded = 0;
+    }
+
+    // read the block only once, all the samples that fall in it are served from memory
+    if (block_is_loaded == 0 || block_number != current_block)
+    {
+      uint64_t block_in_file = block_number % blocks_per_file;
+      uint64_t data_offset = block_table[2 * (block_in_file + (blocks_per_file * vi))];
+      uint64_t data_size = block_table[2 * (block_in_file + (blocks_per_file * vi)) + 1];
+
+      if (data_size > block_size)
+      {
+        fprintf(stderr, "[%s] [%d] block %lld of %s is larger than expected (%lld > %lld).\n", __FILE__, __LINE__, (long long)block_number, file_name, (long long)data_size, (long long)block_size);
+        ret = PIDX_err_io;
+        goto cleanup;
+      }
+
+      // blocks that were never written read back as zeros
+      memset(block_buffer, 0, block_size);
+      if (data_size != 0)
+      {
+        if (PIDX_block_cache_read_block(file->block_cache, file_name, vi, file->idx->current_time_step, block_number, data_offset, data_size, &fp, &is_open, block_buffer) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          ret = PIDX_err_io;
+          goto cleanup;
+        }
+      }
+
+      current_block = block_number;
+      block_is_loaded = 1;
+    }
+
+    unsigned char* sample = values + requests[r].index * bytes_per_sample;
+    memcpy(sample, block_buffer + (hz % samples_per_block) * bytes_per_sample, bytes_per_sample);
+
+    if (file->idx->flip_endian == 1)
+      reverse_sample_endian(sample, component_bytes, bytes_per_sample / component_bytes);
+  }
+
+cleanup:
+  if (is_open == 1)
+    MPI_File_close(&fp);
+
+  free(block_table);
+  free(block_buffer);
+
+  return ret;
+}
+
+
+
+static int compare_point_request(const void* a, const void* b)
+{
+  const PIDX_point_request* ra = a;
+  const PIDX_point_request* rb = b;
+
+  if (ra->hz < rb->hz)
+    return -1;
+  if (ra->hz > rb->hz)
+    return 1;
+  return 0;
+}
+
+
+
+static void reverse_sample_endian(unsigned char* sample, int bytes_per_value, int value_count)
+{
+  for (int v = 0; v < value_count; v++)
+  {
+    unsigned char* value = sample + v * bytes_per_value;
+    for (int i = 0; i < bytes_per_value / 2; i++)
+    {
+      unsigned char temp = value[i];
+      value[i] = value[bytes_per_value - 1 - i];
+      value[bytes_per_value - 1 - i] = temp;
+    }
+  }
+
+  return;
+}
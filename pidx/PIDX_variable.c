@@ -104,6 +104,9 @@ PIDX_return_code PIDX_variable_write_data_layout(PIDX_variable variable, PIDX_po
     return PIDX_err_variable;
 
   const void *temp_buffer;
+  if (PIDX_variable_reserve_patches(variable, variable->sim_patch_count + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   variable->sim_patch[variable->sim_patch_count] = malloc(sizeof(*(variable->sim_patch[variable->sim_patch_count])));
   memset(variable->sim_patch[variable->sim_patch_count], 0, sizeof(*(variable->sim_patch[variable->sim_patch_count])));
 
@@ -128,6 +131,9 @@ PIDX_return_code PIDX_variable_write_particle_data_layout(PIDX_variable variable
     return PIDX_err_variable;
 
   const void *temp_buffer;
+  if (PIDX_variable_reserve_patches(variable, variable->sim_patch_count + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   variable->sim_patch[variable->sim_patch_count] = malloc(sizeof(*(variable->sim_patch[variable->sim_patch_count])));
   memset(variable->sim_patch[variable->sim_patch_count], 0, sizeof(*(variable->sim_patch[variable->sim_patch_count])));
 
@@ -152,6 +158,9 @@ PIDX_return_code PIDX_variable_write_particle_data_physical_layout(PIDX_variable
     return PIDX_err_variable;
 
   const void *temp_buffer;
+  if (PIDX_variable_reserve_patches(variable, variable->sim_patch_count + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   variable->sim_patch[variable->sim_patch_count] = malloc(sizeof(*(variable->sim_patch[variable->sim_patch_count])));
   memset(variable->sim_patch[variable->sim_patch_count], 0, sizeof(*(variable->sim_patch[variable->sim_patch_count])));
 
@@ -210,6 +219,9 @@ PIDX_return_code PIDX_variable_read_particle_data_layout(PIDX_variable variable,
   if (!variable)
     return PIDX_err_variable;
 
+  if (PIDX_variable_reserve_patches(variable, variable->sim_patch_count + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   variable->sim_patch[variable->sim_patch_count] = malloc(sizeof(*(variable->sim_patch[variable->sim_patch_count])));
   memset(variable->sim_patch[variable->sim_patch_count], 0, sizeof(*(variable->sim_patch[variable->sim_patch_count])));
 
@@ -234,6 +246,9 @@ PIDX_return_code PIDX_variable_read_data_layout(PIDX_variable variable, PIDX_poi
   if (!variable)
     return PIDX_err_variable;
 
+  if (PIDX_variable_reserve_patches(variable, variable->sim_patch_count + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   variable->sim_patch[variable->sim_patch_count] = malloc(sizeof(*(variable->sim_patch[variable->sim_patch_count])));
   memset(variable->sim_patch[variable->sim_patch_count], 0, sizeof(*(variable->sim_patch[variable->sim_patch_count])));
 
@@ -391,6 +406,9 @@ PIDX_return_code PIDX_write_variable(PIDX_file file, PIDX_variable variable, PID
     return PIDX_err_variable;
 
   const void *temp_buffer;
+  if (PIDX_variable_reserve_patches(variable, variable->sim_patch_count + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   variable->sim_patch[variable->sim_patch_count] = malloc(sizeof(*(variable->sim_patch[variable->sim_patch_count])));
   memset(variable->sim_patch[variable->sim_patch_count], 0, sizeof(*(variable->sim_patch[variable->sim_patch_count])));
 
@@ -404,6 +422,9 @@ PIDX_return_code PIDX_write_variable(PIDX_file file, PIDX_variable variable, PID
   variable->sim_patch_count = variable->sim_patch_count + 1;
   //variable->io_state = 1;
 
+  if (PIDX_variable_table_reserve(file->idx, file->variable_index_tracker + 1) != PIDX_success)
+    return PIDX_err_variable;
+
   file->idx->variable[file->variable_index_tracker] = variable;
 
   file->variable_index_tracker++;
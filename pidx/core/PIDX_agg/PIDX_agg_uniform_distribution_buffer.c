@@ -97,5 +97,8 @@ PIDX_return_code PIDX_agg_buf_destroy(Agg_buffer ab)
     ab->buffer = 0;
   }
 
+  free(ab->block_size);
+  ab->block_size = 0;
+
   return PIDX_success;
 }
@@ -52,7 +52,7 @@
 
 #include "../../PIDX_inc.h"
 
-static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx, int ny, int nz, uint64_t compval, int bits, int mode);
+static void chunk_component(unsigned char* patch, unsigned char* chunked, int bytes, int vps, uint64_t* size, uint64_t* chunk_size, uint64_t brick_stride, int mode);
 
 //Struct for restructuring ID
 struct PIDX_chunk_id_struct
@@ -157,43 +157,134 @@ PIDX_return_code PIDX_chunk_buf_create(PIDX_chunk_id chunk_id)
 }
 
 
-static void returnbuffer(unsigned char * q, unsigned char * s, int cbz, int nx, int ny, int nz, uint64_t compval, int bits, int mode)
+// Copies one brick that lies inside the patch between the patch (values vps apart, row and plane strides
+// in values) and the brick (contiguous, x fastest). Rows of 4 are unrolled, which is the chunk of every
+// axis that is not flat.
+#define DEFINE_CHUNK_BRICK(T) \
+static void chunk_brick_##T(unsigned char* patch, unsigned char* brick, const int* c, uint64_t row, uint64_t plane, int vps, int mode) \
+{ \
+  T* b = (T*)brick; \
+  for (int zz = 0; zz < c[2]; zz++) \
+  { \
+    for (int yy = 0; yy < c[1]; yy++) \
+    { \
+      T* p = (T*)patch + zz * plane + yy * row; \
+      if (c[0] == 4) \
+      { \
+        if (mode == PIDX_WRITE) \
+        { \
+          b[0] = p[0]; \
+          b[1] = p[vps]; \
+          b[2] = p[2 * vps]; \
+          b[3] = p[3 * vps]; \
+        } \
+        else \
+        { \
+          p[0] = b[0]; \
+          p[vps] = b[1]; \
+          p[2 * vps] = b[2]; \
+          p[3 * vps] = b[3]; \
+        } \
+      } \
+      else if (mode == PIDX_WRITE) \
+      { \
+        for (int xx = 0; xx < c[0]; xx++) \
+          b[xx] = p[xx * vps]; \
+      } \
+      else \
+      { \
+        for (int xx = 0; xx < c[0]; xx++) \
+          p[xx * vps] = b[xx]; \
+      } \
+      b += c[0]; \
+    } \
+  } \
+}
+
+DEFINE_CHUNK_BRICK(uint8_t)
+DEFINE_CHUNK_BRICK(uint16_t)
+DEFINE_CHUNK_BRICK(uint32_t)
+DEFINE_CHUNK_BRICK(uint64_t)
+
+
+
+// Bricks on the upper faces of the patch only have extent[d] samples of the patch along every axis, the
+// rest of the brick is padding. Padding is written as zeros and skipped on reads. Also used for the
+// interior bricks of types that are not 1, 2, 4 or 8 bytes.
+static void chunk_boundary_brick(unsigned char* patch, unsigned char* brick, const int* c, const int* extent, uint64_t row, uint64_t plane, int bytes, int vps, int mode)
 {
-  int dz = 4 * nx*(ny-(ny/4)*4);
-  int dy = 4 * (nx-(nx/4)*4);
-  int dx = 4;
-
-  unsigned char * temp = q;
-  unsigned char * temp2 = s;
-  int x,y,z, zz,yy,xx;
-  for (z=0;z<nz;z+=4)
+  for (int zz = 0; zz < c[2]; zz++)
   {
-    s = temp2 + ((z/4) * ((ny+3)/4) * ((nx+3)/4)) * cbz * (bits/CHAR_BIT);
-    for (y=0;y<ny;y+=4)
+    for (int yy = 0; yy < c[1]; yy++)
     {
-      for (x=0;x<nx;x+=4)
+      for (int xx = 0; xx < c[0]; xx++)
       {
-        uint64_t diff = (z/4) * (dz + 4 * (ny/4) * (dy+4 * (nx/4) * dx)) + (y/4) * (dy+4*(nx/4)*dx) + (x/4)*dx;
-        q = temp + diff * (bits/CHAR_BIT);
-        for (zz = 0; zz < 4; zz++)
+        unsigned char* b = brick + (uint64_t)(xx + yy * c[0] + zz * c[0] * c[1]) * bytes;
+        if (xx >= extent[0] || yy >= extent[1] || zz >= extent[2])
         {
-          for (yy = 0; yy < 4; yy++)
-          {
-            for (xx = 0; xx < 4; xx++)
-            {
-              int i = xx + yy * 4 + zz * 4 * 4;
-              int j = xx + yy * nx + zz * nx * ny;
-
-              if (j + diff >= compval)
-                continue;
-              if (mode == PIDX_WRITE)
-                memcpy(s + i * (bits/CHAR_BIT), q + j * (bits/CHAR_BIT), (bits/CHAR_BIT));
-              else
-                memcpy(q + j * (bits/CHAR_BIT), s + i * (bits/CHAR_BIT), (bits/CHAR_BIT));
-            }
-          }
+          if (mode == PIDX_WRITE)
+            memset(b, 0, bytes);
+          continue;
         }
-        s += cbz * (bits/CHAR_BIT);
+
+        unsigned char* p = patch + (zz * plane + yy * row + (uint64_t)xx * vps) * bytes;
+        if (mode == PIDX_WRITE)
+          memcpy(b, p, bytes);
+        else
+          memcpy(p, b, bytes);
+      }
+    }
+  }
+}
+
+
+
+// Moves one component of a patch (size samples, vps interleaved components of bytes each) to or from the
+// chunked buffer. Bricks of chunk_size samples are stored x fastest, brick_stride bytes apart, and a brick
+// holds its samples x fastest. The patch is padded to whole bricks.
+static void chunk_component(unsigned char* patch, unsigned char* chunked, int bytes, int vps, uint64_t* size, uint64_t* chunk_size, uint64_t brick_stride, int mode)
+{
+  int c[PIDX_MAX_DIMENSIONS];
+  uint64_t brick_count[PIDX_MAX_DIMENSIONS];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    c[d] = (int)chunk_size[d];
+    brick_count[d] = (size[d] + c[d] - 1) / c[d];
+  }
+
+  uint64_t row = size[0] * vps;
+  uint64_t plane = size[0] * size[1] * vps;
+
+  unsigned char* brick = chunked;
+  for (uint64_t bz = 0; bz < brick_count[2]; bz++)
+  {
+    for (uint64_t by = 0; by < brick_count[1]; by++)
+    {
+      for (uint64_t bx = 0; bx < brick_count[0]; bx++)
+      {
+        uint64_t x = bx * c[0];
+        uint64_t y = by * c[1];
+        uint64_t z = bz * c[2];
+        unsigned char* p = patch + ((z * size[1] + y) * size[0] + x) * vps * bytes;
+
+        int extent[PIDX_MAX_DIMENSIONS];
+        extent[0] = (x + c[0] <= size[0]) ? c[0] : (int)(size[0] - x);
+        extent[1] = (y + c[1] <= size[1]) ? c[1] : (int)(size[1] - y);
+        extent[2] = (z + c[2] <= size[2]) ? c[2] : (int)(size[2] - z);
+
+        int interior = (extent[0] == c[0] && extent[1] == c[1] && extent[2] == c[2]);
+        if (interior && bytes == 1)
+          chunk_brick_uint8_t(p, brick, c, row, plane, vps, mode);
+        else if (interior && bytes == 2)
+          chunk_brick_uint16_t(p, brick, c, row, plane, vps, mode);
+        else if (interior && bytes == 4)
+          chunk_brick_uint32_t(p, brick, c, row, plane, vps, mode);
+        else if (interior && bytes == 8)
+          chunk_brick_uint64_t(p, brick, c, row, plane, vps, mode);
+        else
+          chunk_boundary_brick(p, brick, c, extent, row, plane, bytes, vps, mode);
+
+        brick += brick_stride;
       }
     }
   }
@@ -208,8 +299,9 @@ PIDX_return_code PIDX_chunk(PIDX_chunk_id chunk_id, int MODE)
   if (var0->restructured_super_patch_count == 0)
     return PIDX_success;
 
-  // when no compression is used then chunking only involves copying the input buffer to the chunked buffer
-  if (chunk_id->idx->compression_type == PIDX_NO_COMPRESSION)
+  // when no compression is used (or blocks are compressed from raw samples at the aggregators) then chunking
+  // only involves copying the input buffer to the chunked buffer
+  if (chunk_id->idx->compression_type == PIDX_NO_COMPRESSION || chunk_id->idx->compression_type == PIDX_ZFP_BLOCK || chunk_id->idx->compression_type == PIDX_LOSSLESS_BLOCK || chunk_id->idx->compression_type == PIDX_PRECISION_BLOCK)
   {
     for (uint32_t v = chunk_id->first_index; v <= chunk_id->last_index; v++)
     {
@@ -229,9 +321,8 @@ PIDX_return_code PIDX_chunk(PIDX_chunk_id chunk_id, int MODE)
     return PIDX_success;
   }
 
-  // compute the intra compression block strides
+  // chunk shape, 4 along every axis of the dataset that is not flat
   uint64_t *chunk_size = chunk_id->idx->chunk_size;
-  uint64_t  cbz = chunk_size[0] * chunk_size[1] * chunk_size[2];
 
 
   // loop through all variables
@@ -260,55 +351,21 @@ PIDX_return_code PIDX_chunk(PIDX_chunk_id chunk_id, int MODE)
     int bits = 0;
     PIDX_get_datatype_details(var->type_name, &values_per_sample, &bits);
 
-    unsigned char *sdim = malloc(nx*ny*nz * (bits/CHAR_BIT));
-    unsigned char *op = malloc(nx*ny*nz * (bits/CHAR_BIT));
-
-    uint32_t k = 0;
-    uint64_t compval = in_patch->restructured_patch->size[0] * in_patch->restructured_patch->size[1] * in_patch->restructured_patch->size[2];
-    if (MODE == PIDX_WRITE)
-    {
-      for (uint32_t i = 0; i < values_per_sample; i++)
-      {
-        //memset(sdim, 0, nx*ny*nz * (bits/CHAR_BIT));
-        //memset(op, 0, nx*ny*nz * (bits/CHAR_BIT));
-
-        k = i;
-        for (uint32_t j = 0; j < nx*ny*nz; j++)
-        {
-          memcpy(sdim + j*(bits/CHAR_BIT), in_patch->restructured_patch->buffer + k* (bits/CHAR_BIT), (bits/CHAR_BIT));
-          k+=values_per_sample;
-        }
-
-        returnbuffer(sdim, op, cbz, nx, ny, nz, compval, bits, PIDX_WRITE);
-        memcpy(out_patch->restructured_patch->buffer + i * nx*ny*nz * (bits/CHAR_BIT), op, nx*ny*nz * (bits/CHAR_BIT));
-      }
-    }
-    else
+    // every component is picked out of the interleaved samples while the bricks are built. A chunk (one HZ
+    // sample) holds one brick per component, files before metadata version 6.2 keep every component in its
+    // own part of the chunked buffer instead
+    uint64_t brick_bytes = chunk_size[0] * chunk_size[1] * chunk_size[2] * (bits/CHAR_BIT);
+    uint64_t component_bytes = (uint64_t)nx * ny * nz * (bits/CHAR_BIT);
+    uint64_t component_offset = brick_bytes;
+    uint64_t brick_stride = brick_bytes * values_per_sample;
+    if (chunk_id->idx->chunk_component_planes == 1)
     {
-      k = 0;
-      for (uint32_t i = 0; i < values_per_sample; i++)
-      {
-        //memset(sdim, 0, nx*ny*nz * (bits/CHAR_BIT));
-        //memset(op, 0, nx*ny*nz * (bits/CHAR_BIT));
-
-        memcpy(op, out_patch->restructured_patch->buffer + i * nx*ny*nz * (bits/CHAR_BIT), nx*ny*nz * (bits/CHAR_BIT));
-        returnbuffer(sdim, op, cbz, nx, ny, nz, compval, bits, PIDX_READ);
-
-        k = i;
-        for (uint32_t j = 0; j < nx*ny*nz; j++)
-        {
-          //double x;
-          //memcpy(&x, sdim + j*(bits/CHAR_BIT), sizeof(double));
-          //printf("vlue = %f\n", x);
-
-          memcpy(in_patch->restructured_patch->buffer + (k)*(bits/CHAR_BIT), sdim + j*(bits/CHAR_BIT), (bits/CHAR_BIT));
-          k+=values_per_sample;
-        }
-      }
+      component_offset = component_bytes;
+      brick_stride = brick_bytes;
     }
 
-    free(sdim);
-    free(op);
+    for (int i = 0; i < values_per_sample; i++)
+      chunk_component(in_patch->restructured_patch->buffer + i * (bits/CHAR_BIT), out_patch->restructured_patch->buffer + i * component_offset, bits/CHAR_BIT, values_per_sample, in_patch->restructured_patch->size, chunk_size, brick_stride, MODE);
   }
 
   return PIDX_success;
@@ -67,7 +67,245 @@ struct PIDX_comp_id_struct
   int first_index;
   int last_index;
 
+  // scratch arena shared by all the compression calls made with this id, it only grows
+  unsigned char* scratch;
+  uint64_t scratch_size;
+
+  // second arena for the temporary storage of the block codecs when decoding, the block being decoded
+  // may sit in the scratch arena
+  unsigned char* workspace;
+  uint64_t workspace_size;
+
+};
+
+
+static unsigned char* arena_reserve(unsigned char** arena, uint64_t* arena_size, uint64_t bytes)
+{
+  if (bytes > *arena_size)
+  {
+    unsigned char* temp_buffer = realloc(*arena, bytes);
+    if (temp_buffer == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return NULL;
+    }
+    *arena = temp_buffer;
+    *arena_size = bytes;
+  }
+
+  return *arena;
+}
+
+
+static unsigned char* scratch_reserve(PIDX_comp_id comp_id, uint64_t bytes)
+{
+  return arena_reserve(&comp_id->scratch, &comp_id->scratch_size, bytes);
+}
+
+
+static int get_zfp_type(char* base_type, int bps, zfp_type* type)
+{
+  if (strcmp(base_type, "int") == 0)
+    *type = bps == 32/CHAR_BIT ? zfp_type_int32 : zfp_type_int64;
+  else if (strcmp(base_type, "float") == 0)
+    *type = bps == 32/CHAR_BIT ? zfp_type_float : zfp_type_double;
+  else
+    return PIDX_err_compress;
+
+  return PIDX_success;
+}
+
+
+// encodes one chunk as a 1D (4 samples), 2D (4x4 samples) or 3D (4x4x4 samples) zfp block
+static uint encode_one_chunk(zfp_stream* zfp, zfp_type type, int dims, unsigned char* chunk)
+{
+  switch (type) {
+  case zfp_type_float:
+    if (dims == 1)
+      return zfp_encode_block_float_1(zfp, (float*)chunk);
+    else if (dims == 2)
+      return zfp_encode_block_float_2(zfp, (float*)chunk);
+    else
+      return zfp_encode_block_float_3(zfp, (float*)chunk);
+  case zfp_type_double:
+    if (dims == 1)
+      return zfp_encode_block_double_1(zfp, (double*)chunk);
+    else if (dims == 2)
+      return zfp_encode_block_double_2(zfp, (double*)chunk);
+    else
+      return zfp_encode_block_double_3(zfp, (double*)chunk);
+  case zfp_type_int32:
+    if (dims == 1)
+      return zfp_encode_block_int32_1(zfp, (const int32*)chunk);
+    else if (dims == 2)
+      return zfp_encode_block_int32_2(zfp, (const int32*)chunk);
+    else
+      return zfp_encode_block_int32_3(zfp, (const int32*)chunk);
+  case zfp_type_int64:
+    if (dims == 1)
+      return zfp_encode_block_int64_1(zfp, (const int64*)chunk);
+    else if (dims == 2)
+      return zfp_encode_block_int64_2(zfp, (const int64*)chunk);
+    else
+      return zfp_encode_block_int64_3(zfp, (const int64*)chunk);
+  default:
+    assert(0);
+    return 0;
+  }
+}
+
+
+static uint decode_one_chunk(zfp_stream* zfp, zfp_type type, int dims, unsigned char* chunk)
+{
+  switch (type) {
+  case zfp_type_float:
+    if (dims == 1)
+      return zfp_decode_block_float_1(zfp, (float*)chunk);
+    else if (dims == 2)
+      return zfp_decode_block_float_2(zfp, (float*)chunk);
+    else
+      return zfp_decode_block_float_3(zfp, (float*)chunk);
+  case zfp_type_double:
+    if (dims == 1)
+      return zfp_decode_block_double_1(zfp, (double*)chunk);
+    else if (dims == 2)
+      return zfp_decode_block_double_2(zfp, (double*)chunk);
+    else
+      return zfp_decode_block_double_3(zfp, (double*)chunk);
+  case zfp_type_int32:
+    if (dims == 1)
+      return zfp_decode_block_int32_1(zfp, (int32*)chunk);
+    else if (dims == 2)
+      return zfp_decode_block_int32_2(zfp, (int32*)chunk);
+    else
+      return zfp_decode_block_int32_3(zfp, (int32*)chunk);
+  case zfp_type_int64:
+    if (dims == 1)
+      return zfp_decode_block_int64_1(zfp, (int64*)chunk);
+    else if (dims == 2)
+      return zfp_decode_block_int64_2(zfp, (int64*)chunk);
+    else
+      return zfp_decode_block_int64_3(zfp, (int64*)chunk);
+  default:
+    assert(0);
+    return 0;
+  }
+}
+
+
+// Number of dimensions of the zfp blocks for the chunk shape of the dataset. The sides of a chunk are 4 or 1,
+// the zfp block is made of the sides of 4 (4x4x1 is a 2D block, 4x1x1 a 1D block). Chunks of a single sample
+// (no chunking) are cut into 1D blocks of 4 consecutive samples.
+static PIDX_return_code zfp_chunk_dims(idx_dataset idx, int* dims)
+{
+  *dims = 0;
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    if (idx->chunk_size[d] == 4)
+      (*dims)++;
+    else if (idx->chunk_size[d] != 1)
+    {
+      fprintf(stderr, "[%s] [%d] zfp can not compress chunks of %lld samples along axis %d\n", __FILE__, __LINE__, (long long)idx->chunk_size[d], d);
+      return PIDX_err_compress;
+    }
+  }
+
+  if (*dims == 0)
+    *dims = 1;
+
+  return PIDX_success;
+}
+
+
+// encodes consecutive chunks of chunk_bytes each, returns the number of bits written to the stream
+static uint64_t encode_chunks(zfp_stream* zfp, zfp_type type, int dims, unsigned char* buffer, uint64_t bytes, uint64_t chunk_bytes)
+{
+  uint64_t total_bits = 0;
+
+  for (uint64_t i = 0; i < bytes; i += chunk_bytes)
+    total_bits += encode_one_chunk(zfp, type, dims, buffer + i);
+
+  return total_bits;
+}
+
+
+// decodes consecutive chunks of chunk_bytes each, returns the number of bits read from the stream
+static uint64_t decode_chunks(zfp_stream* zfp, zfp_type type, int dims, unsigned char* buffer, uint64_t bytes, uint64_t chunk_bytes)
+{
+  uint64_t total_bits = 0;
+
+  for (uint64_t i = 0; i < bytes; i += chunk_bytes)
+    total_bits += decode_one_chunk(zfp, type, dims, buffer + i);
+
+  return total_bits;
+}
+
+
+// With fixed rate every chunk takes exactly bits_per_chunk bits, so chunk i starts at bit i * bits_per_chunk
+// and the chunks are split among threads, each with its own zfp_stream and bitstream.
+struct fixed_rate_task_struct
+{
+  zfp_type type;
+  int dims;
+  float bit_rate;
+  int decode;
+
+  unsigned char* data;
+  unsigned char* stream_buffer;
+  uint64_t stream_bytes;
+
+  uint64_t chunk_bytes;
+  uint64_t chunk_count;
+  uint64_t chunks_per_task;
+  uint64_t bits_per_chunk;
 };
+typedef struct fixed_rate_task_struct* fixed_rate_task;
+
+
+static PIDX_return_code fixed_rate_chunks(void* context, uint64_t task_index)
+{
+  fixed_rate_task t = context;
+  uint64_t from = task_index * t->chunks_per_task;
+  uint64_t to = (from + t->chunks_per_task < t->chunk_count) ? from + t->chunks_per_task : t->chunk_count;
+
+  zfp_stream* zfp = zfp_stream_open(NULL);
+  zfp_stream_set_rate(zfp, t->bit_rate, t->type, t->dims, 0);
+  bitstream* stream = stream_open(t->stream_buffer, t->stream_bytes);
+  zfp_stream_set_bit_stream(zfp, stream);
+
+  if (t->decode == 1)
+  {
+    stream_rseek(stream, from * t->bits_per_chunk);
+    decode_chunks(zfp, t->type, t->dims, t->data + from * t->chunk_bytes, (to - from) * t->chunk_bytes, t->chunk_bytes);
+  }
+  else
+  {
+    stream_wseek(stream, from * t->bits_per_chunk);
+    encode_chunks(zfp, t->type, t->dims, t->data + from * t->chunk_bytes, (to - from) * t->chunk_bytes, t->chunk_bytes);
+    stream_flush(stream);
+  }
+
+  stream_close(stream);
+  zfp_stream_close(zfp);
+
+  return PIDX_success;
+}
+
+
+static PIDX_return_code run_fixed_rate_tasks(PIDX_comp_id comp_id, fixed_rate_task t)
+{
+  int thread_count = (comp_id->idx->compression_thread_count > 0) ? comp_id->idx->compression_thread_count : 1;
+
+  // a few tasks per thread; the first chunk of a task must start on a 64 bit word of the stream,
+  // otherwise two threads would write to the same word
+  uint64_t chunks_per_task = (t->chunk_count + 4 * thread_count - 1) / (4 * thread_count);
+  chunks_per_task = ((chunks_per_task + 63) / 64) * 64;
+  t->chunks_per_task = chunks_per_task;
+
+  uint64_t task_count = (t->chunk_count + chunks_per_task - 1) / chunks_per_task;
+
+  return PIDX_thread_pool_run(thread_count, task_count, fixed_rate_chunks, t);
+}
 
 
 int compress_buffer(PIDX_comp_id comp_id, unsigned char* buffer, int nx, int ny, int nz, char* base_type, int bps, int vps, float bit_rate)
@@ -76,65 +314,54 @@ int compress_buffer(PIDX_comp_id comp_id, unsigned char* buffer, int nx, int ny,
 
   if (comp_id->idx->compression_type == PIDX_CHUNKING_ZFP)
   {
-    uint64_t* chunk_dim = comp_id->idx->chunk_size;
-    assert(chunk_dim[0] == 4 && chunk_dim[1] == 4 && chunk_dim[2] == 4);
-    uint64_t total_chunk_dim = (uint64_t)chunk_dim[0] * (uint64_t)chunk_dim[1] * (uint64_t)chunk_dim[2];
-    //uint64_t chunk_bytes = total_chunk_dim * bytes_per_sample;
-    //zfp_type type = (bytes_per_sample == 4) ? zfp_type_float : zfp_type_double;
-
-    uint64_t chunk_bytes = total_chunk_dim * bps;
-    zfp_type type;
-    if (strcmp(base_type, "int") == 0) {
-      type = bps == 32/CHAR_BIT ? zfp_type_int32 : zfp_type_int64;
-    }
-    else if (strcmp(base_type, "float") == 0) {
-      type = bps == 32/CHAR_BIT ? zfp_type_float : zfp_type_double;
-    }
-    else {
+    struct fixed_rate_task_struct t;
+    memset(&t, 0, sizeof(t));
+    if (get_zfp_type(base_type, bps, &t.type) != PIDX_success)
       assert(0);
-    }
+    if (zfp_chunk_dims(comp_id->idx, &t.dims) != PIDX_success)
+      return -1;
 
-    zfp_field* field = zfp_field_3d(NULL, type, nx, ny, nz);
     zfp_stream* zfp = zfp_stream_open(NULL);
-    zfp_stream_set_rate(zfp, bit_rate, type, 3, 0);
-    uint64_t bytes_max = zfp_stream_maximum_size(zfp, field);
-    bytes_max = bytes_max * vps;
-
-    unsigned char* output = malloc(bytes_max);
-    bitstream* stream = stream_open(output, bytes_max);
-    zfp_stream_set_bit_stream(zfp, stream);
-    uint64_t i = 0;
+    zfp_stream_set_rate(zfp, bit_rate, t.type, t.dims, 0);
+
     uint64_t length = (uint64_t)nx * (uint64_t)ny * (uint64_t)nz;
+    t.bit_rate = bit_rate;
+    t.data = buffer;
+    t.chunk_bytes = ((uint64_t)1 << (2 * t.dims)) * bps;
+    t.chunk_count = (length * bps * vps) / t.chunk_bytes;
+    t.bits_per_chunk = zfp->maxbits;
+    zfp_stream_close(zfp);
 
-    for (i = 0; i < length * bps * vps; i += chunk_bytes)
+    // the stream replaces the samples in the chunked buffer, PIDX_set_lossy_compression_bit_rate keeps the rate below the sample size
+    if (t.bits_per_chunk > t.chunk_bytes * CHAR_BIT)
     {
-      uint64_t bits = 0;
-      switch (type) {
-      case zfp_type_float:
-        bits = zfp_encode_block_float_3(zfp, (float*)(buffer + i));
-        break;
-      case zfp_type_double:
-        bits = zfp_encode_block_double_3(zfp, (double*)(buffer + i));
-        break;
-      case zfp_type_int32:
-        bits = zfp_encode_block_int32_3(zfp, (const int32*)(buffer + i));
-        break;
-      case zfp_type_int64:
-        bits = zfp_encode_block_int64_3(zfp, (const int64*)(buffer + i));
-        break;
-      default:
-        assert(0);
-        break;
-      }
-
-      assert(bits % CHAR_BIT == 0);
-      total_bytes += bits / CHAR_BIT;
+      fprintf(stderr, "[%s] [%d] bit rate %f is above the %d bits of a value.\n", __FILE__, __LINE__, bit_rate, bps * CHAR_BIT);
+      return -1;
     }
-    memcpy(buffer, output, total_bytes);
-    free(output);
-    zfp_stream_close(zfp);
-    stream_close(stream);
-    zfp_field_free(field);
+
+    uint64_t bits = t.chunk_count * t.bits_per_chunk;
+    assert(bits % CHAR_BIT == 0);
+    total_bytes = bits / CHAR_BIT;
+    t.stream_bytes = total_bytes;
+
+    // A single pass can encode in place: chunk i is read from i * chunk_bytes before its bits land at
+    // i * bits_per_chunk, which never gets ahead of the input. Threads run out of order and go through
+    // the scratch arena instead, with one copy of the compressed bytes.
+    int thread_count = (comp_id->idx->compression_thread_count > 0) ? comp_id->idx->compression_thread_count : 1;
+    if (thread_count == 1 || t.chunk_count <= 64)
+      t.stream_buffer = buffer;
+    else
+    {
+      t.stream_buffer = scratch_reserve(comp_id, total_bytes);
+      if (t.stream_buffer == NULL)
+        return -1;
+    }
+
+    if (run_fixed_rate_tasks(comp_id, &t) != PIDX_success)
+      assert(0);
+
+    if (t.stream_buffer != buffer)
+      memcpy(buffer, t.stream_buffer, total_bytes);
   }
 
   return total_bytes;
@@ -147,73 +374,40 @@ int decompress_buffer(PIDX_comp_id comp_id, unsigned char** buffer, int nx, int
 
    if (comp_id->idx->compression_type == PIDX_CHUNKING_ZFP)
    {
-     uint64_t* chunk_dim = comp_id->idx->chunk_size;
-     assert(chunk_dim[0] == 4 && chunk_dim[1] == 4 && chunk_dim[2] == 4);
-     uint64_t total_chunk_dim = (uint64_t)chunk_dim[0] * (uint64_t)chunk_dim[1] * (uint64_t)chunk_dim[2];
-
-     //uint64_t chunk_bytes = total_chunk_dim * bytes_per_sample;
-     //zfp_type type = (bytes_per_sample == 4) ? zfp_type_float : zfp_type_double;
-
-     uint64_t chunk_bytes = total_chunk_dim * bps;
-     zfp_type type;
-     if (strcmp(base_type, "int") == 0) {
-       type = bps == 32/CHAR_BIT ? zfp_type_int32 : zfp_type_int64;
-     }
-     else if (strcmp(base_type, "float") == 0) {
-       type = bps == 32/CHAR_BIT ? zfp_type_float : zfp_type_double;
-     }
-     else {
+     struct fixed_rate_task_struct t;
+     memset(&t, 0, sizeof(t));
+     if (get_zfp_type(base_type, bps, &t.type) != PIDX_success)
        assert(0);
-     }
+     if (zfp_chunk_dims(comp_id->idx, &t.dims) != PIDX_success)
+       return -1;
 
      zfp_stream* zfp = zfp_stream_open(NULL);
-     zfp_stream_set_rate(zfp, bit_rate, type, 3, 0);
+     zfp_stream_set_rate(zfp, bit_rate, t.type, t.dims, 0);
 
-     unsigned char* temp_buffer = malloc(nx * ny * nz * bps * vps);
-     int compression_factor = bps*8/comp_id->idx->compression_bit_rate;
-     bitstream* stream = stream_open(*buffer, (nx * ny * nz * bps * vps) / compression_factor);
-     zfp_stream_set_bit_stream(zfp, stream);
-     uint64_t i = 0;
      uint64_t length = (uint64_t)nx * (uint64_t)ny * (uint64_t)nz;
 
-     for (i = 0; i < length * bps * vps; i += chunk_bytes)
-     {
-       uint64_t bits = 0;
-       switch (type) {
-       case zfp_type_float:
-         bits = zfp_decode_block_float_3(zfp, (const float*)(temp_buffer + i));
-         break;
-       case zfp_type_double:
-         bits = zfp_decode_block_double_3(zfp, (const double*)(temp_buffer + i));
-         break;
-       case zfp_type_int32:
-         bits = zfp_decode_block_int32_3(zfp, (const int32*)(temp_buffer + i));
-         break;
-       case zfp_type_int64:
-         bits = zfp_decode_block_int64_3(zfp, (const int64*)(temp_buffer + i));
-         break;
-       default:
-         assert(0);
-         break;
-       }
-
-       assert(bits % CHAR_BIT == 0);
-       total_bytes += bits / CHAR_BIT;
-     }
-
-     unsigned char *temp_buffer2 = realloc(*buffer, nx * ny * nz * bps * vps);
-     if (temp_buffer2 == NULL)
-     {
-       fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
-       return PIDX_err_rst;
-     }
-     else
-       *buffer = temp_buffer2;
-     memcpy(*buffer, temp_buffer, nx * ny * nz * bps * vps);
-
-     free(temp_buffer);
+     t.bit_rate = bit_rate;
+     t.decode = 1;
+     t.data = *buffer;
+     t.chunk_bytes = ((uint64_t)1 << (2 * t.dims)) * bps;
+     t.chunk_count = (length * bps * vps) / t.chunk_bytes;
+     t.bits_per_chunk = zfp->maxbits;
      zfp_stream_close(zfp);
-     stream_close(stream);
+
+     uint64_t bits = t.chunk_count * t.bits_per_chunk;
+     assert(bits % CHAR_BIT == 0);
+     total_bytes = bits / CHAR_BIT;
+
+     // the chunked buffer is already sized for the decoded samples and holds the stream at its front,
+     // only the compressed bytes move to the scratch arena so that the samples can be decoded in place
+     t.stream_bytes = total_bytes;
+     t.stream_buffer = scratch_reserve(comp_id, total_bytes);
+     if (t.stream_buffer == NULL)
+       return -1;
+     memcpy(t.stream_buffer, *buffer, total_bytes);
+
+     if (run_fixed_rate_tasks(comp_id, &t) != PIDX_success)
+       assert(0);
    }
 
    return total_bytes;
@@ -263,12 +457,10 @@ PIDX_return_code PIDX_compression(PIDX_comp_id comp_id)
       //PIDX_get_datatype_details(var->type_name, &values, &bits);
 
 
-      size_t compressed_bytes = compress_buffer(comp_id, buffer, nx, ny, nz, base_type, bits/CHAR_BIT, ncomps, bit_rate);
-      unsigned char* temp_buffer = realloc(patch->buffer, compressed_bytes);
-      if (temp_buffer == NULL)
+      // the stream is left at the front of the chunked buffer, which keeps its size until PIDX_chunk_buf_destroy
+      int ret = compress_buffer(comp_id, buffer, nx, ny, nz, base_type, bits/CHAR_BIT, ncomps, bit_rate);
+      if (ret == -1)
         return PIDX_err_compress;
-      else
-        patch->buffer = temp_buffer;
     }
   }
 
@@ -308,8 +500,610 @@ PIDX_return_code PIDX_decompression(PIDX_comp_id comp_id)
   return PIDX_success;
 }
 
+// A block codec compresses one IDX block on its own at the aggregator, the compression type picks the codec.
+// max_bytes is a bound on the compressed size of a block of block_bytes bytes, workspace_bytes the temporary
+// storage compress and decompress get (none when NULL). read_bytes is the prefix of a stored block a read
+// needs, the whole block when NULL.
+struct block_codec_struct
+{
+  int compression_type;
+
+  PIDX_return_code (*max_bytes)(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t* bytes_max);
+  uint64_t (*workspace_bytes)(uint64_t block_bytes);
+  PIDX_return_code (*compress)(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* block, uint64_t block_bytes, unsigned char* workspace, unsigned char* output, uint64_t output_bytes, uint64_t* compressed_bytes);
+  PIDX_return_code (*decompress)(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* block, uint64_t block_bytes);
+  uint64_t (*read_bytes)(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t stored_bytes);
+};
+typedef const struct block_codec_struct* block_codec;
+
+
+// compression settings a variable is written with, its own ones or the ones of the file
+struct var_compression_struct
+{
+  int type;
+  int mode;
+  float bit_rate;
+  double tolerance;
+  int precision;
+};
+
+
+static void get_var_compression(idx_dataset idx, PIDX_variable var, struct var_compression_struct* c)
+{
+  if (var->compression_override)
+  {
+    c->type = var->compression_type;
+    c->mode = var->compression_mode;
+    c->bit_rate = var->compression_bit_rate;
+    c->tolerance = var->compression_tolerance;
+    c->precision = var->compression_precision;
+  }
+  else
+  {
+    c->type = idx->compression_type;
+    c->mode = idx->compression_mode;
+    c->bit_rate = idx->compression_bit_rate;
+    c->tolerance = idx->compression_tolerance;
+    c->precision = idx->compression_precision;
+  }
+}
+
+
+// opens a zfp stream with the settings of the variable, every chunk is one zfp block (see zfp_chunk_dims)
+// of one component, ncomps is the number of components interleaved in the block
+static PIDX_return_code zfp_block_stream_open(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, zfp_stream** zfp, zfp_type* type, int* dims, uint64_t* chunk_bytes, int* ncomps)
+{
+  int bits = 0;
+  char base_type[10];
+  PIDX_decompose_type(var->type_name, base_type, ncomps, &bits);
+
+  // chunked blocks already hold one component per brick, only raw samples interleave them
+  if (comp_id->idx->compression_type == PIDX_CHUNKING_ZFP_BLOCK)
+    *ncomps = 1;
+
+  if (get_zfp_type(base_type, bits/CHAR_BIT, type) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  if (zfp_chunk_dims(comp_id->idx, dims) != PIDX_success)
+    return PIDX_err_compress;
+  *chunk_bytes = ((uint64_t)1 << (2 * *dims)) * (bits/CHAR_BIT);
+
+  if (*ncomps <= 0 || block_bytes % (*chunk_bytes * *ncomps) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] blocks of %lld bytes can not be cut into zfp blocks\n", __FILE__, __LINE__, (long long)block_bytes);
+    return PIDX_err_compress;
+  }
+
+  struct var_compression_struct c;
+  get_var_compression(comp_id->idx, var, &c);
+
+  // zfp has no fixed accuracy mode for integers
+  if (c.mode == PIDX_ZFP_FIXED_ACCURACY && (*type == zfp_type_int32 || *type == zfp_type_int64))
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  if (c.mode == PIDX_ZFP_FIXED_RATE && c.bit_rate <= 0)
+  {
+    fprintf(stderr, "[%s] [%d] no bit rate for variable %s\n", __FILE__, __LINE__, var->var_name);
+    return PIDX_err_compress;
+  }
+
+  *zfp = zfp_stream_open(NULL);
+  if (c.mode == PIDX_ZFP_FIXED_ACCURACY)
+    zfp_stream_set_accuracy(*zfp, c.tolerance);
+  else if (c.mode == PIDX_ZFP_FIXED_PRECISION)
+    zfp_stream_set_precision(*zfp, c.precision);
+  else
+    zfp_stream_set_rate(*zfp, c.bit_rate, *type, *dims, 0);
+
+  return PIDX_success;
+}
+
+
+static PIDX_return_code zfp_block_max_bytes(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t* bytes_max)
+{
+  zfp_stream* zfp;
+  zfp_type type;
+  int dims;
+  uint64_t chunk_bytes;
+  int ncomps;
+  if (zfp_block_stream_open(comp_id, var, block_bytes, &zfp, &type, &dims, &chunk_bytes, &ncomps) != PIDX_success)
+    return PIDX_err_compress;
+
+  // the chunks of a block are encoded one after the other, as a field of stacked chunks, the components
+  // one after the other within the same stream
+  zfp_field* field;
+  if (dims == 1)
+    field = zfp_field_1d(NULL, type, 4 * (block_bytes / chunk_bytes));
+  else if (dims == 2)
+    field = zfp_field_2d(NULL, type, 4, 4 * (block_bytes / chunk_bytes));
+  else
+    field = zfp_field_3d(NULL, type, 4, 4, 4 * (block_bytes / chunk_bytes));
+  *bytes_max = zfp_stream_maximum_size(zfp, field);
+
+  zfp_field_free(field);
+  zfp_stream_close(zfp);
+
+  return PIDX_success;
+}
+
+
+static uint64_t zfp_block_workspace_bytes(uint64_t block_bytes)
+{
+  return block_bytes;
+}
+
+
+// zfp decorrelates neighbouring values, so the interleaved components of a block are moved to one plane per
+// component first (plane c holds component c of every sample) and merged back after decoding
+static void split_components(const unsigned char* block, uint64_t block_bytes, int ncomps, uint64_t comp_bytes, unsigned char* planes)
+{
+  uint64_t count = block_bytes / (ncomps * comp_bytes);
+  for (int c = 0; c < ncomps; c++)
+  {
+    unsigned char* plane = planes + c * count * comp_bytes;
+    for (uint64_t i = 0; i < count; i++)
+      memcpy(plane + i * comp_bytes, block + (i * ncomps + c) * comp_bytes, comp_bytes);
+  }
+}
+
+
+static void merge_components(const unsigned char* planes, uint64_t block_bytes, int ncomps, uint64_t comp_bytes, unsigned char* block)
+{
+  uint64_t count = block_bytes / (ncomps * comp_bytes);
+  for (int c = 0; c < ncomps; c++)
+  {
+    const unsigned char* plane = planes + c * count * comp_bytes;
+    for (uint64_t i = 0; i < count; i++)
+      memcpy(block + (i * ncomps + c) * comp_bytes, plane + i * comp_bytes, comp_bytes);
+  }
+}
+
+
+static PIDX_return_code zfp_block_compress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* block, uint64_t block_bytes, unsigned char* workspace, unsigned char* output, uint64_t output_bytes, uint64_t* compressed_bytes)
+{
+  zfp_stream* zfp;
+  zfp_type type;
+  int dims;
+  uint64_t chunk_bytes;
+  int ncomps;
+  if (zfp_block_stream_open(comp_id, var, block_bytes, &zfp, &type, &dims, &chunk_bytes, &ncomps) != PIDX_success)
+    return PIDX_err_compress;
+
+  bitstream* stream = stream_open(output, output_bytes);
+  zfp_stream_set_bit_stream(zfp, stream);
+  zfp_stream_rewind(zfp);
+
+  unsigned char* planes = block;
+  if (ncomps > 1)
+  {
+    split_components(block, block_bytes, ncomps, chunk_bytes >> (2 * dims), workspace);
+    planes = workspace;
+  }
+
+  encode_chunks(zfp, type, dims, planes, block_bytes, chunk_bytes);
+  zfp_stream_flush(zfp);
+  *compressed_bytes = stream_size(stream);
+
+  stream_close(stream);
+  zfp_stream_close(zfp);
+
+  return PIDX_success;
+}
+
+
+static PIDX_return_code zfp_block_decompress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* block, uint64_t block_bytes)
+{
+  zfp_stream* zfp;
+  zfp_type type;
+  int dims;
+  uint64_t chunk_bytes;
+  int ncomps;
+  if (zfp_block_stream_open(comp_id, var, block_bytes, &zfp, &type, &dims, &chunk_bytes, &ncomps) != PIDX_success)
+    return PIDX_err_compress;
+
+  bitstream* stream = stream_open(compressed, compressed_bytes);
+  zfp_stream_set_bit_stream(zfp, stream);
+  zfp_stream_rewind(zfp);
+
+  decode_chunks(zfp, type, dims, (ncomps > 1) ? workspace : block, block_bytes, chunk_bytes);
+  if (ncomps > 1)
+    merge_components(workspace, block_bytes, ncomps, chunk_bytes >> (2 * dims), block);
+
+  stream_close(stream);
+  zfp_stream_close(zfp);
+
+  return PIDX_success;
+}
+
+
+static PIDX_return_code lossless_block_max_bytes(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t* bytes_max)
+{
+  *bytes_max = PIDX_lossless_max_bytes(block_bytes);
+  return PIDX_success;
+}
+
+
+static uint64_t lossless_block_workspace_bytes(uint64_t block_bytes)
+{
+  return block_bytes;
+}
+
+
+// integers are predicted by their difference with the previous sample, floats by the XOR of their bits
+static PIDX_return_code lossless_block_compress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* block, uint64_t block_bytes, unsigned char* workspace, unsigned char* output, uint64_t output_bytes, uint64_t* compressed_bytes)
+{
+  int ncomps = 0;
+  int bits = 0;
+  char base_type[10];
+  if (PIDX_decompose_type(var->type_name, base_type, &ncomps, &bits) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  int filter = (strcmp(base_type, "float") == 0) ? PIDX_LOSSLESS_XOR : PIDX_LOSSLESS_DELTA;
+
+  return PIDX_lossless_compress(block, block_bytes, bits/CHAR_BIT, ncomps, filter, workspace, output, compressed_bytes);
+}
+
+
+static PIDX_return_code lossless_block_decompress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* block, uint64_t block_bytes)
+{
+  return PIDX_lossless_decompress(compressed, compressed_bytes, workspace, block, block_bytes);
+}
+
+
+// variables written without compression in a block compressed file keep the per block layout
+static PIDX_return_code stored_block_max_bytes(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t* bytes_max)
+{
+  *bytes_max = block_bytes;
+  return PIDX_success;
+}
+
+
+static PIDX_return_code stored_block_compress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* block, uint64_t block_bytes, unsigned char* workspace, unsigned char* output, uint64_t output_bytes, uint64_t* compressed_bytes)
+{
+  memcpy(output, block, block_bytes);
+  *compressed_bytes = block_bytes;
+  return PIDX_success;
+}
+
+
+static PIDX_return_code stored_block_decompress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* block, uint64_t block_bytes)
+{
+  if (compressed_bytes != block_bytes)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  memcpy(block, compressed, block_bytes);
+  return PIDX_success;
+}
+
+
+// Precision blocks hold the byte planes of the block, most significant first: plane t has byte t (by significance)
+// of every value. The first planes are a coarse version of the block (sign, exponent and high mantissa bits
+// for floats), so a read can stop after any plane and fill the others with zeros.
+static int precision_element_bytes(PIDX_variable var)
+{
+  int ncomps = 0;
+  int bits = 0;
+  char base_type[10];
+  if (PIDX_decompose_type(var->type_name, base_type, &ncomps, &bits) != PIDX_success)
+    return 0;
+
+  return bits / CHAR_BIT;
+}
+
+
+// byte of a value in memory that holds its plane-th most significant byte
+static int precision_plane_byte(int plane, int element_bytes)
+{
+  const uint16_t one = 1;
+  int little_endian = (*(const unsigned char*)&one == 1);
+
+  return little_endian ? element_bytes - 1 - plane : plane;
+}
+
+
+static PIDX_return_code precision_block_max_bytes(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t* bytes_max)
+{
+  *bytes_max = block_bytes;
+  return PIDX_success;
+}
+
+
+static PIDX_return_code precision_block_compress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* block, uint64_t block_bytes, unsigned char* workspace, unsigned char* output, uint64_t output_bytes, uint64_t* compressed_bytes)
+{
+  int element_bytes = precision_element_bytes(var);
+  if (element_bytes == 0 || block_bytes % element_bytes != 0)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  uint64_t count = block_bytes / element_bytes;
+  for (int t = 0; t < element_bytes; t++)
+  {
+    const unsigned char* value = block + precision_plane_byte(t, element_bytes);
+    unsigned char* plane = output + t * count;
+    for (uint64_t i = 0; i < count; i++)
+      plane[i] = value[i * element_bytes];
+  }
+  *compressed_bytes = block_bytes;
+
+  return PIDX_success;
+}
+
+
+// compressed_bytes is a whole number of planes, the planes that were not read are zeros
+static PIDX_return_code precision_block_decompress(PIDX_comp_id comp_id, PIDX_variable var, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* block, uint64_t block_bytes)
+{
+  int element_bytes = precision_element_bytes(var);
+  if (element_bytes == 0 || block_bytes % element_bytes != 0)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  uint64_t count = block_bytes / element_bytes;
+  if (compressed_bytes % count != 0 || compressed_bytes > block_bytes)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  int plane_count = compressed_bytes / count;
+  if (plane_count < element_bytes)
+    memset(block, 0, block_bytes);
+
+  for (int t = 0; t < plane_count; t++)
+  {
+    unsigned char* value = block + precision_plane_byte(t, element_bytes);
+    const unsigned char* plane = compressed + t * count;
+    for (uint64_t i = 0; i < count; i++)
+      value[i * element_bytes] = plane[i];
+  }
+
+  return PIDX_success;
+}
+
+
+static uint64_t precision_block_read_bytes(PIDX_comp_id comp_id, PIDX_variable var, uint64_t block_bytes, uint64_t stored_bytes)
+{
+  int element_bytes = precision_element_bytes(var);
+  int precision = comp_id->idx->read_precision;
+  if (precision <= 0 || element_bytes == 0 || precision >= element_bytes)
+    return stored_bytes;
+
+  return (uint64_t)precision * (block_bytes / element_bytes);
+}
+
+
+// not in the table below, a file is only a block container when its own type has a codec
+static const struct block_codec_struct stored_codec =
+{
+  PIDX_NO_COMPRESSION, stored_block_max_bytes, NULL, stored_block_compress, stored_block_decompress, NULL
+};
+
+
+static const struct block_codec_struct block_codecs[] =
+{
+  {PIDX_CHUNKING_ZFP_BLOCK, zfp_block_max_bytes, zfp_block_workspace_bytes, zfp_block_compress, zfp_block_decompress, NULL},
+  {PIDX_ZFP_BLOCK, zfp_block_max_bytes, zfp_block_workspace_bytes, zfp_block_compress, zfp_block_decompress, NULL},
+  {PIDX_LOSSLESS_BLOCK, lossless_block_max_bytes, lossless_block_workspace_bytes, lossless_block_compress, lossless_block_decompress, NULL},
+  {PIDX_PRECISION_BLOCK, precision_block_max_bytes, NULL, precision_block_compress, precision_block_decompress, precision_block_read_bytes},
+};
+
+
+static block_codec find_block_codec(int compression_type)
+{
+  for (uint32_t i = 0; i < sizeof(block_codecs) / sizeof(block_codecs[0]); i++)
+  {
+    if (block_codecs[i].compression_type == compression_type)
+      return &block_codecs[i];
+  }
+
+  return NULL;
+}
+
+
+// codec of a variable of a block compressed file
+static block_codec find_variable_codec(idx_dataset idx, PIDX_variable var)
+{
+  if (find_block_codec(idx->compression_type) == NULL)
+    return NULL;
+
+  struct var_compression_struct c;
+  get_var_compression(idx, var, &c);
+  if (c.type == PIDX_NO_COMPRESSION)
+    return &stored_codec;
+
+  return find_block_codec(c.type);
+}
+
+
+// bytes of one uncompressed IDX block of a variable
+static uint64_t block_bytes_of(idx_dataset idx, PIDX_variable var)
+{
+  uint64_t total_chunk_dim = (uint64_t)idx->chunk_size[0] * (uint64_t)idx->chunk_size[1] * (uint64_t)idx->chunk_size[2];
+  return (uint64_t)idx->samples_per_block * total_chunk_dim * (var->bpv/8) * var->vps;
+}
+
+
+
+int PIDX_compression_block_container(idx_dataset idx)
+{
+  return (find_block_codec(idx->compression_type) != NULL);
+}
+
+
+
+int PIDX_compression_variable_codec(int compression_type)
+{
+  return (compression_type == PIDX_NO_COMPRESSION || find_block_codec(compression_type) != NULL);
+}
+
+
+
+// the blocks of an aggregation buffer are independent streams, every task compresses one block into its own slot
+struct block_task_struct
+{
+  PIDX_comp_id comp_id;
+  PIDX_variable var;
+  block_codec codec;
+
+  unsigned char* input;
+  uint64_t block_bytes;
+  unsigned char* output;
+  uint64_t block_bytes_max;
+  uint64_t slot_bytes;
+  uint64_t* compressed_bytes;
+};
+typedef struct block_task_struct* block_task;
+
+
+static PIDX_return_code compress_block(void* context, uint64_t b)
+{
+  block_task t = context;
+
+  // a slot holds the compressed block followed by the workspace of the codec
+  unsigned char* slot = t->output + b * t->slot_bytes;
+  return t->codec->compress(t->comp_id, t->var, t->input + b * t->block_bytes, t->block_bytes, slot + t->block_bytes_max, slot, t->block_bytes_max, &t->compressed_bytes[b]);
+}
+
+
+
+PIDX_return_code PIDX_compression_compress_blocks(PIDX_comp_id comp_id, Agg_buffer ab, PIDX_block_layout layout)
+{
+  if (ab->var_number == -1 || ab->file_number == -1)
+    return PIDX_success;
+
+  PIDX_variable var = comp_id->idx->variable[ab->var_number];
+  block_codec codec = find_variable_codec(comp_id->idx, var);
+  if (codec == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+  int blocks_per_file = comp_id->idx->blocks_per_file;
+
+  struct block_task_struct t;
+  memset(&t, 0, sizeof(t));
+  t.comp_id = comp_id;
+  t.var = var;
+  t.codec = codec;
+  t.input = ab->buffer;
+  t.block_bytes = block_bytes_of(comp_id->idx, var);
+
+  // worst case size of one compressed block
+  if (codec->max_bytes(comp_id, var, t.block_bytes, &t.block_bytes_max) != PIDX_success)
+    return PIDX_err_compress;
+
+  t.slot_bytes = t.block_bytes_max;
+  if (codec->workspace_bytes != NULL)
+    t.slot_bytes = t.slot_bytes + codec->workspace_bytes(t.block_bytes);
+
+  uint64_t block_count = ab->buffer_size / t.block_bytes;
+
+  // one slot per block followed by the compressed sizes, all in the scratch arena
+  unsigned char* scratch = scratch_reserve(comp_id, block_count * (t.slot_bytes + sizeof(*t.compressed_bytes)));
+  if (scratch == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+  t.output = scratch;
+  t.compressed_bytes = (uint64_t*)(scratch + block_count * t.slot_bytes);
+
+  int thread_count = (comp_id->idx->compression_thread_count > 0) ? comp_id->idx->compression_thread_count : 1;
+  if (PIDX_thread_pool_run(thread_count, block_count, compress_block, &t) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+
+  ab->block_size = malloc(blocks_per_file * sizeof(*ab->block_size));
+  memset(ab->block_size, 0, blocks_per_file * sizeof(*ab->block_size));
+
+  // every block can be decoded on its own, they are packed back to back in block order into the
+  // aggregation buffer, which is sized for the raw samples and keeps its allocation
+  uint64_t total_bytes = 0;
+  uint64_t b = 0;
+  for (int i = 0; i < blocks_per_file; i++)
+  {
+    if (!PIDX_blocks_is_block_present(ab->file_number * blocks_per_file + i, comp_id->idx->bits_per_block, layout))
+      continue;
+
+    memcpy(ab->buffer + total_bytes, t.output + b * t.slot_bytes, t.compressed_bytes[b]);
+    ab->block_size[i] = t.compressed_bytes[b];
+    total_bytes = total_bytes + ab->block_size[i];
+    b++;
+  }
+  ab->buffer_size = total_bytes;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_compression_decompress_block(PIDX_comp_id comp_id, int var_index, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* block)
+{
+  PIDX_variable var = comp_id->idx->variable[var_index];
+  block_codec codec = find_variable_codec(comp_id->idx, var);
+  if (codec == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_compress;
+  }
+  uint64_t block_bytes = block_bytes_of(comp_id->idx, var);
+
+  unsigned char* workspace = NULL;
+  if (codec->workspace_bytes != NULL)
+  {
+    workspace = arena_reserve(&comp_id->workspace, &comp_id->workspace_size, codec->workspace_bytes(block_bytes));
+    if (workspace == NULL)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_compress;
+    }
+  }
+
+  return codec->decompress(comp_id, var, compressed, compressed_bytes, workspace, block, block_bytes);
+}
+
+
+
+uint64_t PIDX_compression_block_read_bytes(PIDX_comp_id comp_id, int var_index, uint64_t stored_bytes)
+{
+  PIDX_variable var = comp_id->idx->variable[var_index];
+  block_codec codec = find_variable_codec(comp_id->idx, var);
+  if (codec == NULL || codec->read_bytes == NULL)
+    return stored_bytes;
+
+  return codec->read_bytes(comp_id, var, block_bytes_of(comp_id->idx, var), stored_bytes);
+}
+
+
+
+unsigned char* PIDX_compression_scratch(PIDX_comp_id comp_id, uint64_t bytes)
+{
+  return scratch_reserve(comp_id, bytes);
+}
+
+
+
 PIDX_return_code PIDX_compression_finalize(PIDX_comp_id comp_id)
 {
+  free(comp_id->scratch);
+  free(comp_id->workspace);
   free(comp_id);
   comp_id = 0;
   return PIDX_success;
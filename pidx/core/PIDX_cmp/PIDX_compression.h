@@ -59,6 +59,61 @@ PIDX_return_code PIDX_decompression(PIDX_comp_id id);
 
 
 
+/// Tells if IDX blocks are compressed at the aggregators and stored with their own size.
+/// \param idx dataset
+/// \return 1 with block compression, 0 otherwise
+int PIDX_compression_block_container(idx_dataset idx);
+
+
+
+/// Tells if a variable of a block compressed file can be stored with a compression type.
+/// \param compression_type compression type of the variable
+/// \return 1 for a block codec or PIDX_NO_COMPRESSION, 0 otherwise
+int PIDX_compression_variable_codec(int compression_type);
+
+
+
+/// Compresses every block of an aggregation buffer on its own and packs the results back to back.
+/// The compressed size of every block is recorded in ab->block_size and ab->buffer_size shrinks to the total.
+/// \param id compression id
+/// \param ab aggregation buffer holding all the blocks of one variable of one file
+/// \param layout block layout of the aggregation group
+/// \return Error code
+PIDX_return_code PIDX_compression_compress_blocks(PIDX_comp_id id, Agg_buffer ab, PIDX_block_layout layout);
+
+
+
+/// Decompresses one block written by PIDX_compression_compress_blocks.
+/// \param id compression id
+/// \param var_index index of the variable the block belongs to
+/// \param compressed compressed block as read from the file
+/// \param compressed_bytes size of the compressed block
+/// \param block destination, holds samples_per_block samples
+/// \return Error code
+PIDX_return_code PIDX_compression_decompress_block(PIDX_comp_id id, int var_index, unsigned char* compressed, uint64_t compressed_bytes, unsigned char* block);
+
+
+
+/// Bytes of a stored block a read has to fetch, a prefix of the block when the codec of the variable
+/// can decode one (PIDX_PRECISION_BLOCK with a read precision), stored_bytes otherwise.
+/// \param id compression id
+/// \param var_index index of the variable the block belongs to
+/// \param stored_bytes size of the block in the file
+/// \return bytes to read from the start of the block
+uint64_t PIDX_compression_block_read_bytes(PIDX_comp_id id, int var_index, uint64_t stored_bytes);
+
+
+
+/// Returns the scratch arena of the compression id, grown to at least bytes.
+/// The arena is reused by every call made with the id and released by PIDX_compression_finalize,
+/// its content is only valid until the next compression call.
+/// \param id compression id
+/// \param bytes size needed
+/// \return the arena, NULL if it could not grow
+unsigned char* PIDX_compression_scratch(PIDX_comp_id id, uint64_t bytes);
+
+
+
 ///
 PIDX_return_code PIDX_compression_finalize(PIDX_comp_id id);
 #endif
@@ -0,0 +1,419 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file PIDX_lossless.c
+ *
+ * Implementation of the lossless block codec
+ * declared in PIDX_lossless.h
+ *
+ * Layout of a compressed block: mode, filter, element size and stride
+ * (one byte each), then the LZ77 sequences of the byte planes, or the
+ * raw block when mode is stored.
+ *
+ * A sequence is a token (literal count in the high nibble, match
+ * length - 4 in the low one, 15 meaning that 255 terminated extension
+ * bytes follow), the literals, a 16 bit little endian distance and the
+ * match length extension. The last sequence only has literals.
+ *
+ */
+
+#include "../../PIDX_inc.h"
+
+#define LOSSLESS_STORED 0
+#define LOSSLESS_LZ 1
+#define LOSSLESS_HEADER_SIZE 4
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_DISTANCE 65535
+#define LZ_HASH_BITS 12
+
+
+// elements are replaced by their difference (or XOR) with the previous element of the same component,
+// unfiltering is the running sum (or XOR) in the same order
+#define DEFINE_FILTER(T) \
+static void filter_##T(const unsigned char* input, unsigned char* output, uint64_t count, int stride, int filter_type) \
+{ \
+  const T* in = (const T*)input; \
+  T* out = (T*)output; \
+  uint64_t i; \
+  for (i = 0; i < (uint64_t)stride && i < count; i++) \
+    out[i] = in[i]; \
+  if (filter_type == PIDX_LOSSLESS_DELTA) \
+    for (; i < count; i++) \
+      out[i] = (T)(in[i] - in[i - stride]); \
+  else \
+    for (; i < count; i++) \
+      out[i] = (T)(in[i] ^ in[i - stride]); \
+} \
+\
+static void unfilter_##T(unsigned char* buffer, uint64_t count, int stride, int filter_type) \
+{ \
+  T* b = (T*)buffer; \
+  if (filter_type == PIDX_LOSSLESS_DELTA) \
+    for (uint64_t i = stride; i < count; i++) \
+      b[i] = (T)(b[i] + b[i - stride]); \
+  else \
+    for (uint64_t i = stride; i < count; i++) \
+      b[i] = (T)(b[i] ^ b[i - stride]); \
+}
+
+DEFINE_FILTER(uint8_t)
+DEFINE_FILTER(uint16_t)
+DEFINE_FILTER(uint32_t)
+DEFINE_FILTER(uint64_t)
+
+
+static void filter(const unsigned char* input, unsigned char* output, uint64_t bytes, int element_size, int stride, int filter_type)
+{
+  uint64_t count = bytes / element_size;
+
+  switch (element_size) {
+  case 1:
+    filter_uint8_t(input, output, count, stride, filter_type);
+    break;
+  case 2:
+    filter_uint16_t(input, output, count, stride, filter_type);
+    break;
+  case 4:
+    filter_uint32_t(input, output, count, stride, filter_type);
+    break;
+  case 8:
+    filter_uint64_t(input, output, count, stride, filter_type);
+    break;
+  }
+}
+
+
+static void unfilter(unsigned char* buffer, uint64_t bytes, int element_size, int stride, int filter_type)
+{
+  uint64_t count = bytes / element_size;
+
+  switch (element_size) {
+  case 1:
+    unfilter_uint8_t(buffer, count, stride, filter_type);
+    break;
+  case 2:
+    unfilter_uint16_t(buffer, count, stride, filter_type);
+    break;
+  case 4:
+    unfilter_uint32_t(buffer, count, stride, filter_type);
+    break;
+  case 8:
+    unfilter_uint64_t(buffer, count, stride, filter_type);
+    break;
+  }
+}
+
+
+// byte k of element i goes to plane k at position i, so that the slowly changing high bytes end up together
+static void shuffle(const unsigned char* input, unsigned char* output, uint64_t bytes, int element_size)
+{
+  uint64_t count = bytes / element_size;
+
+  for (int k = 0; k < element_size; k++)
+  {
+    unsigned char* plane = output + k * count;
+    for (uint64_t i = 0; i < count; i++)
+      plane[i] = input[i * element_size + k];
+  }
+}
+
+
+static void unshuffle(const unsigned char* input, unsigned char* output, uint64_t bytes, int element_size)
+{
+  uint64_t count = bytes / element_size;
+
+  for (int k = 0; k < element_size; k++)
+  {
+    const unsigned char* plane = input + k * count;
+    for (uint64_t i = 0; i < count; i++)
+      output[i * element_size + k] = plane[i];
+  }
+}
+
+
+
+static uint32_t read32(const unsigned char* p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+
+static uint32_t lz_hash(uint32_t v)
+{
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+
+static unsigned char* lz_write_length(unsigned char* op, uint64_t length)
+{
+  while (length >= 255)
+  {
+    *op++ = 255;
+    length = length - 255;
+  }
+  *op++ = (unsigned char)length;
+
+  return op;
+}
+
+
+// writes one sequence, NULL if it does not fit before end
+static unsigned char* lz_write_sequence(unsigned char* op, unsigned char* end, const unsigned char* literals, uint64_t literal_count, uint64_t distance, uint64_t match_length)
+{
+  uint64_t needed = 1 + (literal_count / 255 + 1) + literal_count + (match_length != 0 ? 2 + (match_length / 255 + 1) : 0);
+  if (needed > (uint64_t)(end - op))
+    return NULL;
+
+  unsigned char* token = op++;
+  uint64_t match_code = (match_length != 0) ? match_length - LZ_MIN_MATCH : 0;
+  *token = (unsigned char)(((literal_count < 15 ? literal_count : 15) << 4) | (match_code < 15 ? match_code : 15));
+
+  if (literal_count >= 15)
+    op = lz_write_length(op, literal_count - 15);
+  memcpy(op, literals, literal_count);
+  op = op + literal_count;
+
+  if (match_length != 0)
+  {
+    *op++ = (unsigned char)(distance & 0xff);
+    *op++ = (unsigned char)(distance >> 8);
+    if (match_code >= 15)
+      op = lz_write_length(op, match_code - 15);
+  }
+
+  return op;
+}
+
+
+// returns the compressed size, 0 when it would not fit in output_bytes
+static uint64_t lz_compress(const unsigned char* input, uint64_t bytes, unsigned char* output, uint64_t output_bytes)
+{
+  uint32_t table[1 << LZ_HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  unsigned char* op = output;
+  unsigned char* end = output + output_bytes;
+  uint64_t anchor = 0;
+  uint64_t ip = 0;
+
+  while (ip + LZ_MIN_MATCH <= bytes)
+  {
+    uint32_t h = lz_hash(read32(input + ip));
+    uint64_t candidate = table[h];
+    table[h] = (uint32_t)ip;
+
+    if (candidate < ip && ip - candidate <= LZ_MAX_DISTANCE && read32(input + candidate) == read32(input + ip))
+    {
+      uint64_t length = LZ_MIN_MATCH;
+      while (ip + length < bytes && input[candidate + length] == input[ip + length])
+        length++;
+
+      op = lz_write_sequence(op, end, input + anchor, ip - anchor, ip - candidate, length);
+      if (op == NULL)
+        return 0;
+
+      ip = ip + length;
+      anchor = ip;
+    }
+    else
+    {
+      // step faster through data that does not match
+      ip = ip + 1 + ((ip - anchor) >> 6);
+    }
+  }
+
+  op = lz_write_sequence(op, end, input + anchor, bytes - anchor, 0, 0);
+  if (op == NULL)
+    return 0;
+
+  return op - output;
+}
+
+
+static PIDX_return_code lz_decompress(const unsigned char* input, uint64_t compressed_bytes, unsigned char* output, uint64_t bytes)
+{
+  const unsigned char* ip = input;
+  const unsigned char* ip_end = input + compressed_bytes;
+  unsigned char* op = output;
+  unsigned char* op_end = output + bytes;
+
+  while (op < op_end)
+  {
+    if (ip >= ip_end)
+      return PIDX_err_compress;
+
+    unsigned char token = *ip++;
+    uint64_t literal_count = token >> 4;
+    if (literal_count == 15)
+    {
+      unsigned char b;
+      do {
+        if (ip >= ip_end)
+          return PIDX_err_compress;
+        b = *ip++;
+        literal_count = literal_count + b;
+      } while (b == 255);
+    }
+
+    if (literal_count > (uint64_t)(ip_end - ip) || literal_count > (uint64_t)(op_end - op))
+      return PIDX_err_compress;
+    memcpy(op, ip, literal_count);
+    ip = ip + literal_count;
+    op = op + literal_count;
+
+    if (op == op_end)
+      break;
+
+    if (ip_end - ip < 2)
+      return PIDX_err_compress;
+    uint64_t distance = ip[0] | ((uint64_t)ip[1] << 8);
+    ip = ip + 2;
+
+    uint64_t length = (token & 15) + LZ_MIN_MATCH;
+    if ((token & 15) == 15)
+    {
+      unsigned char b;
+      do {
+        if (ip >= ip_end)
+          return PIDX_err_compress;
+        b = *ip++;
+        length = length + b;
+      } while (b == 255);
+    }
+
+    if (distance == 0 || distance > (uint64_t)(op - output) || length > (uint64_t)(op_end - op))
+      return PIDX_err_compress;
+
+    // matches may overlap what they copy (runs have distance 1)
+    const unsigned char* match = op - distance;
+    if (distance >= length)
+      memcpy(op, match, length);
+    else
+      for (uint64_t i = 0; i < length; i++)
+        op[i] = match[i];
+    op = op + length;
+  }
+
+  return PIDX_success;
+}
+
+
+
+uint64_t PIDX_lossless_max_bytes(uint64_t bytes)
+{
+  return LOSSLESS_HEADER_SIZE + bytes;
+}
+
+
+
+PIDX_return_code PIDX_lossless_compress(unsigned char* input, uint64_t bytes, int element_size, int stride, int filter_type, unsigned char* workspace, unsigned char* output, uint64_t* compressed_bytes)
+{
+  if (element_size != 1 && element_size != 2 && element_size != 4 && element_size != 8)
+    element_size = 1;
+  if (bytes % element_size != 0)
+    element_size = 1;
+  if (stride < 1 || stride > 255)
+    filter_type = PIDX_LOSSLESS_NO_FILTER;
+
+  output[0] = LOSSLESS_LZ;
+  output[1] = (unsigned char)filter_type;
+  output[2] = (unsigned char)element_size;
+  output[3] = (unsigned char)stride;
+
+  // filtered elements go through the output, which is free until the LZ stage writes to it
+  unsigned char* filtered = input;
+  if (filter_type != PIDX_LOSSLESS_NO_FILTER)
+  {
+    filtered = output + LOSSLESS_HEADER_SIZE;
+    filter(input, filtered, bytes, element_size, stride, filter_type);
+  }
+  shuffle(filtered, workspace, bytes, element_size);
+
+  // anything that is not smaller than the block is stored as it is
+  uint64_t lz_bytes = lz_compress(workspace, bytes, output + LOSSLESS_HEADER_SIZE, bytes);
+  if (lz_bytes == 0)
+  {
+    output[0] = LOSSLESS_STORED;
+    memcpy(output + LOSSLESS_HEADER_SIZE, input, bytes);
+    lz_bytes = bytes;
+  }
+
+  *compressed_bytes = LOSSLESS_HEADER_SIZE + lz_bytes;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_lossless_decompress(unsigned char* input, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* output, uint64_t bytes)
+{
+  if (compressed_bytes < LOSSLESS_HEADER_SIZE)
+    return PIDX_err_compress;
+
+  int mode = input[0];
+  int filter_type = input[1];
+  int element_size = input[2];
+  int stride = input[3];
+
+  if (mode == LOSSLESS_STORED)
+  {
+    if (compressed_bytes - LOSSLESS_HEADER_SIZE != bytes)
+      return PIDX_err_compress;
+    memcpy(output, input + LOSSLESS_HEADER_SIZE, bytes);
+    return PIDX_success;
+  }
+
+  if (mode != LOSSLESS_LZ || element_size == 0 || bytes % element_size != 0)
+    return PIDX_err_compress;
+
+  if (lz_decompress(input + LOSSLESS_HEADER_SIZE, compressed_bytes - LOSSLESS_HEADER_SIZE, workspace, bytes) != PIDX_success)
+    return PIDX_err_compress;
+
+  unshuffle(workspace, output, bytes, element_size);
+  if (filter_type != PIDX_LOSSLESS_NO_FILTER)
+    unfilter(output, bytes, element_size, stride, filter_type);
+
+  return PIDX_success;
+}
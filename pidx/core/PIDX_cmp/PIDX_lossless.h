@@ -0,0 +1,83 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#ifndef __PIDX_LOSSLESS_H
+#define __PIDX_LOSSLESS_H
+
+// Lossless block codec: the elements are optionally replaced by their difference (delta) or bitwise XOR with the
+// previous element of the same component, the bytes are split into byte planes (byte k of every element, then
+// byte k + 1, ...), and the planes are compressed with a byte oriented LZ77 (runs are matches at distance 1).
+// Blocks that do not shrink are stored as they are.
+
+#define PIDX_LOSSLESS_NO_FILTER 0
+#define PIDX_LOSSLESS_DELTA 1
+#define PIDX_LOSSLESS_XOR 2
+
+
+/// Upper bound on the size of a compressed block.
+/// \param bytes size of the uncompressed block
+/// \return bound in bytes
+uint64_t PIDX_lossless_max_bytes(uint64_t bytes);
+
+
+/// Compresses one block.
+/// \param input block of bytes / element_size elements, components interleaved in groups of stride
+/// \param bytes size of the block
+/// \param element_size size of one element (1, 2, 4 or 8 bytes)
+/// \param stride distance in elements to the previous element of the same component
+/// \param filter PIDX_LOSSLESS_NO_FILTER, PIDX_LOSSLESS_DELTA or PIDX_LOSSLESS_XOR
+/// \param workspace bytes of temporary storage
+/// \param output destination, at least PIDX_lossless_max_bytes(bytes)
+/// \param compressed_bytes size of the compressed block
+/// \return Error code
+PIDX_return_code PIDX_lossless_compress(unsigned char* input, uint64_t bytes, int element_size, int stride, int filter, unsigned char* workspace, unsigned char* output, uint64_t* compressed_bytes);
+
+
+/// Decompresses one block written by PIDX_lossless_compress.
+/// \param input compressed block
+/// \param compressed_bytes size of the compressed block
+/// \param workspace bytes of temporary storage
+/// \param output destination
+/// \param bytes size of the uncompressed block
+/// \return Error code
+PIDX_return_code PIDX_lossless_decompress(unsigned char* input, uint64_t compressed_bytes, unsigned char* workspace, unsigned char* output, uint64_t bytes);
+
+#endif
@@ -42,7 +42,7 @@
 #include "../../PIDX_inc.h"
 
 
-PIDX_file_io_id PIDX_file_io_init(idx_dataset idx_meta_data, idx_comm idx_c, int fs_block_size, int first_index, int last_index)
+PIDX_file_io_id PIDX_file_io_init(idx_dataset idx_meta_data, idx_comm idx_c, int fs_block_size, PIDX_block_cache block_cache, PIDX_time_step_prefetch prefetch, PIDX_comp_id comp_id, int first_index, int last_index)
 {
   PIDX_file_io_id io_id;
 
@@ -55,6 +55,11 @@ PIDX_file_io_id PIDX_file_io_init(idx_dataset idx_meta_data, idx_comm idx_c, int
 
   io_id->fs_block_size = fs_block_size;
 
+  io_id->block_cache = block_cache;
+  io_id->prefetch = prefetch;
+
+  io_id->comp_id = comp_id;
+
   io_id->first_index = first_index;
   io_id->last_index = last_index;
 
@@ -60,6 +60,11 @@ struct PIDX_file_io_struct
 
   int fs_block_size;
 
+  PIDX_block_cache block_cache;
+  PIDX_time_step_prefetch prefetch;
+
+  PIDX_comp_id comp_id;
+
   int first_index;
   int last_index;
 };
@@ -69,10 +74,13 @@ typedef struct PIDX_file_io_struct* PIDX_file_io_id;
 /// Creates the IO ID.
 /// \param idx_meta_data All infor regarding the idx file passed from PIDX.c
 /// \param idx_derived_ptr All derived idx related derived metadata passed from PIDX.c
+/// \param block_cache Block cache the reads go through (can be NULL)
+/// \param prefetch Records the blocks read for the time step prefetch (can be NULL)
+/// \param comp_id Decodes the blocks when they are compressed one by one (PIDX_CHUNKING_ZFP_BLOCK)
 /// \param start_var_index starting index of the variable on which the relevant operation is to be applied
 /// \param end_var_index ending index of the variable on which the relevant operation is to be applied
 /// \return PIDX_hz_encode_id The identifier associated with the task
-PIDX_file_io_id PIDX_file_io_init(idx_dataset idx_meta_data, idx_comm idx_c, int fs_block_size, int start_var_index, int end_var_index);
+PIDX_file_io_id PIDX_file_io_init(idx_dataset idx_meta_data, idx_comm idx_c, int fs_block_size, PIDX_block_cache block_cache, PIDX_time_step_prefetch prefetch, PIDX_comp_id comp_id, int start_var_index, int end_var_index);
 
 
 
@@ -42,6 +42,7 @@
 
 static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf);
 static void bit64_reverse_endian(unsigned char* val, unsigned char *outbuf);
+static PIDX_return_code write_block_table(PIDX_file_io_id io_id, MPI_File fh, Agg_buffer agg_buf, uint64_t data_offset);
 
 
 
@@ -51,37 +52,24 @@ PIDX_return_code PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer ag
   char file_name[PATH_MAX];
   int i = 0;
   MPI_File fp;
-  uint32_t *headers;
-  int ret;
-  MPI_Status status;
+  int is_open = 0;
+  uint64_t *block_table;
+  int is_block_compressed = PIDX_compression_block_container(io_id->idx);
 
   int tck = (io_id->idx->chunk_size[0] * io_id->idx->chunk_size[1] * io_id->idx->chunk_size[2]);
   if (agg_buf->var_number != -1 && agg_buf->file_number != -1)
   {
     generate_file_name(io_id->idx->blocks_per_file, filename_template, (unsigned int) agg_buf->file_number, file_name, PATH_MAX);
 
-    ret = MPI_File_open(MPI_COMM_SELF, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp);
-    if (ret != MPI_SUCCESS)
-    {
-      fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
-      return PIDX_err_io;
-    }
-
-    int total_header_size = (10 + (10 * io_id->idx->blocks_per_file)) * sizeof (uint32_t) * io_id->idx->variable_count;
-    headers = malloc(total_header_size);
-    memset(headers, 0, total_header_size);
-
-    ret = MPI_File_read_at(fp, 0, headers, total_header_size , MPI_BYTE, &status);
-    if (ret != MPI_SUCCESS)
-    {
-      fprintf(stderr, "Data offset = [%s] [%d] MPI_File_write_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
-      return PIDX_err_io;
-    }
-    int read_count = 0;
-    MPI_Get_count(&status, MPI_BYTE, &read_count);
-    if (read_count != total_header_size)
+    // with the time step prefetch enabled the header and the blocks come from the block cache when they
+    // are there, the file is opened only on a miss. Without it the cache is left alone: filling it would
+    // only copy every block once more and evict the entries of the serial and point readers.
+    PIDX_block_cache block_cache = (io_id->prefetch != NULL) ? io_id->block_cache : NULL;
+    block_table = malloc(2 * io_id->idx->blocks_per_file * io_id->idx->variable_count * sizeof(*block_table));
+    if (PIDX_block_cache_read_header(block_cache, file_name, io_id->idx->current_time_step, io_id->idx->blocks_per_file, io_id->idx->variable_count, &fp, &is_open, block_table) != PIDX_success)
     {
-      fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %dd\n", __FILE__, __LINE__, read_count, total_header_size);
+      fprintf(stderr, "[%s] [%d] reading the header of %s failed.\n", __FILE__, __LINE__, file_name);
+      free(block_table);
       return PIDX_err_io;
     }
 
@@ -91,17 +79,52 @@ PIDX_return_code PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer ag
     {
       if (PIDX_blocks_is_block_present(agg_buf->file_number * io_id->idx->blocks_per_file + i, io_id->idx->bits_per_block, block_layout))
       {
-        data_offset = htonl(headers[12 + ((i + (io_id->idx->blocks_per_file * agg_buf->var_number))*10 )]);
-        data_size = htonl(headers[14 + ((i + (io_id->idx->blocks_per_file * agg_buf->var_number))*10 )]);
+        data_offset = block_table[2 * (i + (io_id->idx->blocks_per_file * agg_buf->var_number))];
+        data_size = block_table[2 * (i + (io_id->idx->blocks_per_file * agg_buf->var_number)) + 1];
+
+        // some codecs decode a prefix of the block (the most significant byte planes), only that part is read
+        if (is_block_compressed && data_size != 0)
+          data_size = PIDX_compression_block_read_bytes(io_id->comp_id, agg_buf->var_number, data_size);
 
         int buffer_index = (block_count * io_id->idx->samples_per_block * (io_id->idx->variable[agg_buf->var_number]->bpv/8) * io_id->idx->variable[agg_buf->var_number]->vps * tck) / io_id->idx->compression_factor;
 
         //fprintf(stderr, "DO and DS %d %d\n", data_offset, data_size);
-        ret = MPI_File_read_at(fp, data_offset, agg_buf->buffer + buffer_index, data_size, MPI_BYTE, &status);
-        if (ret != MPI_SUCCESS)
+        if (data_size != 0)
         {
-          fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at() failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
-          return PIDX_err_io;
+          // compressed blocks are read into the scratch arena of the compression id and decoded into their slot of the aggregation buffer
+          unsigned char* block_buffer = agg_buf->buffer + buffer_index;
+          if (is_block_compressed)
+          {
+            block_buffer = PIDX_compression_scratch(io_id->comp_id, data_size);
+            if (block_buffer == NULL)
+            {
+              fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+              free(block_table);
+              return PIDX_err_io;
+            }
+          }
+
+          int64_t block_number = (int64_t)agg_buf->file_number * io_id->idx->blocks_per_file + i;
+          if (PIDX_block_cache_read_block(block_cache, file_name, agg_buf->var_number, io_id->idx->current_time_step, block_number, data_offset, data_size, &fp, &is_open, block_buffer) != PIDX_success)
+          {
+            fprintf(stderr, "Data offset = %lld [%s] [%d] reading block failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
+            free(block_table);
+            return PIDX_err_io;
+          }
+
+          if (is_block_compressed)
+          {
+            int ret = PIDX_compression_decompress_block(io_id->comp_id, agg_buf->var_number, block_buffer, data_size, agg_buf->buffer + buffer_index);
+            if (ret != PIDX_success)
+            {
+              fprintf(stderr, "[%s] [%d] decompressing block %d of %s failed.\n", __FILE__, __LINE__, i, file_name);
+              free(block_table);
+              return PIDX_err_io;
+            }
+          }
+
+          if (io_id->prefetch != NULL)
+            PIDX_time_step_prefetch_record(io_id->prefetch, io_id->idx, agg_buf->file_number, agg_buf->var_number, i);
         }
 
 #if 0
@@ -130,7 +153,7 @@ PIDX_return_code PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer ag
         }
 #endif
 
-        if (io_id->idx->flip_endian == 1)
+        if (io_id->idx->flip_endian == 1 && !is_block_compressed)
         {
           PIDX_variable curr_var = io_id->idx->variable[agg_buf->var_number];
           if (curr_var->bpv/8 == 4 || curr_var->bpv/8 == 12)
@@ -165,8 +188,9 @@ PIDX_return_code PIDX_file_io_blocking_read(PIDX_file_io_id io_id, Agg_buffer ag
       }
     }
 
-    MPI_File_close(&fp);
-    free(headers);
+    if (is_open == 1)
+      MPI_File_close(&fp);
+    free(block_table);
   }
 
   return PIDX_success;
@@ -202,13 +226,28 @@ PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer a
     data_offset = 0;
     data_offset += start_fs_block * io_id->fs_block_size;
 
-    for (int k = 0; k < agg_buf->var_number; k++)
+    if (PIDX_compression_block_container(io_id->idx))
     {
-      PIDX_variable vark = io_id->idx->variable[k];
-      int bytes_per_datatype =  ((vark->bpv/8) * tck) / (io_id->idx->compression_factor);
-      uint64_t prev_var_sample = (uint64_t) block_layout->bcpf[agg_buf->file_number] * io_id->idx->samples_per_block * bytes_per_datatype * io_id->idx->variable[k]->vps;
+      // the blocks of the previous variables are packed before, their total size was exchanged among the aggregators
+      data_offset = data_offset + agg_buf->data_offset;
 
-      data_offset = (uint64_t) data_offset + prev_var_sample;
+      if (write_block_table(io_id, fh, agg_buf, data_offset) != PIDX_success)
+      {
+        fprintf(stderr, "[%s] [%d] writing the block table of %s failed.\n", __FILE__, __LINE__, file_name);
+        MPI_File_close(&fh);
+        return PIDX_err_io;
+      }
+    }
+    else
+    {
+      for (int k = 0; k < agg_buf->var_number; k++)
+      {
+        PIDX_variable vark = io_id->idx->variable[k];
+        int bytes_per_datatype =  ((vark->bpv/8) * tck) / (io_id->idx->compression_factor);
+        uint64_t prev_var_sample = (uint64_t) block_layout->bcpf[agg_buf->file_number] * io_id->idx->samples_per_block * bytes_per_datatype * io_id->idx->variable[k]->vps;
+
+        data_offset = (uint64_t) data_offset + prev_var_sample;
+      }
     }
 
     //for (i = 0; i < agg_buf->sample_number; i++)
@@ -243,6 +282,42 @@ PIDX_return_code PIDX_file_io_blocking_write(PIDX_file_io_id io_id, Agg_buffer a
 
 
 
+// with block compression every aggregator writes the (offset, size) entries of its variable in the file header
+static PIDX_return_code write_block_table(PIDX_file_io_id io_id, MPI_File fh, Agg_buffer agg_buf, uint64_t data_offset)
+{
+  MPI_Status status;
+  int blocks_per_file = io_id->idx->blocks_per_file;
+  uint64_t table_size = 10 * blocks_per_file * sizeof(uint32_t);
+
+  uint32_t *table = malloc(table_size);
+  memset(table, 0, table_size);
+
+  uint64_t block_offset = data_offset;
+  for (int i = 0; i < blocks_per_file; i++)
+  {
+    if (agg_buf->block_size[i] == 0)
+      continue;
+
+    table[i * 10 + 2] = htonl(block_offset);
+    table[i * 10 + 4] = htonl(agg_buf->block_size[i]);
+    block_offset = block_offset + agg_buf->block_size[i];
+  }
+
+  // same layout as the header written by PIDX_header_io, the table of variable v starts after the 10 leading entries
+  uint64_t table_offset = (10 + (uint64_t)10 * blocks_per_file * agg_buf->var_number) * sizeof(uint32_t);
+  if (MPI_File_write_at(fh, table_offset, table, table_size, MPI_BYTE, &status) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed.\n", __FILE__, __LINE__);
+    free(table);
+    return PIDX_err_io;
+  }
+
+  free(table);
+  return PIDX_success;
+}
+
+
+
 static void bit32_reverse_endian(unsigned char* val, unsigned char *outbuf)
 {
   unsigned char *data = ((unsigned char *)val) + 3;
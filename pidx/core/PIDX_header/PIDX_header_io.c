@@ -46,6 +46,8 @@
 
 static uint32_t* headers;
 static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, int file_number, char* bin_file, int mode);
+static void write_compression_mode(FILE* idx_file_p, idx_dataset idx);
+static void write_variable_compression(FILE* idx_file_p, PIDX_variable var);
 
 
 struct PIDX_header_io_struct 
@@ -425,11 +427,14 @@ PIDX_return_code PIDX_header_io_global_idx_write (PIDX_header_io_id header_io, c
 
     fprintf(idx_file_p, "(compression bit rate)\n%f\n", header_io->idx->compression_bit_rate);
     fprintf(idx_file_p, "(compression type)\n%d\n", header_io->idx->compression_type);
+    fprintf(idx_file_p, "(compressed box)\n%lld %lld %lld\n", (long long)header_io->idx->chunk_size[0], (long long)header_io->idx->chunk_size[1], (long long)header_io->idx->chunk_size[2]);
+    write_compression_mode(idx_file_p, header_io->idx);
     
     fprintf(idx_file_p, "(fields)\n");
     for (int l = 0; l < header_io->last_index; l++)
     {
       fprintf(idx_file_p, "%s %s", header_io->idx->variable[l]->var_name, header_io->idx->variable[l]->type_name);
+      write_variable_compression(idx_file_p, header_io->idx->variable[l]);
       if (l != header_io->last_index - 1)
         fprintf(idx_file_p, " + \n");
     }
@@ -556,11 +561,14 @@ PIDX_return_code PIDX_header_io_partition_idx_write (PIDX_header_io_id header_io
 
     fprintf(idx_file_p, "(compression bit rate)\n%f\n", header_io->idx->compression_bit_rate);
     fprintf(idx_file_p, "(compression type)\n%d\n", header_io->idx->compression_type);
+    fprintf(idx_file_p, "(compressed box)\n%lld %lld %lld\n", (long long)header_io->idx->chunk_size[0], (long long)header_io->idx->chunk_size[1], (long long)header_io->idx->chunk_size[2]);
+    write_compression_mode(idx_file_p, header_io->idx);
 
     fprintf(idx_file_p, "(fields)\n");
     for (l = 0; l < header_io->last_index; l++)
     {
       fprintf(idx_file_p, "%s %s", header_io->idx->variable[l]->var_name, header_io->idx->variable[l]->type_name);
+      write_variable_compression(idx_file_p, header_io->idx->variable[l]);
       if (l != header_io->last_index - 1)
         fprintf(idx_file_p, " + \n");
     }
@@ -682,11 +690,14 @@ PIDX_return_code PIDX_header_io_raw_idx_write (PIDX_header_io_id header_io, char
 
     fprintf(idx_file_p, "(compression bit rate)\n%f\n", header_io->idx->compression_bit_rate);
     fprintf(idx_file_p, "(compression type)\n%d\n", header_io->idx->compression_type);
+    fprintf(idx_file_p, "(compressed box)\n%lld %lld %lld\n", (long long)header_io->idx->chunk_size[0], (long long)header_io->idx->chunk_size[1], (long long)header_io->idx->chunk_size[2]);
+    write_compression_mode(idx_file_p, header_io->idx);
 
     fprintf(idx_file_p, "(fields)\n");
     for (l = 0; l < header_io->last_index; l++)
     {
       fprintf(idx_file_p, "%s %s", header_io->idx->variable[l]->var_name, header_io->idx->variable[l]->type_name);
+      write_variable_compression(idx_file_p, header_io->idx->variable[l]);
       if (l != header_io->last_index - 1)
         fprintf(idx_file_p, " + \n");
     }
@@ -700,6 +711,35 @@ PIDX_return_code PIDX_header_io_raw_idx_write (PIDX_header_io_id header_io, char
 }
 
 
+// the ZFP mode is only written when it is not the default fixed rate
+static void write_compression_mode(FILE* idx_file_p, idx_dataset idx)
+{
+  if (idx->compression_mode == PIDX_ZFP_FIXED_ACCURACY)
+    fprintf(idx_file_p, "(compression mode)\n%d\n(compression tolerance)\n%.17g\n", idx->compression_mode, idx->compression_tolerance);
+  else if (idx->compression_mode == PIDX_ZFP_FIXED_PRECISION)
+    fprintf(idx_file_p, "(compression mode)\n%d\n(compression precision)\n%d\n", idx->compression_mode, idx->compression_precision);
+}
+
+
+
+
+// variables with their own compression settings get pidx_compression(type,mode,value) after their type, value being
+// the bit rate, the tolerance or the precision depending on the ZFP mode
+static void write_variable_compression(FILE* idx_file_p, PIDX_variable var)
+{
+  if (!var->compression_override)
+    return;
+
+  double value = var->compression_bit_rate;
+  if (var->compression_mode == PIDX_ZFP_FIXED_ACCURACY)
+    value = var->compression_tolerance;
+  else if (var->compression_mode == PIDX_ZFP_FIXED_PRECISION)
+    value = var->compression_precision;
+
+  fprintf(idx_file_p, " pidx_compression(%d,%d,%.17g)", var->compression_type, var->compression_mode, value);
+}
+
+
 static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout block_layout, int file_number, char* bin_file, int mode)
 {
   int block_negative_offset = 0;
@@ -733,7 +773,8 @@ static int write_meta_data(PIDX_header_io_id header_io_id, PIDX_block_layout blo
     }
   }
 
-  if (mode == 1)
+  // with block compression the sizes are only known after aggregation, every aggregator writes the entries of its variable
+  if (mode == 1 && !PIDX_compression_block_container(header_io_id->idx))
   {
     MPI_File fh;
     MPI_Status status;
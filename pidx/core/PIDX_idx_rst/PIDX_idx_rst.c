@@ -80,6 +80,8 @@ PIDX_idx_rst_id PIDX_idx_rst_init(idx_dataset idx_meta_data, idx_comm idx_c, idx
 
 PIDX_return_code PIDX_idx_rst_finalize(PIDX_idx_rst_id idx_rst_id)
 {
+  PIDX_idx_rst_free_patch_types(&idx_rst_id->type_cache);
+
   idx_rst_id->intersected_restructured_super_patch_count = 0;
   idx_rst_id->sim_max_patch_count = 0;
   free(idx_rst_id);
@@ -87,3 +89,92 @@ PIDX_return_code PIDX_idx_rst_finalize(PIDX_idx_rst_id idx_rst_id)
 
   return PIDX_success;
 }
+
+
+
+PIDX_return_code PIDX_idx_rst_patch_type(PIDX_idx_rst_type_cache* cache, PIDX_patch sim_patch, PIDX_patch patch, int bytes_per_sample, MPI_Datatype* type)
+{
+  uint64_t offset[PIDX_MAX_DIMENSIONS];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    offset[d] = patch->offset[d] - sim_patch->offset[d];
+
+  for (int i = 0; i < cache->count; i++)
+  {
+    struct PIDX_idx_rst_type_struct* t = &cache->type[i];
+    if (t->bytes_per_sample == bytes_per_sample &&
+        memcmp(t->sim_size, sim_patch->size, sizeof(t->sim_size)) == 0 &&
+        memcmp(t->offset, offset, sizeof(t->offset)) == 0 &&
+        memcmp(t->size, patch->size, sizeof(t->size)) == 0)
+    {
+      *type = t->type;
+      return PIDX_success;
+    }
+  }
+
+  if (cache->count == cache->capacity)
+  {
+    int capacity = (cache->capacity == 0) ? 8 : cache->capacity * 2;
+    struct PIDX_idx_rst_type_struct* temp = realloc(cache->type, sizeof(*temp) * capacity);
+    if (temp == NULL)
+    {
+      fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+    cache->type = temp;
+    cache->capacity = capacity;
+  }
+
+  // x is the fastest varying dimension of the patches
+  int sizes[PIDX_MAX_DIMENSIONS], subsizes[PIDX_MAX_DIMENSIONS], starts[PIDX_MAX_DIMENSIONS];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    sizes[d] = (int)sim_patch->size[d];
+    subsizes[d] = (int)patch->size[d];
+    starts[d] = (int)offset[d];
+  }
+
+  MPI_Datatype sample_type;
+  if (MPI_Type_contiguous(bytes_per_sample, MPI_BYTE, &sample_type) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+    return PIDX_err_mpi;
+  }
+
+  struct PIDX_idx_rst_type_struct* t = &cache->type[cache->count];
+  if (MPI_Type_create_subarray(PIDX_MAX_DIMENSIONS, sizes, subsizes, starts, MPI_ORDER_FORTRAN, sample_type, &t->type) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+    return PIDX_err_mpi;
+  }
+  MPI_Type_commit(&t->type);
+  MPI_Type_free(&sample_type);
+
+  memcpy(t->sim_size, sim_patch->size, sizeof(t->sim_size));
+  memcpy(t->offset, offset, sizeof(t->offset));
+  memcpy(t->size, patch->size, sizeof(t->size));
+  t->bytes_per_sample = bytes_per_sample;
+  cache->count++;
+
+  *type = t->type;
+
+  return PIDX_success;
+}
+
+
+
+void PIDX_idx_rst_free_patch_types(PIDX_idx_rst_type_cache* cache)
+{
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+
+  for (int i = 0; i < cache->count; i++)
+    if (!finalized)
+      MPI_Type_free(&cache->type[i].type);
+
+  free(cache->type);
+  cache->type = NULL;
+  cache->count = 0;
+  cache->capacity = 0;
+
+  return;
+}
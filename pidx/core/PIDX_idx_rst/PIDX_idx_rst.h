@@ -56,6 +56,53 @@
 #define __PIDX_IDX_RST_NEW_H
 
 
+//Committed subarray datatype of a patch inside a simulation patch
+struct PIDX_idx_rst_type_struct
+{
+  uint64_t sim_size[PIDX_MAX_DIMENSIONS];
+  uint64_t offset[PIDX_MAX_DIMENSIONS];                   /// offset of the patch inside the simulation patch
+  uint64_t size[PIDX_MAX_DIMENSIONS];
+  int bytes_per_sample;
+  MPI_Datatype type;
+};
+
+
+//Datatypes created once per patch geometry and shared by all the variables with the same sample size
+struct PIDX_idx_rst_type_cache_struct
+{
+  int count;
+  int capacity;
+  struct PIDX_idx_rst_type_struct* type;
+};
+typedef struct PIDX_idx_rst_type_cache_struct PIDX_idx_rst_type_cache;
+
+
+//Restructuring plan, cached on the PIDX_metadata_cache and replayed while the decomposition is unchanged
+struct PIDX_idx_rst_plan_struct
+{
+  uint64_t hash;                                          /// hash of key
+  uint64_t key_size;
+  uint64_t* key;                                          /// local decomposition the plan was built for
+
+  int is_built;                                           /// 1 once the intersections are stored
+  int restructured_super_patch_count;
+  int intersected_restructured_super_patch_count;
+  PIDX_super_patch* intersected_restructured_super_patch;
+
+  int variable_count;
+  int request_count;                                      /// staged write requests per variable
+  int datatype_count;                                     /// staged write send datatypes per variable
+  MPI_Comm comm;                                          /// communicator the persistent requests are bound to
+  MPI_Request* request;                                   /// persistent requests [variable][request]
+  void** request_buffer;                                  /// buffer each persistent request is bound to
+  MPI_Datatype* datatype;                                 /// send datatypes [variable][datatype], owned by type_cache
+  PIDX_idx_rst_type_cache type_cache;
+
+  struct PIDX_idx_rst_plan_struct* next;
+};
+typedef struct PIDX_idx_rst_plan_struct* PIDX_idx_rst_plan;
+
+
 //Struct for restructuring ID
 struct PIDX_idx_rst_struct
 {
@@ -76,6 +123,10 @@ struct PIDX_idx_rst_struct
   uint64_t* sim_multi_patch_r_offset;
 
   int maximum_neighbor_count;
+
+  PIDX_idx_rst_plan plan;                                 /// cached plan, NULL when no meta data cache is set
+
+  PIDX_idx_rst_type_cache type_cache;                     /// send and receive datatypes of this flush
 };
 typedef struct PIDX_idx_rst_struct* PIDX_idx_rst_id;
 
@@ -105,6 +156,28 @@ PIDX_return_code PIDX_idx_rst_finalize(PIDX_idx_rst_id id);
 
 
 
+///
+/// \brief PIDX_idx_rst_patch_type Returns the subarray datatype that selects patch inside sim_patch,
+/// creating it the first time the geometry is seen. The datatype is owned by the cache.
+/// \param cache
+/// \param sim_patch
+/// \param patch
+/// \param bytes_per_sample
+/// \param type
+/// \return
+///
+PIDX_return_code PIDX_idx_rst_patch_type(PIDX_idx_rst_type_cache* cache, PIDX_patch sim_patch, PIDX_patch patch, int bytes_per_sample, MPI_Datatype* type);
+
+
+
+///
+/// \brief PIDX_idx_rst_free_patch_types Frees all the datatypes of the cache
+/// \param cache
+///
+void PIDX_idx_rst_free_patch_types(PIDX_idx_rst_type_cache* cache);
+
+
+
 /*
  * Implementation in PIDX_idx_rst_meta_data.c
  */
@@ -147,6 +220,16 @@ PIDX_return_code PIDX_idx_rst_buf_create(PIDX_idx_rst_id rst_id);
 
 
 
+///
+/// \brief PIDX_idx_rst_zero_copy_patch Index of the simulation patch that is exactly the super
+/// patch of this process (the super patch then aliases its buffer), -1 otherwise
+/// \param rst_id
+/// \return
+///
+int PIDX_idx_rst_zero_copy_patch(PIDX_idx_rst_id rst_id);
+
+
+
 ///
 /// \brief PIDX_idx_rst_buf_destroy Tear down the various buffer structs. In the case of the output structs this function should also free the memory buffers as well
 /// \param rst_id
@@ -226,6 +309,18 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id);
 
 
 
+///
+/// \brief PIDX_idx_rst_overlapped_write Posts the messages of all variables at once and copies
+/// every patch into the restructured patch as soon as it lands (MPI_Waitsome), the separate
+/// PIDX_idx_rst_buf_aggregate pass is then not needed. Chunking and HZ encoding still start
+/// once all the patches are in.
+/// \param rst_id
+/// \return
+///
+PIDX_return_code PIDX_idx_rst_overlapped_write(PIDX_idx_rst_id rst_id);
+
+
+
 /*
  * Implementation in PIDX_idx_rst_read.c
  */
@@ -254,4 +349,45 @@ PIDX_return_code PIDX_idx_rst_forced_raw_read(PIDX_idx_rst_id rst_id);
 /// \return
 ///
 PIDX_return_code HELPER_idx_rst(PIDX_idx_rst_id rst_id);
+/*
+ * Implementation in PIDX_idx_rst_plan.c
+ */
+///
+/// \brief PIDX_idx_rst_plan_attach Finds the plan of the current decomposition in cache (or adds
+/// an empty one). The plan is replayed only if every process found its decomposition unchanged.
+/// The cache keeps the few most recently used plans.
+/// \param rst_id
+/// \param cache can be NULL, then no plan is used
+/// \return
+///
+PIDX_return_code PIDX_idx_rst_plan_attach(PIDX_idx_rst_id rst_id, PIDX_metadata_cache cache);
+
+
+
+///
+/// \brief PIDX_idx_rst_plan_staged_write Staged write with the committed datatypes and persistent
+/// requests of the plan
+/// \param rst_id
+/// \return
+///
+PIDX_return_code PIDX_idx_rst_plan_staged_write(PIDX_idx_rst_id rst_id);
+
+
+
+///
+/// \brief PIDX_idx_rst_plan_reset Frees the content of a plan, keeping its key
+/// \param plan
+///
+void PIDX_idx_rst_plan_reset(PIDX_idx_rst_plan plan);
+
+
+
+///
+/// \brief PIDX_idx_rst_free_plans Frees a list of plans
+/// \param plan
+///
+void PIDX_idx_rst_free_plans(PIDX_idx_rst_plan plan);
+
+
+
 #endif
@@ -54,9 +54,52 @@
 #include "../../PIDX_inc.h"
 
 
+// Index of the simulation patch that is exactly the super patch of this process, -1 otherwise.
+// The super patch then aliases the simulation buffer instead of being allocated and copied.
+int PIDX_idx_rst_zero_copy_patch(PIDX_idx_rst_id rst_id)
+{
+  PIDX_variable var0 = rst_id->idx_metadata->variable[rst_id->first_index];
+
+  if (var0->restructured_super_patch_count != 1 || var0->restructured_super_patch->patch_count != 1)
+    return -1;
+
+  if (rst_id->idx_debug_metadata->debug_file_output_state != PIDX_NO_META_DATA_DUMP)
+    return -1;
+
+  for (int i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
+  {
+    PIDX_super_patch irsp = rst_id->intersected_restructured_super_patch[i];
+    if (rst_id->idx_c->simulation_rank != irsp->max_patch_rank)
+      continue;
+
+    if (irsp->source_patch[0].rank != rst_id->idx_c->simulation_rank)
+      return -1;
+
+    int p_index = irsp->source_patch[0].index;
+    PIDX_patch box = irsp->restructured_patch;
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    {
+      if (irsp->patch[0]->offset[d] != box->offset[d] || irsp->patch[0]->size[d] != box->size[d])
+        return -1;
+      if (var0->sim_patch[p_index]->offset[d] != box->offset[d] || var0->sim_patch[p_index]->size[d] != box->size[d])
+        return -1;
+    }
+
+    return p_index;
+  }
+
+  return -1;
+}
+
+
+
 // Creates the buffers for all the patches that constitutes the super patch
 PIDX_return_code PIDX_idx_rst_buf_create(PIDX_idx_rst_id rst_id)
 {
+  // the super patch is the user buffer, nothing to stage
+  if (PIDX_idx_rst_zero_copy_patch(rst_id) != -1)
+    return PIDX_success;
+
   int j = 0, v = 0;
   int cnt = 0, i = 0;
 
@@ -139,6 +182,8 @@ PIDX_return_code PIDX_idx_rst_aggregate_buf_create(PIDX_idx_rst_id rst_id)
   if (var0->restructured_super_patch_count == 0)
       return PIDX_success;
 
+  int p_index = PIDX_idx_rst_zero_copy_patch(rst_id);
+
   for (uint32_t v = rst_id->first_index; v <= rst_id->last_index; ++v)
   {
     PIDX_variable var = rst_id->idx_metadata->variable[v];
@@ -146,6 +191,14 @@ PIDX_return_code PIDX_idx_rst_aggregate_buf_create(PIDX_idx_rst_id rst_id)
     // The restructured patch is the sum of all the small patches
     PIDX_patch out_patch = var->restructured_super_patch->restructured_patch;
 
+    // Read only on write, and the read lands directly in the user buffer
+    if (p_index != -1)
+    {
+      out_patch->buffer = var->sim_patch[p_index]->buffer;
+      var->restructured_super_patch->is_user_buffer = 1;
+      continue;
+    }
+
     var->restructured_super_patch->restructured_patch->buffer = malloc(out_patch->size[0] * out_patch->size[1] * out_patch->size[2] * (var->bpv/8) * var->vps);
     memset(var->restructured_super_patch->restructured_patch->buffer, 0, out_patch->size[0] * out_patch->size[1] * out_patch->size[2] * (var->bpv/8) * var->vps);
 
@@ -172,7 +225,10 @@ PIDX_return_code PIDX_idx_rst_aggregate_buf_destroy(PIDX_idx_rst_id rst_id)
   for (uint32_t v = rst_id->first_index; v <= rst_id->last_index; ++v)
   {
     PIDX_variable var = rst_id->idx_metadata->variable[v];
-    free(var->restructured_super_patch->restructured_patch->buffer);
+    if (var->restructured_super_patch->is_user_buffer == 0)
+      free(var->restructured_super_patch->restructured_patch->buffer);
+    var->restructured_super_patch->restructured_patch->buffer = 0;
+    var->restructured_super_patch->is_user_buffer = 0;
   }
 
   return PIDX_success;
@@ -196,6 +252,9 @@ PIDX_return_code PIDX_idx_rst_buf_aggregate(PIDX_idx_rst_id rst_id, int mode)
     PIDX_super_patch rst_super_patch = var->restructured_super_patch;
     PIDX_patch out_patch = rst_super_patch->restructured_patch;
 
+    if (rst_super_patch->is_user_buffer == 1)
+      continue;
+
     uint32_t nx = out_patch->size[0];
     uint32_t ny = out_patch->size[1];
 
@@ -61,10 +61,73 @@ static void calculate_number_of_intersecting_boxes(PIDX_idx_rst_id rst_id);
 static PIDX_return_code populate_all_intersecting_restructured_super_patch_meta_data(PIDX_idx_rst_id rst_id);
 static PIDX_return_code copy_reciever_patch_info(PIDX_idx_rst_id rst_id);
 static void free_patch_extents(PIDX_idx_rst_id rst_id);
+static PIDX_return_code create_intersections(PIDX_idx_rst_id rst_id);
+static PIDX_return_code exchange_patch_extents_sparse(PIDX_idx_rst_id rst_id, uint64_t** records, uint64_t* record_count);
+static PIDX_return_code populate_intersecting_super_patches_sparse(PIDX_idx_rst_id rst_id, uint64_t* records, uint64_t record_count);
+static PIDX_super_patch create_super_patch(PIDX_idx_rst_id rst_id, Ndim_empty_patch ep);
+static PIDX_return_code append_source_patch(PIDX_idx_rst_id rst_id, PIDX_super_patch patch_grp, PIDX_patch reg_patch, PIDX_patch curr_patch, int rank, int index);
+static int compare_records(const void* a, const void* b);
+
+// one record per (local patch, restructured box) intersection: rank, box index, patch index, offset, size
+#define RST_RECORD_SIZE (3 + 2 * PIDX_MAX_DIMENSIONS)
 
 
 PIDX_return_code PIDX_idx_rst_meta_data_create(PIDX_idx_rst_id rst_id)
 {
+  // The decomposition did not change since the plan was built, reuse its intersections
+  if (rst_id->plan != NULL && rst_id->plan->is_built == 1)
+  {
+    rst_id->intersected_restructured_super_patch_count = rst_id->plan->intersected_restructured_super_patch_count;
+    rst_id->intersected_restructured_super_patch = rst_id->plan->intersected_restructured_super_patch;
+    rst_id->idx_metadata->variable[rst_id->first_index]->restructured_super_patch_count = rst_id->plan->restructured_super_patch_count;
+
+    return copy_reciever_patch_info(rst_id);
+  }
+
+  PIDX_return_code ret = create_intersections(rst_id);
+  if (ret != PIDX_success)
+    return ret;
+
+  // the plan takes ownership of the intersections (see PIDX_idx_rst_meta_data_destroy)
+  if (rst_id->plan != NULL)
+  {
+    rst_id->plan->intersected_restructured_super_patch_count = rst_id->intersected_restructured_super_patch_count;
+    rst_id->plan->intersected_restructured_super_patch = rst_id->intersected_restructured_super_patch;
+    rst_id->plan->restructured_super_patch_count = rst_id->idx_metadata->variable[rst_id->first_index]->restructured_super_patch_count;
+    rst_id->plan->is_built = 1;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code create_intersections(PIDX_idx_rst_id rst_id)
+{
+  // Scalable mode: every patch is routed only to the owners of the restructured boxes it
+  // intersects, so no process ever holds the extents of all the patches
+  if (rst_id->idx_metadata->sparse_rst_meta_data == 1)
+  {
+    uint64_t* records = NULL;
+    uint64_t record_count = 0;
+
+    if (exchange_patch_extents_sparse(rst_id, &records, &record_count) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+
+    PIDX_return_code ret = populate_intersecting_super_patches_sparse(rst_id, records, record_count);
+    free(records);
+    if (ret != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+
+    return copy_reciever_patch_info(rst_id);
+  }
+
   // Gathers the extents of all patches
   // The outcome is stored in rst_id->sim_multi_patch_r_size and rst_id->sim_multi_patch_r_offset
   gather_all_patch_extents(rst_id);
@@ -229,7 +292,6 @@ static void calculate_number_of_intersecting_boxes(PIDX_idx_rst_id rst_id)
 
 static PIDX_return_code populate_all_intersecting_restructured_super_patch_meta_data(PIDX_idx_rst_id rst_id)
 {
-  uint64_t patch_count = 0;
   uint64_t found_reg_patches_count = 0, reg_patch_count = 0;
   PIDX_variable var0 = rst_id->idx_metadata->variable[rst_id->first_index];
 
@@ -277,22 +339,9 @@ static PIDX_return_code populate_all_intersecting_restructured_super_patch_meta_
           memcpy(found_reg_patches[found_reg_patches_count], reg_patch, sizeof (*reg_patch));
           found_reg_patches_count++;
 
-          rst_id->intersected_restructured_super_patch[reg_patch_count] = malloc(sizeof(*(rst_id->intersected_restructured_super_patch[reg_patch_count])));
-          memset(rst_id->intersected_restructured_super_patch[reg_patch_count], 0, sizeof(*(rst_id->intersected_restructured_super_patch[reg_patch_count])));
-
+          rst_id->intersected_restructured_super_patch[reg_patch_count] = create_super_patch(rst_id, ep);
           PIDX_super_patch patch_grp = rst_id->intersected_restructured_super_patch[reg_patch_count];
 
-          patch_grp->source_patch = (PIDX_source_patch_index*)malloc(sizeof(PIDX_source_patch_index) * rst_id->maximum_neighbor_count);
-          patch_grp->patch = malloc(sizeof(*patch_grp->patch) * rst_id->maximum_neighbor_count);
-          patch_grp->restructured_patch = malloc(sizeof(*patch_grp->restructured_patch));
-          memset(patch_grp->source_patch, 0, sizeof(PIDX_source_patch_index) * rst_id->maximum_neighbor_count);
-          memset(patch_grp->patch, 0, sizeof(*patch_grp->patch) * rst_id->maximum_neighbor_count);
-          memset(patch_grp->restructured_patch, 0, sizeof(*patch_grp->restructured_patch));
-
-          patch_count = 0;
-          patch_grp->patch_count = 0;
-          patch_grp->is_boundary_patch = ep->is_boundary_patch;
-
           // Iterate through all processes
           for (uint64_t r = 0; r < rst_id->idx_c->simulation_nprocs; r++)
           {
@@ -318,69 +367,8 @@ static PIDX_return_code populate_all_intersecting_restructured_super_patch_meta_
 
               if (intersectNDChunk(reg_patch, curr_patch))
               {
-                patch_grp->patch[patch_count] = malloc(sizeof(*(patch_grp->patch[patch_count])));
-                memset(patch_grp->patch[patch_count], 0, sizeof(*(patch_grp->patch[patch_count])));
-
-                for (uint32_t d = 0; d < PIDX_MAX_DIMENSIONS; d++)
-                {
-                  //offset and count of intersecting chunk of process with rank r and regular patch
-                  if (curr_patch->offset[d] <= reg_patch->offset[d] && (curr_patch->offset[d] + curr_patch->size[d] - 1) <= (reg_patch->offset[d] + reg_patch->size[d] - 1))
-                  {
-                    patch_grp->patch[patch_count]->offset[d] = reg_patch->offset[d];
-                    patch_grp->patch[patch_count]->size[d] = (curr_patch->offset[d] + curr_patch->size[d] - 1) - reg_patch->offset[d] + 1;
-                  }
-                  else if (reg_patch->offset[d] <= curr_patch->offset[d] && (curr_patch->offset[d] + curr_patch->size[d] - 1) >= (reg_patch->offset[d] + reg_patch->size[d] - 1))
-                  {
-                    patch_grp->patch[patch_count]->offset[d] = curr_patch->offset[d];
-                    patch_grp->patch[patch_count]->size[d] = (reg_patch->offset[d] + reg_patch->size[d] - 1) - curr_patch->offset[d] + 1;
-                  }
-                  else if (( reg_patch->offset[d] + reg_patch->size[d] - 1) <= (curr_patch->offset[d] + curr_patch->size[d] - 1) && reg_patch->offset[d] >= curr_patch->offset[d])
-                  {
-                    patch_grp->patch[patch_count]->offset[d] = reg_patch->offset[d];
-                    patch_grp->patch[patch_count]->size[d] = reg_patch->size[d];
-                  }
-                  else if (( curr_patch->offset[d] + curr_patch->size[d] - 1) <= (reg_patch->offset[d] + reg_patch->size[d] - 1) && curr_patch->offset[d] >= reg_patch->offset[d])
-                  {
-                    patch_grp->patch[patch_count]->offset[d] = curr_patch->offset[d];
-                    patch_grp->patch[patch_count]->size[d] = curr_patch->size[d];
-                  }
-
-                  //offset and count of intersecting regular patch
-                  patch_grp->restructured_patch->offset[d] = reg_patch->offset[d];
-                  patch_grp->restructured_patch->size[d] = reg_patch->size[d];
-                }
-
-                patch_grp->source_patch[patch_count].rank = r;
-                patch_grp->source_patch[patch_count].index = pc;
-                patch_count++;
-
-                if (patch_count >= rst_id->maximum_neighbor_count)
-                {
-                  rst_id->maximum_neighbor_count = rst_id->maximum_neighbor_count * 2;
-
-                  PIDX_source_patch_index *temp_buffer2 = realloc(patch_grp->source_patch, rst_id->maximum_neighbor_count * sizeof(PIDX_source_patch_index));
-                  if (temp_buffer2 == NULL)
-                  {
-                    fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
-                    return PIDX_err_rst;
-                  }
-                  else
-                    patch_grp->source_patch = temp_buffer2;
-
-                  PIDX_patch *temp_buffer3 = realloc(patch_grp->patch, rst_id->maximum_neighbor_count * sizeof(*patch_grp->patch));
-                  if (temp_buffer3 == NULL)
-                  {
-                    fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
-                    return PIDX_err_rst;
-                  }
-                  else
-                    patch_grp->patch = temp_buffer3;
-
-                  if (rst_id->idx_c->simulation_rank == 0)
-                    fprintf(stderr, "[ERROR] rst_id->maximum_neighbor_count needs to be increased\n");
-                }
-
-                patch_grp->patch_count = patch_count;
+                if (append_source_patch(rst_id, patch_grp, reg_patch, curr_patch, r, pc) != PIDX_success)
+                  return PIDX_err_rst;
               }
               free(curr_patch);
             }
@@ -588,6 +576,13 @@ PIDX_return_code PIDX_idx_rst_meta_data_destroy(PIDX_idx_rst_id rst_id)
     var->restructured_super_patch = 0;
   }
 
+  // owned by the cached plan
+  if (rst_id->plan != NULL)
+  {
+    rst_id->intersected_restructured_super_patch = 0;
+    return PIDX_success;
+  }
+
   for (uint32_t i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
   {
     PIDX_super_patch irsp = rst_id->intersected_restructured_super_patch[i];
@@ -608,6 +603,387 @@ PIDX_return_code PIDX_idx_rst_meta_data_destroy(PIDX_idx_rst_id rst_id)
 
 
 
+static PIDX_return_code exchange_patch_extents_sparse(PIDX_idx_rst_id rst_id, uint64_t** records, uint64_t* record_count)
+{
+  PIDX_variable var0 = rst_id->idx_metadata->variable[rst_id->first_index];
+  uint64_t *tpc = rst_id->restructured_grid->total_patch_count;
+  idx_comm idx_c = rst_id->idx_c;
+
+  // the exchange gets its own communicator, so that its messages can not meet the ones of the
+  // application or of another file on the same communicator
+  if (idx_c->is_nbx_comm_cached == 0)
+  {
+    if (MPI_Comm_dup(idx_c->simulation_comm, &(idx_c->nbx_comm)) != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+    idx_c->is_nbx_comm_cached = 1;
+    idx_c->nbx_round = 0;
+  }
+  MPI_Comm comm = idx_c->nbx_comm;
+
+  // one outgoing buffer per destination (the owners of the boxes my patches intersect)
+  int dest_count = 0;
+  int* dest_rank = malloc(sizeof(*dest_rank) * (var0->sim_patch_count * 8 + 1));
+  PIDX_buffer* dest_buffer = malloc(sizeof(*dest_buffer) * (var0->sim_patch_count * 8 + 1));
+  int dest_capacity = var0->sim_patch_count * 8 + 1;
+
+  for (uint64_t i = 0; i < tpc[0] * tpc[1] * tpc[2]; i++)
+  {
+    Ndim_empty_patch ep = rst_id->restructured_grid->patch[i];
+    struct PIDX_patch_struct reg_patch;
+    memset(&reg_patch, 0, sizeof(reg_patch));
+    memcpy(reg_patch.offset, ep->offset, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+    memcpy(reg_patch.size, ep->size, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+
+    for (uint64_t pc = 0; pc < var0->sim_patch_count; pc++)
+    {
+      if (!intersectNDChunk(&reg_patch, var0->sim_patch[pc]))
+        continue;
+
+      int d = 0;
+      while (d < dest_count && dest_rank[d] != ep->rank)
+        d++;
+
+      if (d == dest_count)
+      {
+        if (dest_count == dest_capacity)
+        {
+          dest_capacity = dest_capacity * 2;
+          dest_rank = realloc(dest_rank, sizeof(*dest_rank) * dest_capacity);
+          dest_buffer = realloc(dest_buffer, sizeof(*dest_buffer) * dest_capacity);
+        }
+        dest_rank[dest_count] = ep->rank;
+        dest_buffer[dest_count] = PIDX_buffer_create_empty();
+        dest_count++;
+      }
+
+      uint64_t record[RST_RECORD_SIZE];
+      record[0] = rst_id->idx_c->simulation_rank;
+      record[1] = i;
+      record[2] = pc;
+      memcpy(record + 3, var0->sim_patch[pc]->offset, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+      memcpy(record + 3 + PIDX_MAX_DIMENSIONS, var0->sim_patch[pc]->size, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+      PIDX_buffer_append(&dest_buffer[d], (unsigned char*)record, sizeof(record));
+    }
+  }
+
+  PIDX_buffer received = PIDX_buffer_create_empty();
+  int ret = MPI_SUCCESS;
+
+#if MPI_VERSION >= 3
+  // Non-blocking consensus: synchronous sends complete once matched, then an Ibarrier tells
+  // every process that no more messages are coming. Two tags alternate between consecutive
+  // calls so that a fast process can not be matched by a receive of the previous exchange.
+  int tag = 201 + (idx_c->nbx_round & 1);
+  idx_c->nbx_round++;
+
+  MPI_Request* send_req = malloc(sizeof(*send_req) * (dest_count + 1));
+  for (int d = 0; d < dest_count && ret == MPI_SUCCESS; d++)
+    ret = MPI_Issend(dest_buffer[d].buffer, dest_buffer[d].size / sizeof(uint64_t), MPI_UNSIGNED_LONG_LONG, dest_rank[d], tag, comm, &send_req[d]);
+
+  MPI_Request barrier_req;
+  int barrier_active = 0;
+  int done = 0;
+  while (!done && ret == MPI_SUCCESS)
+  {
+    int flag = 0;
+    MPI_Status status;
+    ret = MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &flag, &status);
+    if (ret == MPI_SUCCESS && flag)
+    {
+      int count = 0;
+      MPI_Get_count(&status, MPI_UNSIGNED_LONG_LONG, &count);
+
+      uint64_t* message = malloc(sizeof(*message) * (count + 1));
+      ret = MPI_Recv(message, count, MPI_UNSIGNED_LONG_LONG, status.MPI_SOURCE, tag, comm, MPI_STATUS_IGNORE);
+      PIDX_buffer_append(&received, (unsigned char*)message, count * sizeof(uint64_t));
+      free(message);
+    }
+
+    if (ret != MPI_SUCCESS)
+      break;
+
+    if (barrier_active)
+      ret = MPI_Test(&barrier_req, &done, MPI_STATUS_IGNORE);
+    else
+    {
+      int sent = 0;
+      ret = MPI_Testall(dest_count, send_req, &sent, MPI_STATUSES_IGNORE);
+      if (ret == MPI_SUCCESS && sent)
+      {
+        ret = MPI_Ibarrier(comm, &barrier_req);
+        barrier_active = 1;
+      }
+    }
+  }
+  free(send_req);
+#else
+  // MPI-2 fallback: only the per-process record counts are exchanged with an all-to-all
+  int nprocs = rst_id->idx_c->simulation_nprocs;
+  int* send_count = malloc(sizeof(*send_count) * nprocs);
+  int* recv_count = malloc(sizeof(*recv_count) * nprocs);
+  int* send_offset = malloc(sizeof(*send_offset) * nprocs);
+  int* recv_offset = malloc(sizeof(*recv_offset) * nprocs);
+  memset(send_count, 0, sizeof(*send_count) * nprocs);
+
+  PIDX_buffer send = PIDX_buffer_create_empty();
+  for (int r = 0; r < nprocs; r++)
+  {
+    send_offset[r] = send.size / sizeof(uint64_t);
+    for (int d = 0; d < dest_count; d++)
+    {
+      if (dest_rank[d] != r)
+        continue;
+      send_count[r] = dest_buffer[d].size / sizeof(uint64_t);
+      PIDX_buffer_append(&send, dest_buffer[d].buffer, dest_buffer[d].size);
+    }
+  }
+
+  ret = MPI_Alltoall(send_count, 1, MPI_INT, recv_count, 1, MPI_INT, comm);
+
+  uint64_t total = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    recv_offset[r] = total;
+    total = total + recv_count[r];
+  }
+
+  uint64_t* message = malloc(sizeof(*message) * (total + 1));
+  if (ret == MPI_SUCCESS)
+    ret = MPI_Alltoallv(send.buffer, send_count, send_offset, MPI_UNSIGNED_LONG_LONG, message, recv_count, recv_offset, MPI_UNSIGNED_LONG_LONG, comm);
+  PIDX_buffer_append(&received, (unsigned char*)message, total * sizeof(uint64_t));
+
+  free(message);
+  PIDX_buffer_free(&send);
+  free(send_count);
+  free(recv_count);
+  free(send_offset);
+  free(recv_offset);
+#endif
+
+  for (int d = 0; d < dest_count; d++)
+    PIDX_buffer_free(&dest_buffer[d]);
+  free(dest_buffer);
+  free(dest_rank);
+
+  if (ret != MPI_SUCCESS)
+  {
+    PIDX_buffer_free(&received);
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_mpi;
+  }
+
+  *record_count = received.size / (RST_RECORD_SIZE * sizeof(uint64_t));
+  *records = malloc(sizeof(uint64_t) * RST_RECORD_SIZE * (*record_count + 1));
+  memcpy(*records, received.buffer, received.size);
+  PIDX_buffer_free(&received);
+
+  // same (rank, patch index) order as the Allgather scan, the staged send/recv rely on it
+  qsort(*records, *record_count, RST_RECORD_SIZE * sizeof(uint64_t), compare_records);
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_return_code populate_intersecting_super_patches_sparse(PIDX_idx_rst_id rst_id, uint64_t* records, uint64_t record_count)
+{
+  PIDX_variable var0 = rst_id->idx_metadata->variable[rst_id->first_index];
+  uint64_t *tpc = rst_id->restructured_grid->total_patch_count;
+  int rank = rst_id->idx_c->simulation_rank;
+
+  var0->restructured_super_patch_count = 0;
+
+  // first pass counts the boxes I own or send to, the second one fills them in box order
+  for (int pass = 0; pass < 2; pass++)
+  {
+    uint64_t reg_patch_count = 0;
+    for (uint64_t i = 0; i < tpc[0] * tpc[1] * tpc[2]; i++)
+    {
+      Ndim_empty_patch ep = rst_id->restructured_grid->patch[i];
+      struct PIDX_patch_struct reg_patch;
+      memset(&reg_patch, 0, sizeof(reg_patch));
+      memcpy(reg_patch.offset, ep->offset, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+      memcpy(reg_patch.size, ep->size, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+
+      int intersects = (rank == ep->rank);
+      for (uint64_t pc = 0; pc < var0->sim_patch_count && !intersects; pc++)
+        intersects = intersectNDChunk(&reg_patch, var0->sim_patch[pc]);
+
+      if (!intersects)
+        continue;
+
+      if (pass == 0)
+      {
+        reg_patch_count++;
+        continue;
+      }
+
+      PIDX_super_patch patch_grp = create_super_patch(rst_id, ep);
+      rst_id->intersected_restructured_super_patch[reg_patch_count] = patch_grp;
+
+      if (rank == ep->rank)
+      {
+        // the owner learns about every intersecting patch from the received records
+        for (uint64_t k = 0; k < record_count; k++)
+        {
+          uint64_t* record = records + k * RST_RECORD_SIZE;
+          if (record[1] != i)
+            continue;
+
+          struct PIDX_patch_struct curr_patch;
+          memset(&curr_patch, 0, sizeof(curr_patch));
+          memcpy(curr_patch.offset, record + 3, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+          memcpy(curr_patch.size, record + 3 + PIDX_MAX_DIMENSIONS, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+
+          if (append_source_patch(rst_id, patch_grp, &reg_patch, &curr_patch, (int)record[0], (int)record[2]) != PIDX_success)
+            return PIDX_err_rst;
+        }
+
+        var0->restructured_super_patch_count = var0->restructured_super_patch_count + 1;
+        assert (var0->restructured_super_patch_count <= 1);
+      }
+      else
+      {
+        // a sender only needs its own pieces of the box
+        for (uint64_t pc = 0; pc < var0->sim_patch_count; pc++)
+        {
+          if (!intersectNDChunk(&reg_patch, var0->sim_patch[pc]))
+            continue;
+
+          if (append_source_patch(rst_id, patch_grp, &reg_patch, var0->sim_patch[pc], rank, pc) != PIDX_success)
+            return PIDX_err_rst;
+        }
+      }
+
+      reg_patch_count++;
+    }
+
+    if (pass == 0)
+    {
+      rst_id->intersected_restructured_super_patch_count = reg_patch_count;
+      rst_id->intersected_restructured_super_patch = malloc(sizeof(*rst_id->intersected_restructured_super_patch) * (reg_patch_count + 1));
+      memset(rst_id->intersected_restructured_super_patch, 0, sizeof(*rst_id->intersected_restructured_super_patch) * (reg_patch_count + 1));
+    }
+  }
+
+  return PIDX_success;
+}
+
+
+
+static PIDX_super_patch create_super_patch(PIDX_idx_rst_id rst_id, Ndim_empty_patch ep)
+{
+  PIDX_super_patch patch_grp = malloc(sizeof(*patch_grp));
+  memset(patch_grp, 0, sizeof(*patch_grp));
+
+  patch_grp->source_patch = (PIDX_source_patch_index*)malloc(sizeof(PIDX_source_patch_index) * rst_id->maximum_neighbor_count);
+  patch_grp->patch = malloc(sizeof(*patch_grp->patch) * rst_id->maximum_neighbor_count);
+  patch_grp->restructured_patch = malloc(sizeof(*patch_grp->restructured_patch));
+  memset(patch_grp->source_patch, 0, sizeof(PIDX_source_patch_index) * rst_id->maximum_neighbor_count);
+  memset(patch_grp->patch, 0, sizeof(*patch_grp->patch) * rst_id->maximum_neighbor_count);
+  memset(patch_grp->restructured_patch, 0, sizeof(*patch_grp->restructured_patch));
+
+  patch_grp->patch_count = 0;
+  patch_grp->is_boundary_patch = ep->is_boundary_patch;
+  patch_grp->max_patch_rank = ep->rank;
+
+  return patch_grp;
+}
+
+
+
+// Appends the intersection of curr_patch (patch index of process rank) with the restructured patch
+static PIDX_return_code append_source_patch(PIDX_idx_rst_id rst_id, PIDX_super_patch patch_grp, PIDX_patch reg_patch, PIDX_patch curr_patch, int rank, int index)
+{
+  uint32_t patch_count = patch_grp->patch_count;
+
+  patch_grp->patch[patch_count] = malloc(sizeof(*(patch_grp->patch[patch_count])));
+  memset(patch_grp->patch[patch_count], 0, sizeof(*(patch_grp->patch[patch_count])));
+
+  for (uint32_t d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    //offset and count of intersecting chunk of process with rank r and regular patch
+    if (curr_patch->offset[d] <= reg_patch->offset[d] && (curr_patch->offset[d] + curr_patch->size[d] - 1) <= (reg_patch->offset[d] + reg_patch->size[d] - 1))
+    {
+      patch_grp->patch[patch_count]->offset[d] = reg_patch->offset[d];
+      patch_grp->patch[patch_count]->size[d] = (curr_patch->offset[d] + curr_patch->size[d] - 1) - reg_patch->offset[d] + 1;
+    }
+    else if (reg_patch->offset[d] <= curr_patch->offset[d] && (curr_patch->offset[d] + curr_patch->size[d] - 1) >= (reg_patch->offset[d] + reg_patch->size[d] - 1))
+    {
+      patch_grp->patch[patch_count]->offset[d] = curr_patch->offset[d];
+      patch_grp->patch[patch_count]->size[d] = (reg_patch->offset[d] + reg_patch->size[d] - 1) - curr_patch->offset[d] + 1;
+    }
+    else if (( reg_patch->offset[d] + reg_patch->size[d] - 1) <= (curr_patch->offset[d] + curr_patch->size[d] - 1) && reg_patch->offset[d] >= curr_patch->offset[d])
+    {
+      patch_grp->patch[patch_count]->offset[d] = reg_patch->offset[d];
+      patch_grp->patch[patch_count]->size[d] = reg_patch->size[d];
+    }
+    else if (( curr_patch->offset[d] + curr_patch->size[d] - 1) <= (reg_patch->offset[d] + reg_patch->size[d] - 1) && curr_patch->offset[d] >= reg_patch->offset[d])
+    {
+      patch_grp->patch[patch_count]->offset[d] = curr_patch->offset[d];
+      patch_grp->patch[patch_count]->size[d] = curr_patch->size[d];
+    }
+
+    //offset and count of intersecting regular patch
+    patch_grp->restructured_patch->offset[d] = reg_patch->offset[d];
+    patch_grp->restructured_patch->size[d] = reg_patch->size[d];
+  }
+
+  patch_grp->source_patch[patch_count].rank = rank;
+  patch_grp->source_patch[patch_count].index = index;
+  patch_count++;
+
+  if (patch_count >= rst_id->maximum_neighbor_count)
+  {
+    rst_id->maximum_neighbor_count = rst_id->maximum_neighbor_count * 2;
+
+    PIDX_source_patch_index *temp_buffer2 = realloc(patch_grp->source_patch, rst_id->maximum_neighbor_count * sizeof(PIDX_source_patch_index));
+    if (temp_buffer2 == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+    else
+      patch_grp->source_patch = temp_buffer2;
+
+    PIDX_patch *temp_buffer3 = realloc(patch_grp->patch, rst_id->maximum_neighbor_count * sizeof(*patch_grp->patch));
+    if (temp_buffer3 == NULL)
+    {
+      fprintf(stderr, "[%s] [%d] realloc() failed.\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+    else
+      patch_grp->patch = temp_buffer3;
+
+    if (rst_id->idx_c->simulation_rank == 0)
+      fprintf(stderr, "[ERROR] rst_id->maximum_neighbor_count needs to be increased\n");
+  }
+
+  patch_grp->patch_count = patch_count;
+
+  return PIDX_success;
+}
+
+
+
+static int compare_records(const void* a, const void* b)
+{
+  const uint64_t* ra = a;
+  const uint64_t* rb = b;
+
+  if (ra[0] != rb[0])
+    return (ra[0] < rb[0]) ? -1 : 1;
+  if (ra[2] != rb[2])
+    return (ra[2] < rb[2]) ? -1 : 1;
+
+  return 0;
+}
+
+
+
 // Function to check if patches A and B intersects
 static int intersectNDChunk(PIDX_patch A, PIDX_patch B)
 {
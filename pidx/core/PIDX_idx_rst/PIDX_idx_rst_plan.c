@@ -0,0 +1,539 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file PIDX_idx_rst_plan.c
+ *
+ * Restructuring plans cached on the PIDX_metadata_cache. A plan is keyed by the
+ * local decomposition (patches, restructured grid, variable types) and holds the
+ * intersections computed by PIDX_idx_rst_meta_data_create together with the
+ * committed send datatypes and persistent requests of the staged write, so that
+ * time steps with an unchanged decomposition replay them instead of rebuilding.
+ *
+ */
+
+#include "../../PIDX_inc.h"
+
+// plans kept by a cache, the least recently used one is freed beyond that
+#define RST_PLAN_CACHE_SIZE 4
+
+struct staged_op
+{
+  void* buffer;
+  int count;
+  MPI_Datatype type;
+  int peer;
+  int is_send;
+};
+
+static void build_key(PIDX_idx_rst_id rst_id, uint64_t** key, uint64_t* key_size);
+static uint64_t hash_key(const uint64_t* key, uint64_t key_size);
+static void free_plan_requests(PIDX_idx_rst_plan plan);
+static PIDX_return_code build_plan_datatypes(PIDX_idx_rst_id rst_id, PIDX_idx_rst_plan plan);
+static int list_variable_ops(PIDX_idx_rst_id rst_id, PIDX_idx_rst_plan plan, int v, struct staged_op* op);
+static void copy_local_patches(PIDX_idx_rst_id rst_id, int v);
+static void use_plan(PIDX_metadata_cache cache, PIDX_idx_rst_plan plan);
+
+
+PIDX_return_code PIDX_idx_rst_plan_attach(PIDX_idx_rst_id rst_id, PIDX_metadata_cache cache)
+{
+  rst_id->plan = NULL;
+  if (cache == NULL)
+    return PIDX_success;
+
+  uint64_t* key;
+  uint64_t key_size;
+  build_key(rst_id, &key, &key_size);
+  uint64_t hash = hash_key(key, key_size);
+
+  PIDX_idx_rst_plan plan = cache->rst_plan;
+  while (plan != NULL && !(plan->hash == hash && plan->key_size == key_size && memcmp(plan->key, key, key_size * sizeof(*key)) == 0))
+    plan = plan->next;
+
+  // the intersections depend on the patches of every process, so a plan is only
+  // replayed when no process saw a change in its own decomposition
+  int local_match = (plan != NULL && plan->is_built == 1);
+  int global_match = 0;
+  if (MPI_Allreduce(&local_match, &global_match, 1, MPI_INT, MPI_MIN, rst_id->idx_c->simulation_comm) != MPI_SUCCESS)
+  {
+    free(key);
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_mpi;
+  }
+
+  if (global_match == 1)
+  {
+    free(key);
+    use_plan(cache, plan);
+    rst_id->plan = plan;
+    return PIDX_success;
+  }
+
+  if (plan != NULL)
+  {
+    // same local decomposition but some other process changed, rebuild in place
+    PIDX_idx_rst_plan next = plan->next;
+    PIDX_idx_rst_plan_reset(plan);
+    plan->next = next;
+    free(key);
+  }
+  else
+  {
+    plan = malloc(sizeof(*plan));
+    memset(plan, 0, sizeof(*plan));
+    plan->key = key;
+    plan->key_size = key_size;
+    plan->hash = hash;
+    plan->next = cache->rst_plan;
+    cache->rst_plan = plan;
+  }
+
+  use_plan(cache, plan);
+  rst_id->plan = plan;
+
+  return PIDX_success;
+}
+
+
+
+// Moves plan to the front of the list of the cache and frees the plans beyond RST_PLAN_CACHE_SIZE,
+// so that a decomposition changing at every time step does not keep all its plans
+static void use_plan(PIDX_metadata_cache cache, PIDX_idx_rst_plan plan)
+{
+  if (cache->rst_plan != plan)
+  {
+    PIDX_idx_rst_plan prev = cache->rst_plan;
+    while (prev->next != plan)
+      prev = prev->next;
+    prev->next = plan->next;
+
+    plan->next = cache->rst_plan;
+    cache->rst_plan = plan;
+  }
+
+  PIDX_idx_rst_plan last = plan;
+  for (int count = 1; last->next != NULL && count < RST_PLAN_CACHE_SIZE; count++)
+    last = last->next;
+
+  // PIDX_idx_rst_free_plans releases the requests and datatypes of every evicted plan
+  PIDX_idx_rst_free_plans(last->next);
+  last->next = NULL;
+
+  return;
+}
+
+
+
+PIDX_return_code PIDX_idx_rst_plan_staged_write(PIDX_idx_rst_id rst_id)
+{
+  PIDX_idx_rst_plan plan = rst_id->plan;
+  int variable_count = rst_id->last_index - rst_id->first_index + 1;
+
+  // the plan outlives the file it was built for, a file opened on another communicator
+  // (with the same decomposition) needs requests bound to that communicator
+  if (plan->request != NULL && plan->comm != rst_id->idx_c->simulation_comm)
+    free_plan_requests(plan);
+
+  if (plan->datatype == NULL)
+  {
+    if (build_plan_datatypes(rst_id, plan) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+  }
+
+  if (plan->request == NULL)
+  {
+    plan->request = malloc(sizeof(*plan->request) * (plan->request_count * variable_count + 1));
+    plan->request_buffer = malloc(sizeof(*plan->request_buffer) * (plan->request_count * variable_count + 1));
+    plan->comm = rst_id->idx_c->simulation_comm;
+    for (int i = 0; i < plan->request_count * variable_count; i++)
+    {
+      plan->request[i] = MPI_REQUEST_NULL;
+      plan->request_buffer[i] = NULL;
+    }
+  }
+
+  struct staged_op* op = malloc(sizeof(*op) * (plan->request_count + 1));
+
+  for (int v = rst_id->first_index; v <= rst_id->last_index; v++)
+  {
+    int vi = v - rst_id->first_index;
+    MPI_Request* request = plan->request + vi * plan->request_count;
+    void** request_buffer = plan->request_buffer + vi * plan->request_count;
+
+    int op_count = list_variable_ops(rst_id, plan, v, op);
+    assert(op_count == plan->request_count);
+
+    // persistent requests are bound to buffer addresses, rebind the ones that moved
+    for (int r = 0; r < op_count; r++)
+    {
+      if (request[r] != MPI_REQUEST_NULL && request_buffer[r] == op[r].buffer)
+        continue;
+
+      if (request[r] != MPI_REQUEST_NULL)
+        MPI_Request_free(&request[r]);
+
+      int ret;
+      if (op[r].is_send)
+        ret = MPI_Send_init(op[r].buffer, op[r].count, op[r].type, op[r].peer, 123, rst_id->idx_c->simulation_comm, &request[r]);
+      else
+        ret = MPI_Recv_init(op[r].buffer, op[r].count, op[r].type, op[r].peer, 123, rst_id->idx_c->simulation_comm, &request[r]);
+
+      if (ret != MPI_SUCCESS)
+      {
+        free(op);
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_mpi;
+      }
+      request_buffer[r] = op[r].buffer;
+    }
+
+    if (op_count != 0 && MPI_Startall(op_count, request) != MPI_SUCCESS)
+    {
+      free(op);
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_mpi;
+    }
+
+    copy_local_patches(rst_id, v);
+
+    if (op_count != 0 && MPI_Waitall(op_count, request, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+    {
+      free(op);
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_mpi;
+    }
+  }
+  free(op);
+
+  return PIDX_success;
+}
+
+
+
+void PIDX_idx_rst_plan_reset(PIDX_idx_rst_plan plan)
+{
+  free_plan_requests(plan);
+
+  for (int i = 0; i < plan->intersected_restructured_super_patch_count; i++)
+  {
+    PIDX_super_patch irsp = plan->intersected_restructured_super_patch[i];
+    for (uint32_t j = 0; j < irsp->patch_count; j++)
+      free(irsp->patch[j]);
+
+    free(irsp->source_patch);
+    free(irsp->patch);
+    free(irsp->restructured_patch);
+    free(irsp);
+  }
+  free(plan->intersected_restructured_super_patch);
+
+  uint64_t* key = plan->key;
+  uint64_t key_size = plan->key_size;
+  uint64_t hash = plan->hash;
+
+  memset(plan, 0, sizeof(*plan));
+  plan->key = key;
+  plan->key_size = key_size;
+  plan->hash = hash;
+
+  return;
+}
+
+
+
+void PIDX_idx_rst_free_plans(PIDX_idx_rst_plan plan)
+{
+  while (plan != NULL)
+  {
+    PIDX_idx_rst_plan next = plan->next;
+    PIDX_idx_rst_plan_reset(plan);
+    free(plan->key);
+    free(plan);
+    plan = next;
+  }
+
+  return;
+}
+
+
+
+static void free_plan_requests(PIDX_idx_rst_plan plan)
+{
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+
+  int variable_count = plan->variable_count;
+  if (plan->request != NULL)
+  {
+    for (int i = 0; i < plan->request_count * variable_count; i++)
+      if (!finalized && plan->request[i] != MPI_REQUEST_NULL)
+        MPI_Request_free(&plan->request[i]);
+    free(plan->request);
+    free(plan->request_buffer);
+  }
+
+  free(plan->datatype);
+  PIDX_idx_rst_free_patch_types(&plan->type_cache);
+
+  plan->request = NULL;
+  plan->request_buffer = NULL;
+  plan->datatype = NULL;
+
+  return;
+}
+
+
+
+// Everything the intersections and the send datatypes depend on, as seen by this process
+static void build_key(PIDX_idx_rst_id rst_id, uint64_t** key, uint64_t* key_size)
+{
+  PIDX_variable var0 = rst_id->idx_metadata->variable[rst_id->first_index];
+  uint64_t *tpc = rst_id->restructured_grid->total_patch_count;
+  uint64_t box_count = tpc[0] * tpc[1] * tpc[2];
+
+  uint64_t size = 4 + 2 * (rst_id->last_index - rst_id->first_index + 1) + 1 + var0->sim_patch_count * 2 * PIDX_MAX_DIMENSIONS + PIDX_MAX_DIMENSIONS + box_count * (2 * PIDX_MAX_DIMENSIONS + 2);
+  uint64_t* k = malloc(sizeof(*k) * size);
+  memset(k, 0, sizeof(*k) * size);
+
+  uint64_t n = 0;
+  k[n++] = rst_id->idx_c->simulation_nprocs;
+  k[n++] = rst_id->idx_c->simulation_rank;
+  k[n++] = rst_id->first_index;
+  k[n++] = rst_id->last_index;
+
+  for (int v = rst_id->first_index; v <= rst_id->last_index; v++)
+  {
+    k[n++] = rst_id->idx_metadata->variable[v]->bpv;
+    k[n++] = rst_id->idx_metadata->variable[v]->vps;
+  }
+
+  k[n++] = var0->sim_patch_count;
+  for (int p = 0; p < var0->sim_patch_count; p++)
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    {
+      k[n++] = var0->sim_patch[p]->offset[d];
+      k[n++] = var0->sim_patch[p]->size[d];
+    }
+
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    k[n++] = tpc[d];
+
+  for (uint64_t i = 0; i < box_count; i++)
+  {
+    Ndim_empty_patch ep = rst_id->restructured_grid->patch[i];
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    {
+      k[n++] = ep->offset[d];
+      k[n++] = ep->size[d];
+    }
+    k[n++] = ep->rank;
+    k[n++] = ep->is_boundary_patch;
+  }
+
+  *key = k;
+  *key_size = n;
+
+  return;
+}
+
+
+
+// FNV-1a over the bytes of the key
+static uint64_t hash_key(const uint64_t* key, uint64_t key_size)
+{
+  const unsigned char* bytes = (const unsigned char*)key;
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (uint64_t i = 0; i < key_size * sizeof(*key); i++)
+  {
+    hash = hash ^ bytes[i];
+    hash = hash * 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+
+
+// Commits the send datatypes of every variable once, and counts the requests per variable
+static PIDX_return_code build_plan_datatypes(PIDX_idx_rst_id rst_id, PIDX_idx_rst_plan plan)
+{
+  int variable_count = rst_id->last_index - rst_id->first_index + 1;
+  int rank = rst_id->idx_c->simulation_rank;
+
+  plan->variable_count = variable_count;
+  plan->request_count = 0;
+  plan->datatype_count = 0;
+
+  for (int i = 0; i < plan->intersected_restructured_super_patch_count; i++)
+  {
+    PIDX_super_patch irsp = plan->intersected_restructured_super_patch[i];
+    for (uint32_t j = 0; j < irsp->patch_count; j++)
+    {
+      if (rank == irsp->max_patch_rank && rank != irsp->source_patch[j].rank)
+        plan->request_count++;
+      else if (rank != irsp->max_patch_rank && rank == irsp->source_patch[j].rank)
+      {
+        plan->request_count++;
+        plan->datatype_count++;
+      }
+    }
+  }
+
+  plan->datatype = malloc(sizeof(*plan->datatype) * (plan->datatype_count * variable_count + 1));
+  memset(plan->datatype, 0, sizeof(*plan->datatype) * (plan->datatype_count * variable_count + 1));
+
+  for (int v = rst_id->first_index; v <= rst_id->last_index; v++)
+  {
+    PIDX_variable var = rst_id->idx_metadata->variable[v];
+    int t = (v - rst_id->first_index) * plan->datatype_count;
+
+    for (int i = 0; i < plan->intersected_restructured_super_patch_count; i++)
+    {
+      PIDX_super_patch irsp = plan->intersected_restructured_super_patch[i];
+      if (rank == irsp->max_patch_rank)
+        continue;
+
+      for (uint32_t j = 0; j < irsp->patch_count; j++)
+      {
+        if (rank != irsp->source_patch[j].rank)
+          continue;
+
+        int p_index = irsp->source_patch[j].index;
+        if (PIDX_idx_rst_patch_type(&plan->type_cache, rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index], irsp->patch[j], var->vps * var->bpv/8, &plan->datatype[t]) != PIDX_success)
+        {
+          fprintf(stderr, "File %s Line %d\n", __FILE__, __LINE__);
+          return PIDX_err_rst;
+        }
+        t++;
+      }
+    }
+  }
+
+  return PIDX_success;
+}
+
+
+
+// Lists the receives and sends of variable v in a fixed order (the order of the requests)
+static int list_variable_ops(PIDX_idx_rst_id rst_id, PIDX_idx_rst_plan plan, int v, struct staged_op* op)
+{
+  PIDX_variable var = rst_id->idx_metadata->variable[v];
+  int rank = rst_id->idx_c->simulation_rank;
+  int t = (v - rst_id->first_index) * plan->datatype_count;
+  int op_count = 0;
+
+  for (int i = 0; i < plan->intersected_restructured_super_patch_count; i++)
+  {
+    PIDX_super_patch irsp = plan->intersected_restructured_super_patch[i];
+    for (uint32_t j = 0; j < irsp->patch_count; j++)
+    {
+      if (rank == irsp->max_patch_rank && rank != irsp->source_patch[j].rank)
+      {
+        uint64_t *reg_patch_count = irsp->patch[j]->size;
+        op[op_count].buffer = var->restructured_super_patch->patch[j]->buffer;
+        op[op_count].count = (reg_patch_count[0] * reg_patch_count[1] * reg_patch_count[2]) * var->vps * var->bpv/8;
+        op[op_count].type = MPI_BYTE;
+        op[op_count].peer = irsp->source_patch[j].rank;
+        op[op_count].is_send = 0;
+        op_count++;
+      }
+      else if (rank != irsp->max_patch_rank && rank == irsp->source_patch[j].rank)
+      {
+        op[op_count].buffer = var->sim_patch[irsp->source_patch[j].index]->buffer;
+        op[op_count].count = 1;
+        op[op_count].type = plan->datatype[t++];
+        op[op_count].peer = irsp->max_patch_rank;
+        op[op_count].is_send = 1;
+        op_count++;
+      }
+    }
+  }
+
+  return op_count;
+}
+
+
+
+// Pieces of the super patch I hold that come from my own patches
+static void copy_local_patches(PIDX_idx_rst_id rst_id, int v)
+{
+  PIDX_variable var = rst_id->idx_metadata->variable[v];
+  int rank = rst_id->idx_c->simulation_rank;
+
+  for (int i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
+  {
+    PIDX_super_patch irsp = rst_id->intersected_restructured_super_patch[i];
+    if (rank != irsp->max_patch_rank || var->restructured_super_patch->is_user_buffer == 1)
+      continue;
+
+    for (uint32_t j = 0; j < irsp->patch_count; j++)
+    {
+      if (rank != irsp->source_patch[j].rank)
+        continue;
+
+      uint64_t *reg_patch_offset = irsp->patch[j]->offset;
+      uint64_t *reg_patch_count  = irsp->patch[j]->size;
+      int p_index = irsp->source_patch[j].index;
+      uint64_t *sim_patch_offset = rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index]->offset;
+      uint64_t *sim_patch_count = rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index]->size;
+      uint64_t send_c = reg_patch_count[0] * var->vps;
+
+      uint64_t count1 = 0;
+      for (uint64_t k1 = reg_patch_offset[2]; k1 < reg_patch_offset[2] + reg_patch_count[2]; k1++)
+        for (uint64_t j1 = reg_patch_offset[1]; j1 < reg_patch_offset[1] + reg_patch_count[1]; j1++)
+        {
+          uint64_t index = (sim_patch_count[0] * sim_patch_count[1] * (k1 - sim_patch_offset[2])) +
+                           (sim_patch_count[0] * (j1 - sim_patch_offset[1])) +
+                           (reg_patch_offset[0] - sim_patch_offset[0]);
+          uint64_t send_o = index * var->vps;
+
+          memcpy(var->restructured_super_patch->patch[j]->buffer + (count1 * send_c * var->bpv/8), var->sim_patch[p_index]->buffer + send_o * var->bpv/8, send_c * var->bpv/8);
+          count1++;
+        }
+    }
+  }
+
+  return;
+}
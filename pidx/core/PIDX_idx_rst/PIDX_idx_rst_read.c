@@ -58,15 +58,13 @@ PIDX_return_code PIDX_idx_rst_read(PIDX_idx_rst_id rst_id)
 {
   uint64_t k1 = 0, i1 = 0, j1 = 0;
   uint64_t i, j, v, index, count1 = 0, req_count = 0;
-  int *send_count, *send_offset;
-  uint64_t counter = 0, req_counter = 0, chunk_counter = 0;
+  uint64_t counter = 0, req_counter = 0;
   uint64_t send_c;
   uint64_t send_o;
   int ret = 0;
 
   MPI_Request *req;
   MPI_Status *status;
-  MPI_Datatype *chunk_data_type;
 
   //fprintf(stderr, "rst_id->intersected_restructured_super_patch_count = %d\n", rst_id->intersected_restructured_super_patch_count);
   for (i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
@@ -90,14 +88,6 @@ PIDX_return_code PIDX_idx_rst_read(PIDX_idx_rst_id rst_id)
   }
   memset(status, 0, sizeof (*status) * req_count * 2 * (rst_id->last_index - rst_id->first_index + 1));
 
-  chunk_data_type = malloc(sizeof (*chunk_data_type) * req_count * (rst_id->last_index - rst_id->first_index + 1));
-  if (!chunk_data_type)
-  {
-    fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
-    return (-1);
-  }
-  memset(chunk_data_type, 0, sizeof (*chunk_data_type) * req_count * (rst_id->last_index - rst_id->first_index + 1));
-
   for (i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
   {
     if (rst_id->idx_c->simulation_rank == rst_id->intersected_restructured_super_patch[i]->max_patch_rank)
@@ -129,6 +119,10 @@ PIDX_return_code PIDX_idx_rst_read(PIDX_idx_rst_id rst_id)
                   send_o = index * var->vps;
                   send_c = reg_patch_count[0] * var->vps;
 
+                  // already read into the user buffer
+                  if (var->restructured_super_patch->is_user_buffer == 1)
+                    continue;
+
                   memcpy(var->sim_patch[p_index]->buffer + send_o * var->bpv/8, var->restructured_super_patch->patch[j]->buffer + (count1 * send_c * var->bpv/8), send_c * var->bpv/8);
 
                   //double a1;
@@ -169,50 +163,16 @@ PIDX_return_code PIDX_idx_rst_read(PIDX_idx_rst_id rst_id)
           {
             PIDX_variable var = rst_id->idx_metadata->variable[v];
 
-            uint64_t *reg_patch_count = rst_id->intersected_restructured_super_patch[i]->patch[j]->size;
-            uint64_t *reg_patch_offset = rst_id->intersected_restructured_super_patch[i]->patch[j]->offset;
-
-            send_offset = malloc(sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
-            if (!send_offset)
-            {
-              fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
-              return PIDX_err_mpi;
-            }
-            memset(send_offset, 0, sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
+            int p_index =  rst_id->intersected_restructured_super_patch[i]->source_patch[j].index;
 
-            send_count = malloc(sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
-            if (!send_count)
+            MPI_Datatype patch_type;
+            if (PIDX_idx_rst_patch_type(&rst_id->type_cache, rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index], rst_id->intersected_restructured_super_patch[i]->patch[j], var->vps * var->bpv/8, &patch_type) != PIDX_success)
             {
               fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
               return PIDX_err_mpi;
             }
-            memset(send_count, 0, sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
-
-            count1 = 0;
 
-            int p_index =  rst_id->intersected_restructured_super_patch[i]->source_patch[j].index;
-
-            uint64_t *sim_patch_count  = rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index]->size;
-            uint64_t *sim_patch_offset = rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index]->offset;
-
-            for (k1 = reg_patch_offset[2]; k1 < reg_patch_offset[2] + reg_patch_count[2]; k1++)
-              for (j1 = reg_patch_offset[1]; j1 < reg_patch_offset[1] + reg_patch_count[1]; j1++)
-                for (i1 = reg_patch_offset[0]; i1 < reg_patch_offset[0] + reg_patch_count[0]; i1 = i1 + reg_patch_count[0])
-                {
-
-                  index = (sim_patch_count[0] * sim_patch_count[1] * (k1 - sim_patch_offset[2])) +
-                      (sim_patch_count[0] * (j1 - sim_patch_offset[1])) +
-                      (i1 - sim_patch_offset[0]);
-                  send_offset[count1] = index * var->vps * var->bpv/8;
-                  send_count[count1] = reg_patch_count[0] * var->vps * var->bpv/8;
-
-                  count1++;
-                }
-
-            MPI_Type_indexed(count1, send_count, send_offset, MPI_BYTE, &chunk_data_type[chunk_counter]);
-            MPI_Type_commit(&chunk_data_type[chunk_counter]);
-
-            ret = MPI_Irecv(var->sim_patch[p_index]->buffer, 1, chunk_data_type[chunk_counter], rst_id->intersected_restructured_super_patch[i]->max_patch_rank, 123, rst_id->idx_c->simulation_comm, &req[req_counter]);
+            ret = MPI_Irecv(var->sim_patch[p_index]->buffer, 1, patch_type, rst_id->intersected_restructured_super_patch[i]->max_patch_rank, 123, rst_id->idx_c->simulation_comm, &req[req_counter]);
             if (ret != MPI_SUCCESS)
             {
               fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
@@ -220,11 +180,6 @@ PIDX_return_code PIDX_idx_rst_read(PIDX_idx_rst_id rst_id)
             }
 
             req_counter++;
-            chunk_counter++;
-
-            free(send_offset);
-            free(send_count);
-
           }
         }
       }
@@ -238,11 +193,6 @@ PIDX_return_code PIDX_idx_rst_read(PIDX_idx_rst_id rst_id)
     return PIDX_err_mpi;
   }
 
-  for (i = 0; i < chunk_counter; i++)
-    MPI_Type_free(&chunk_data_type[i]);
-  free(chunk_data_type);
-  chunk_data_type = 0;
-
   free(req);
   req = 0;
   free(status);
@@ -56,15 +56,20 @@
 PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
 {
   uint64_t index, count1 = 0, req_count = 0;
-  int *send_count, *send_offset;
-  uint64_t counter = 0, req_counter = 0, chunk_counter = 0;
+  uint64_t counter = 0, req_counter = 0;
   uint64_t send_c;
   uint64_t send_o;
   int ret = 0;
 
   MPI_Request *req;
   MPI_Status *status;
-  MPI_Datatype *chunk_data_type;
+
+  // the overlapped write leaves the local pieces out of the patch buffers checked by the rst debug
+  if (rst_id->idx_metadata->rst_overlap == 1 && rst_id->idx_debug_metadata->debug_file_output_state == PIDX_NO_META_DATA_DUMP && rst_id->idx_debug_metadata->debug_rst == 0)
+    return PIDX_idx_rst_overlapped_write(rst_id);
+
+  if (rst_id->plan != NULL && rst_id->idx_debug_metadata->debug_file_output_state == PIDX_NO_META_DATA_DUMP)
+    return PIDX_idx_rst_plan_staged_write(rst_id);
 
   //creating ample requests and statuses
   for (uint64_t i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
@@ -74,7 +79,7 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
   int end_index = 0;
   for (uint32_t start_index = rst_id->first_index; start_index < (rst_id->last_index + 1); start_index = start_index + 1)
   {
-    send_c = 0, send_o = 0, counter = 0, req_counter = 0, chunk_counter = 0;
+    send_c = 0, send_o = 0, counter = 0, req_counter = 0;
     end_index = ((start_index) >= (rst_id->last_index + 1)) ? (rst_id->last_index) : (start_index);
 
     req = malloc(sizeof (*req) * req_count * 2 * (end_index - start_index + 1));
@@ -93,14 +98,6 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
     }
     memset(status, 0, sizeof (*status) * req_count * 2 * (end_index - start_index + 1));
 
-    chunk_data_type =  malloc(sizeof (*chunk_data_type) * req_count  * (end_index - start_index + 1));
-    if (!chunk_data_type)
-    {
-      fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
-      return (-1);
-    }
-    memset(chunk_data_type, 0, sizeof (*chunk_data_type) * req_count  * (end_index - start_index + 1));
-
     for (uint64_t i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
     {
       if (rst_id->idx_c->simulation_rank == rst_id->intersected_restructured_super_patch[i]->max_patch_rank)
@@ -131,7 +128,7 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
                     send_o = index * var->vps;
                     send_c = reg_patch_count[0] * var->vps;
 
-                    if (rst_id->idx_debug_metadata->debug_file_output_state != PIDX_NO_IO_AND_META_DATA_DUMP)
+                    if (rst_id->idx_debug_metadata->debug_file_output_state != PIDX_NO_IO_AND_META_DATA_DUMP && var->restructured_super_patch->is_user_buffer == 0)
                     {
                       memcpy(var->restructured_super_patch->patch[j]->buffer + (count1 * send_c * var->bpv/8), var->sim_patch[p_index]->buffer + send_o * var->bpv/8, send_c * var->bpv/8);
                     }
@@ -184,51 +181,22 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
             {
               PIDX_variable var = rst_id->idx_metadata->variable[v];
 
-              uint64_t *reg_patch_count = rst_id->intersected_restructured_super_patch[i]->patch[j]->size;
-              uint64_t *reg_patch_offset = rst_id->intersected_restructured_super_patch[i]->patch[j]->offset;
+              PIDX_patch reg_patch = rst_id->intersected_restructured_super_patch[i]->patch[j];
+              uint64_t *reg_patch_count = reg_patch->size;
 
-              send_offset = malloc(sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
-              if (!send_offset)
-              {
-                fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
-                return PIDX_err_mpi;
-              }
-              memset(send_offset, 0, sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
+              int p_index =  rst_id->intersected_restructured_super_patch[i]->source_patch[j].index;
+              int total_send_count = reg_patch_count[0] * reg_patch_count[1] * reg_patch_count[2] * var->vps * var->bpv/8;
 
-              send_count = malloc(sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
-              if (!send_count)
+              MPI_Datatype patch_type;
+              if (PIDX_idx_rst_patch_type(&rst_id->type_cache, rst_id->idx_metadata->variable[start_index]->sim_patch[p_index], reg_patch, var->vps * var->bpv/8, &patch_type) != PIDX_success)
               {
                 fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
                 return PIDX_err_mpi;
               }
-              memset(send_count, 0, sizeof (int) * (reg_patch_count[1] * reg_patch_count[2]));
-
-              count1 = 0;
-              int p_index =  rst_id->intersected_restructured_super_patch[i]->source_patch[j].index;
-              uint64_t *sim_patch_count  = rst_id->idx_metadata->variable[start_index]->sim_patch[p_index]->size;
-              uint64_t *sim_patch_offset = rst_id->idx_metadata->variable[start_index]->sim_patch[p_index]->offset;
-
-              int total_send_count = 0;
-              for (uint64_t k1 = reg_patch_offset[2]; k1 < reg_patch_offset[2] + reg_patch_count[2]; k1++)
-                for (uint64_t j1 = reg_patch_offset[1]; j1 < reg_patch_offset[1] + reg_patch_count[1]; j1++)
-                  for (uint64_t i1 = reg_patch_offset[0]; i1 < reg_patch_offset[0] + reg_patch_count[0]; i1 = i1 + reg_patch_count[0])
-                  {
-                    index = (sim_patch_count[0] * sim_patch_count[1] * (k1 - sim_patch_offset[2])) +
-                            (sim_patch_count[0] * (j1 - sim_patch_offset[1])) +
-                            (i1 - sim_patch_offset[0]);
-                    send_offset[count1] = index * var->vps * var->bpv/8;
-                    send_count[count1] = reg_patch_count[0] * var->vps * var->bpv/8;
-                    total_send_count = total_send_count + send_count[count1];
-
-                    count1++;
-                  }
-
-              MPI_Type_indexed(count1, send_count, send_offset, MPI_BYTE, &chunk_data_type[chunk_counter]);
-              MPI_Type_commit(&chunk_data_type[chunk_counter]);
 
               if (rst_id->idx_debug_metadata->debug_file_output_state != PIDX_NO_IO_AND_META_DATA_DUMP)
               {
-                ret = MPI_Isend(var->sim_patch[p_index]->buffer, 1, chunk_data_type[chunk_counter], rst_id->intersected_restructured_super_patch[i]->max_patch_rank, 123, rst_id->idx_c->simulation_comm, &req[req_counter]);
+                ret = MPI_Isend(var->sim_patch[p_index]->buffer, 1, patch_type, rst_id->intersected_restructured_super_patch[i]->max_patch_rank, 123, rst_id->idx_c->simulation_comm, &req[req_counter]);
                 if (ret != MPI_SUCCESS)
                 {
                   fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
@@ -243,10 +211,6 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
               }
 
               req_counter++;
-              chunk_counter++;
-
-              free(send_offset);
-              free(send_count);
             }
           }
         }
@@ -263,11 +227,6 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
       }
     }
 
-    for (uint64_t i = 0; i < chunk_counter; i++)
-      MPI_Type_free(&chunk_data_type[i]);
-    free(chunk_data_type);
-    chunk_data_type = 0;
-
     free(req);
     req = 0;
     free(status);
@@ -277,3 +236,177 @@ PIDX_return_code PIDX_idx_rst_staged_write(PIDX_idx_rst_id rst_id)
 
   return PIDX_success;
 }
+
+
+
+// Copies one patch of the super patch (row by row) into the restructured patch buffer
+static void place_patch(PIDX_variable var, PIDX_patch out_patch, PIDX_patch patch, unsigned char* source, uint64_t* source_offset, uint64_t* source_size)
+{
+  uint64_t nx = out_patch->size[0];
+  uint64_t ny = out_patch->size[1];
+  uint64_t bytes_per_sample = var->vps * (var->bpv/8);
+
+  for (uint64_t k1 = patch->offset[2]; k1 < patch->offset[2] + patch->size[2]; k1++)
+    for (uint64_t j1 = patch->offset[1]; j1 < patch->offset[1] + patch->size[1]; j1++)
+    {
+      uint64_t send_o = (source_size[0] * source_size[1] * (k1 - source_offset[2])) + (source_size[0] * (j1 - source_offset[1])) + (patch->offset[0] - source_offset[0]);
+      uint64_t recv_o = (nx * ny * (k1 - out_patch->offset[2])) + (nx * (j1 - out_patch->offset[1])) + (patch->offset[0] - out_patch->offset[0]);
+
+      memcpy(out_patch->buffer + recv_o * bytes_per_sample, source + send_o * bytes_per_sample, patch->size[0] * bytes_per_sample);
+    }
+
+  return;
+}
+
+
+
+// Cancels the messages still in flight after an error, they have to be completed before their buffers go away
+static void cancel_requests(MPI_Request* req, int count)
+{
+  for (int r = 0; r < count; r++)
+    if (req[r] != MPI_REQUEST_NULL)
+      MPI_Cancel(&req[r]);
+
+  MPI_Waitall(count, req, MPI_STATUSES_IGNORE);
+
+  return;
+}
+
+
+
+PIDX_return_code PIDX_idx_rst_overlapped_write(PIDX_idx_rst_id rst_id)
+{
+  PIDX_return_code ret = PIDX_success;
+  int rank = rst_id->idx_c->simulation_rank;
+  uint64_t req_count = 0;
+
+  for (uint64_t i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
+    for (uint64_t j = 0; j < rst_id->intersected_restructured_super_patch[i]->patch_count; j++)
+      req_count++;
+  req_count = req_count * (rst_id->last_index - rst_id->first_index + 1);
+
+  MPI_Request *req = malloc(sizeof (*req) * (req_count + 1));
+  int *completed = malloc(sizeof (*completed) * (req_count + 1));
+  int *req_variable = malloc(sizeof (*req_variable) * (req_count + 1));
+  int *req_patch = malloc(sizeof (*req_patch) * (req_count + 1));
+  memset(req_patch, 0, sizeof (*req_patch) * (req_count + 1));
+
+  int req_counter = 0;
+
+  // Post the receives and sends of every variable at once, receives are tagged with their patch
+  // so that they can be placed as soon as they land (-1 for sends)
+  for (int v = rst_id->first_index; v <= rst_id->last_index; v++)
+  {
+    PIDX_variable var = rst_id->idx_metadata->variable[v];
+
+    for (uint64_t i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
+    {
+      PIDX_super_patch irsp = rst_id->intersected_restructured_super_patch[i];
+      for (uint64_t j = 0; j < irsp->patch_count; j++)
+      {
+        uint64_t *reg_patch_count  = irsp->patch[j]->size;
+
+        if (rank == irsp->max_patch_rank && rank != irsp->source_patch[j].rank)
+        {
+          int length = (reg_patch_count[0] * reg_patch_count[1] * reg_patch_count[2]) * var->vps * var->bpv/8;
+          if (MPI_Irecv(var->restructured_super_patch->patch[j]->buffer, length, MPI_BYTE, irsp->source_patch[j].rank, 123, rst_id->idx_c->simulation_comm, &req[req_counter]) != MPI_SUCCESS)
+          {
+            fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+            ret = PIDX_err_mpi;
+            goto cleanup;
+          }
+          req_variable[req_counter] = v;
+          req_patch[req_counter] = j;
+          req_counter++;
+        }
+        else if (rank != irsp->max_patch_rank && rank == irsp->source_patch[j].rank)
+        {
+          int p_index = irsp->source_patch[j].index;
+
+          MPI_Datatype patch_type;
+          if (PIDX_idx_rst_patch_type(&rst_id->type_cache, rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index], irsp->patch[j], var->vps * var->bpv/8, &patch_type) != PIDX_success)
+          {
+            fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+            ret = PIDX_err_mpi;
+            goto cleanup;
+          }
+
+          if (MPI_Isend(var->sim_patch[p_index]->buffer, 1, patch_type, irsp->max_patch_rank, 123, rst_id->idx_c->simulation_comm, &req[req_counter]) != MPI_SUCCESS)
+          {
+            fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+            ret = PIDX_err_mpi;
+            goto cleanup;
+          }
+          req_variable[req_counter] = v;
+          req_patch[req_counter] = -1;
+          req_counter++;
+        }
+      }
+    }
+  }
+
+  // My own pieces go straight into the restructured patch while the messages are in flight
+  for (int v = rst_id->first_index; v <= rst_id->last_index; v++)
+  {
+    PIDX_variable var = rst_id->idx_metadata->variable[v];
+    for (uint64_t i = 0; i < rst_id->intersected_restructured_super_patch_count; i++)
+    {
+      PIDX_super_patch irsp = rst_id->intersected_restructured_super_patch[i];
+      if (rank != irsp->max_patch_rank)
+        continue;
+
+      for (uint64_t j = 0; j < irsp->patch_count; j++)
+      {
+        if (rank != irsp->source_patch[j].rank || var->restructured_super_patch->is_user_buffer == 1)
+          continue;
+
+        int p_index = irsp->source_patch[j].index;
+        place_patch(var, var->restructured_super_patch->restructured_patch, irsp->patch[j], var->sim_patch[p_index]->buffer, rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index]->offset, rst_id->idx_metadata->variable[rst_id->first_index]->sim_patch[p_index]->size);
+      }
+    }
+  }
+
+  // Place every received patch as soon as it lands
+  int remaining = req_counter;
+  while (remaining > 0)
+  {
+    int done_count = 0;
+    if (MPI_Waitsome(req_counter, req, &done_count, completed, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
+    {
+      fprintf(stderr, "Error: File [%s] Line [%d]\n", __FILE__, __LINE__);
+      ret = PIDX_err_mpi;
+      goto cleanup;
+    }
+
+    if (done_count == MPI_UNDEFINED)
+      break;
+
+    for (int n = 0; n < done_count; n++)
+    {
+      int r = completed[n];
+      if (req_patch[r] == -1)
+        continue;
+
+      PIDX_variable var = rst_id->idx_metadata->variable[req_variable[r]];
+      PIDX_patch patch = var->restructured_super_patch->patch[req_patch[r]];
+      place_patch(var, var->restructured_super_patch->restructured_patch, patch, patch->buffer, patch->offset, patch->size);
+    }
+    remaining = remaining - done_count;
+  }
+
+cleanup:
+  // the datatypes of the sends go with the requests that used them
+  if (ret != PIDX_success)
+  {
+    cancel_requests(req, req_counter);
+    PIDX_idx_rst_free_patch_types(&rst_id->type_cache);
+  }
+
+  free(req_patch);
+  free(req_variable);
+  free(completed);
+  free(req);
+
+  return ret;
+}
+
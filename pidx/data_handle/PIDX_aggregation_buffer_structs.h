@@ -53,6 +53,9 @@ struct PIDX_HZ_Agg_buffer_struct
 
   uint64_t buffer_size;                                 ///< Aggregator buffer size
   unsigned char* buffer;                                ///< The actual aggregator buffer
+
+  uint64_t* block_size;                                 ///< Compressed size of every block of the file, only with block compression
+  uint64_t data_offset;                                 ///< Offset of the compressed blocks past the file header, only with block compression
 };
 typedef struct PIDX_HZ_Agg_buffer_struct* Agg_buffer;
 
@@ -72,130 +72,182 @@ Level #Elements [#Block_id] (HZ_start HZ_end) (HZ_start_form HZ_end_form)
 //const int PIDX_default_bits_per_block       = 15;
 //const int PIDX_default_blocks_per_file      = 256;
 
-int PIDX_blocks_initialize_layout (PIDX_block_layout layout, int resolution_from, int resolution_to, int maxh, int bits_per_block)
+static int popcount64(uint64_t word)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(word);
+#else
+  int count = 0;
+  for (; word != 0; word = word & (word - 1))
+    count++;
+  return count;
+#endif
+}
+
+
+static int trailing_zeros64(uint64_t word)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#else
+  int count = 0;
+  for (; (word & 1) == 0; word = word >> 1)
+    count++;
+  return count;
+#endif
+}
+
+
+static void set_block(PIDX_block_layout layout, uint64_t block_number)
+{
+  layout->hz_block_bitmap[block_number >> 6] |= (1ULL << (block_number & 63));
+}
+
+
+static int test_block(PIDX_block_layout layout, uint64_t block_number)
+{
+  if (block_number >= layout->block_count)
+    return 0;
+
+  return (layout->hz_block_bitmap[block_number >> 6] >> (block_number & 63)) & 1;
+}
+
+
+// Number of blocks of the layout in [0, block_number)
+static uint64_t rank_block(PIDX_block_layout layout, uint64_t block_number)
 {
-  int ctr = 1, j;
+  if (block_number > layout->block_count)
+    block_number = layout->block_count;
+
+  uint64_t word = block_number >> 6;
+  uint64_t count = 0;
+
+  if (layout->hz_block_rank != NULL)
+    count = layout->hz_block_rank[word];
+  else
+  {
+    for (uint64_t w = 0; w < word; w++)
+      count = count + popcount64(layout->hz_block_bitmap[w]);
+  }
+
+  if ((block_number & 63) != 0)
+    count = count + popcount64(layout->hz_block_bitmap[word] & ((1ULL << (block_number & 63)) - 1));
+
+  return count;
+}
 
+
+int PIDX_blocks_initialize_layout (PIDX_block_layout layout, int resolution_from, int resolution_to, int maxh, int bits_per_block)
+{
   layout->resolution_from = resolution_from;
   layout->resolution_to = resolution_to;
 
   if (maxh == 0)
     return PIDX_success;
 
-  layout->hz_block_number_array = malloc(sizeof(int*) * maxh);
-  memset(layout->hz_block_number_array, 0, sizeof(int*) * maxh);
+  // the finest level (maxh - 1) ends at block pow(2, maxh - 1 - bits_per_block)
+  layout->block_count = PIDX_blocks_level_first_block(maxh, bits_per_block);
+  layout->word_count = (layout->block_count + 63) / 64;
 
-  for (j = 0 ; j < PIDX_MIN(maxh, bits_per_block + 1) ; j++)
-  {
-    layout->hz_block_number_array[j] = malloc(sizeof(int));
-    memset(layout->hz_block_number_array[j], 0, sizeof(int));
-  }
+  layout->hz_block_bitmap = malloc(sizeof(*layout->hz_block_bitmap) * layout->word_count);
+  if (layout->hz_block_bitmap == NULL)
+    return PIDX_err_file;
+  memset(layout->hz_block_bitmap, 0, sizeof(*layout->hz_block_bitmap) * layout->word_count);
 
-  ctr = 1;
-  for (j = bits_per_block + 1 ; j < maxh ; j++)
-  {
-    layout->hz_block_number_array[j] = malloc(sizeof(int) * ctr);
-    memset(layout->hz_block_number_array[j], 0, sizeof(int) * ctr);
-    ctr = ctr * 2;
-  }
+  layout->hz_block_rank = NULL;
 
   return PIDX_success;
 }
 
 
-///
-int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_block, const char* bitPattern, PIDX_block_layout layout, int res_to)
+// Sets the blocks of HZ level m whose first and last samples span a box intersecting bounding_box.
+// Bit i of the z address of a sample belongs to axis bitPattern[maxh - 1 - i]; for a level m sample the
+// z address is (r << 1 | 1) << (maxh - 1 - m), r being the sample index within the level. The low
+// bits_per_block bits of r walk a block, the remaining bits (t) number the block within the level,
+// so the blocks of a level form a lattice and the intersecting ones are a box of it.
+static void create_level_layout(int bounding_box[2][5], int maxH, int bits_per_block, const char* bitPattern, int m, PIDX_block_layout layout)
 {
-  int m = 0, n_blocks = 1, t = 0, block_number = 1;
-  uint64_t hz_from = 0, hz_to = 0;
-  uint64_t *ZYX_from, *ZYX_to;
+  int zbits = maxH - 1;
+  int t_bits = m - 1 - bits_per_block;
 
-  int adjusted_res_to = layout->resolution_to;
-  if (layout->resolution_to > maxH - res_to)
-    adjusted_res_to = maxH - res_to;//layout->resolution_to - res_to;
+  int64_t one[PIDX_MAX_DIMENSIONS] = {0, 0, 0};       // coordinates of the leading 1
+  int64_t free_mask[PIDX_MAX_DIMENSIONS] = {0, 0, 0}; // coordinates spanned inside a block
+  int base[PIDX_MAX_DIMENSIONS] = {0, 0, 0};          // shift of the lowest t bit of every axis
+  int count[PIDX_MAX_DIMENSIONS] = {0, 0, 0};
+  int t_axis[64];
+  int t_shift[64];
 
-  ZYX_to = (uint64_t*) malloc(sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
-  ZYX_from = (uint64_t*) malloc(sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
-
-  //fprintf(stderr, "res from to to : %d %d bpb %d\n", layout->resolution_from, layout->resolution_to, bits_per_block);
-  if (layout->resolution_from <= bits_per_block)
+  for (int i = 0, j = 0; i < zbits; i++)
   {
-    for (m = layout->resolution_from ; m <= bits_per_block; m++)
+    int axis = bitPattern[zbits - i];
+    if (i == zbits - m)
+      one[axis] = 1LL << count[axis];
+    else if (i > zbits - m && i <= zbits - m + bits_per_block)
+      free_mask[axis] |= 1LL << count[axis];
+    else if (i > zbits - m + bits_per_block)
     {
-      if (m == 0)
-      {
-        hz_from = 0;
-        hz_to = 0;
-      }
-      else
-      {
-        hz_from = (uint64_t)pow(2, m-1);
-        hz_to = (uint64_t)pow(2, m) - 1;
-      }
+      t_axis[j] = axis;
+      t_shift[j] = count[axis];
+      j++;
+    }
+    count[axis]++;
+    if (i <= zbits - m + bits_per_block)
+      base[axis] = count[axis];
+  }
 
-      memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
-      memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+  // range of block lattice coordinates along every axis
+  int64_t lo[PIDX_MAX_DIMENSIONS], hi[PIDX_MAX_DIMENSIONS];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    int64_t extent = (int64_t)(count[d] - base[d]);
+    int64_t cells = 1LL << extent;
 
-      Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
-      Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
+    if ((int64_t)bounding_box[1][d] - 1 < one[d])
+      return;
 
-      if (ZYX_to[0] >= bounding_box[0][0] && ZYX_from[0] < bounding_box[1][0] && ZYX_to[1] >= bounding_box[0][1] && ZYX_from[1] < bounding_box[1][1] && ZYX_to[2] >= bounding_box[0][2] && ZYX_from[2] < bounding_box[1][2])
-        layout->hz_block_number_array[m][0] = 0;
-    }
+    hi[d] = ((int64_t)bounding_box[1][d] - 1 - one[d]) >> base[d];
+    if (hi[d] > cells - 1)
+      hi[d] = cells - 1;
 
-    for (m = bits_per_block + 1 ; m < adjusted_res_to; m++)
-    {
-      n_blocks = pow(2, (m - (bits_per_block + 1)));
-      for (t = 0 ; t < n_blocks ; t++)
-      {
-        hz_from = (uint64_t)(block_number) * pow(2, bits_per_block);
-        hz_to = (uint64_t)((block_number + 1) * pow(2, bits_per_block)) - 1;
-
-        memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
-        memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
-
-        Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
-        Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
-      
-        if (ZYX_to[0] >= bounding_box[0][0] && ZYX_from[0] < bounding_box[1][0] && ZYX_to[1] >= bounding_box[0][1] && ZYX_from[1] < bounding_box[1][1] && ZYX_to[2] >= bounding_box[0][2] && ZYX_from[2] < bounding_box[1][2])
-          layout->hz_block_number_array[m][t] = block_number;
-      
-        block_number++;
-      }
-    }
+    int64_t low = (int64_t)bounding_box[0][d] - one[d] - free_mask[d];
+    lo[d] = (low <= 0) ? 0 : ((low + (1LL << base[d]) - 1) >> base[d]);
+
+    if (lo[d] > hi[d])
+      return;
   }
-  else
-  {
-    for (m = bits_per_block + 1 ; m < adjusted_res_to; m++)
-    {
-      n_blocks = pow(2, (m - (bits_per_block + 1)));
-      if (m >= layout->resolution_from)
+
+  uint64_t first_block = PIDX_blocks_level_first_block(m, bits_per_block);
+  int64_t c[PIDX_MAX_DIMENSIONS];
+  for (c[2] = lo[2]; c[2] <= hi[2]; c[2]++)
+    for (c[1] = lo[1]; c[1] <= hi[1]; c[1]++)
+      for (c[0] = lo[0]; c[0] <= hi[0]; c[0]++)
       {
-        for (t = 0 ; t < n_blocks ; t++)
-        {
-          hz_from = (uint64_t)(block_number) * pow(2, bits_per_block);
-          hz_to = (uint64_t)((block_number + 1) * pow(2, bits_per_block)) - 1;
+        uint64_t t = 0;
+        for (int j = 0; j < t_bits; j++)
+          t |= (uint64_t)((c[t_axis[j]] >> (t_shift[j] - base[t_axis[j]])) & 1) << j;
 
-          memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
-          memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+        set_block(layout, first_block + t);
+      }
 
-          Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
-          Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
+  return;
+}
 
-          if (ZYX_to[0] >= bounding_box[0][0] && ZYX_from[0] < bounding_box[1][0] && ZYX_to[1] >= bounding_box[0][1] && ZYX_from[1] < bounding_box[1][1] && ZYX_to[2] >= bounding_box[0][2] && ZYX_from[2] < bounding_box[1][2])
-            layout->hz_block_number_array[m][t] = block_number;
 
-          block_number++;
-        }
-      }
-      else
-        block_number = block_number + n_blocks;
-    }
-  }
-  free(ZYX_from);
-  ZYX_from = 0;
-  free(ZYX_to);
-  ZYX_to = 0;
+///
+int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_block, const char* bitPattern, PIDX_block_layout layout, int res_to)
+{
+  int adjusted_res_to = layout->resolution_to;
+  if (layout->resolution_to > maxH - res_to)
+    adjusted_res_to = maxH - res_to;//layout->resolution_to - res_to;
+
+  // levels up to bits_per_block all live in block 0, which is implied by resolution_from
+  int m = (layout->resolution_from > bits_per_block) ? layout->resolution_from : bits_per_block + 1;
+  for (; m < adjusted_res_to; m++)
+    create_level_layout(bounding_box, maxH, bits_per_block, bitPattern, m, layout);
+
+  // the layout changed, the rank table is stale
+  free(layout->hz_block_rank);
+  layout->hz_block_rank = NULL;
 
   return 0;
 }
@@ -203,78 +255,26 @@ int PIDX_blocks_create_layout (int bounding_box[2][5], int maxH, int bits_per_bl
 
 void PIDX_blocks_print_layout(PIDX_block_layout layout, int bits_per_block)
 {
-  int ctr = 1, i, j;
-  int res_level = 0;
-  int res_index = 0;
-
   if (layout->resolution_from <= bits_per_block)
-  {
-    for (i = layout->resolution_from; i <= bits_per_block; i++)
-    {
-      fprintf(stderr, "A Number of blocks at level %d = %d :: ", i, ctr);
-      for (j = 0 ; j <  ctr; j++)
-      {
-        if (layout->hz_block_number_array[i][j] == 0)
-          res_level = 0;
-        else
-        {
-          res_level = log2 (layout->hz_block_number_array[i][j]) + 1 + bits_per_block;
-          res_index = layout->hz_block_number_array[i][j] % ((int) pow(2, (res_level - 1 - bits_per_block)));
-        }
-        fprintf(stderr, "[%d (%d %d)] ", layout->hz_block_number_array[i][j], res_level, res_index);
-      }
-      fprintf(stderr, "\n");
-    }
-
-    for (i = bits_per_block + 1; i < layout->resolution_to; i++)
-    {
-      fprintf(stderr, "B Number of blocks at level %d = %d :: ", i, ctr);
-      for (j = 0 ; j <  ctr; j++)
-      {
-        if (layout->hz_block_number_array[i][j] == 0)
-          res_level = 0;
-        else
-        {
-          res_level = log2 (layout->hz_block_number_array[i][j]) + 1 + bits_per_block;
-          res_index = layout->hz_block_number_array[i][j] % ((int) pow(2, (res_level - 1 - bits_per_block)));
-        }
-        fprintf(stderr, "[%d (%d %d)] ", layout->hz_block_number_array[i][j], res_level, res_index);
-      }
+    fprintf(stderr, "Levels %d to %d :: [0]\n", layout->resolution_from, bits_per_block);
 
-      ctr = ctr * 2;
-      fprintf(stderr, "\n");
-    }
-  }
-  else
+  int level_from = (layout->resolution_from > bits_per_block) ? layout->resolution_from : bits_per_block + 1;
+  for (int i = level_from; i < layout->resolution_to; i++)
   {
-    for (i = bits_per_block + 1; i < layout->resolution_to; i++)
-    {
-      if (i >= layout->resolution_from)
-      {
-        fprintf(stderr, "C Number of blocks at level %d = %d :: ", i, ctr);
-        for (j = 0 ; j <  ctr; j++)
-        {
-          if (layout->hz_block_number_array[i][j] == 0)
-            res_level = 0;
-          else
-          {
-            res_level = log2 (layout->hz_block_number_array[i][j]) + 1 + bits_per_block;
-            res_index = layout->hz_block_number_array[i][j] % ((int) pow(2, (res_level - 1 - bits_per_block)));
-          }
-          fprintf(stderr, "[%d (%d %d)] ", layout->hz_block_number_array[i][j], res_level, res_index);
-        }
-      }
-      ctr = ctr * 2;
-      if (i >= layout->resolution_from)
-        fprintf(stderr, "\n");
-    }
+    uint64_t from = PIDX_blocks_level_first_block(i, bits_per_block);
+    uint64_t to = PIDX_blocks_level_first_block(i + 1, bits_per_block);
+
+    fprintf(stderr, "Number of blocks at level %d = %d :: ", i, (int)(to - from));
+    for (uint64_t b = PIDX_blocks_next_block(layout, from); b < to; b = PIDX_blocks_next_block(layout, b + 1))
+      fprintf(stderr, "[%d (%d %d)] ", (int)b, i, (int)(b - from));
+    fprintf(stderr, "\n");
   }
 }
 
 
 int PIDX_blocks_is_block_present(int block_number, int bits_per_block, PIDX_block_layout layout)
 {
-  int res_level = 0, res_index = 0;
+  int res_level = 0;
 
   if (block_number == 0)
   {
@@ -282,54 +282,148 @@ int PIDX_blocks_is_block_present(int block_number, int bits_per_block, PIDX_bloc
       return 1;
 
     return 0;
-    //res_level = bits_per_block;
-  }
-  else
-  {
-    res_level = log2 (block_number) + 1 + bits_per_block;
-    res_index = block_number % ((int) pow(2, (res_level - 1 - bits_per_block)));
   }
 
+  res_level = log2 (block_number) + 1 + bits_per_block;
   if (res_level < layout->resolution_from || res_level >= layout->resolution_to)
     return 0;
 
-  if (layout->hz_block_number_array[res_level][res_index] == block_number)
-    return 1;
-
-  return 0;
+  return test_block(layout, block_number);
 }
 
 
 int PIDX_blocks_find_negative_offset(int blocks_per_file, int bits_per_block, int block_number, PIDX_block_layout layout)
 {
-  //PIDX_blocks_print_layout(layout);
-  int b;
-  int file_no = block_number/blocks_per_file;
-  int block_offset = 0;
-  for (b = file_no * blocks_per_file ; b < block_number; b++)
-    if (!PIDX_blocks_is_block_present(b, bits_per_block, layout))
-      block_offset++;
-  return block_offset;
+  uint64_t file_first_block = (uint64_t)(block_number / blocks_per_file) * blocks_per_file;
+
+  // only the blocks at levels [resolution_from, resolution_to) are present
+  uint64_t from = PIDX_blocks_level_first_block(layout->resolution_from, bits_per_block);
+  if (from < file_first_block)
+    from = file_first_block;
+  uint64_t to = PIDX_MIN((uint64_t)block_number, PIDX_blocks_level_first_block(layout->resolution_to, bits_per_block));
+
+  uint64_t present = 0;
+  if (from < to)
+    present = rank_block(layout, to) - rank_block(layout, from);
+
+  if (file_first_block == 0 && block_number > 0 && layout->resolution_from <= bits_per_block)
+    present++;
+
+  return (int)((uint64_t)block_number - file_first_block - present);
 }
 
 
-void PIDX_blocks_free_layout(int bits_per_block, int maxh, PIDX_block_layout layout)
+uint64_t PIDX_blocks_level_first_block(int level, int bits_per_block)
+{
+  if (level <= bits_per_block + 1)
+    return 1;
+
+  return 1ULL << (level - bits_per_block - 1);
+}
+
+
+uint64_t PIDX_blocks_next_block(PIDX_block_layout layout, uint64_t block_number)
 {
-  int j = 0;
-  for (j = 0 ; j < bits_per_block + 1 ; j++)
+  if (block_number >= layout->block_count)
+    return layout->block_count;
+
+  uint64_t word = block_number >> 6;
+  uint64_t bits = layout->hz_block_bitmap[word] & (~0ULL << (block_number & 63));
+
+  while (bits == 0)
   {
-    free(layout->hz_block_number_array[j]);
-    layout->hz_block_number_array[j] = 0;
+    word++;
+    if (word >= layout->word_count)
+      return layout->block_count;
+    bits = layout->hz_block_bitmap[word];
   }
 
-  for (j = bits_per_block + 1 ; j < maxh ; j++)
+  return PIDX_MIN((word << 6) + trailing_zeros64(bits), layout->block_count);
+}
+
+
+// Mask of the bits of word w that fall in the block range [from, to)
+static uint64_t range_mask(uint64_t w, uint64_t from, uint64_t to)
+{
+  uint64_t mask = ~0ULL;
+  if (w == (from >> 6))
+    mask = mask & (~0ULL << (from & 63));
+  if (w == (to >> 6))
+    mask = mask & ((1ULL << (to & 63)) - 1);
+  return mask;
+}
+
+
+void PIDX_blocks_merge_levels(PIDX_block_layout dst, PIDX_block_layout src, int level_from, int level_to, int bits_per_block)
+{
+  uint64_t from = PIDX_blocks_level_first_block(level_from, bits_per_block);
+  uint64_t to = PIDX_MIN(PIDX_blocks_level_first_block(level_to, bits_per_block), PIDX_MIN(dst->block_count, src->block_count));
+  if (from >= to)
+    return;
+
+  for (uint64_t w = from >> 6; w <= ((to - 1) >> 6); w++)
+    dst->hz_block_bitmap[w] |= src->hz_block_bitmap[w] & range_mask(w, from, to);
+
+  free(dst->hz_block_rank);
+  dst->hz_block_rank = NULL;
+}
+
+
+int PIDX_blocks_reduce_levels(PIDX_block_layout dst, PIDX_block_layout src, int level_from, int level_to, int bits_per_block, MPI_Comm comm)
+{
+  uint64_t from = PIDX_blocks_level_first_block(level_from, bits_per_block);
+  uint64_t to = PIDX_MIN(PIDX_blocks_level_first_block(level_to, bits_per_block), PIDX_MIN(dst->block_count, src->block_count));
+  if (from >= to)
+    return PIDX_success;
+
+  uint64_t first_word = from >> 6;
+  int count = (int)(((to - 1) >> 6) - first_word + 1);
+
+  uint64_t* reduced = malloc(sizeof(*reduced) * count);
+  if (reduced == NULL)
+    return PIDX_err_file;
+
+  if (MPI_Allreduce(src->hz_block_bitmap + first_word, reduced, count, MPI_UNSIGNED_LONG_LONG, MPI_BOR, comm) != MPI_SUCCESS)
   {
-    free(layout->hz_block_number_array[j]);
-    layout->hz_block_number_array[j] = 0;
+    free(reduced);
+    return PIDX_err_mpi;
   }
 
-  free(layout->hz_block_number_array);
-  layout->hz_block_number_array = 0;
+  for (int i = 0; i < count; i++)
+    dst->hz_block_bitmap[first_word + i] |= reduced[i] & range_mask(first_word + i, from, to);
+
+  free(reduced);
+
+  free(dst->hz_block_rank);
+  dst->hz_block_rank = NULL;
+
+  return PIDX_success;
+}
+
+
+void PIDX_blocks_build_rank(PIDX_block_layout layout)
+{
+  free(layout->hz_block_rank);
+  layout->hz_block_rank = malloc(sizeof(*layout->hz_block_rank) * (layout->word_count + 1));
+  if (layout->hz_block_rank == NULL)
+    return;
+
+  layout->hz_block_rank[0] = 0;
+  for (uint64_t w = 0; w < layout->word_count; w++)
+    layout->hz_block_rank[w + 1] = layout->hz_block_rank[w] + popcount64(layout->hz_block_bitmap[w]);
+}
+
+
+void PIDX_blocks_free_layout(int bits_per_block, int maxh, PIDX_block_layout layout)
+{
+  free(layout->hz_block_bitmap);
+  layout->hz_block_bitmap = 0;
+
+  free(layout->hz_block_rank);
+  layout->hz_block_rank = 0;
+
+  layout->block_count = 0;
+  layout->word_count = 0;
 
   return;
 }
@@ -57,8 +57,12 @@ struct PIDX_block_layout_struct
   int *inverse_existing_file_index;
   int *file_index;
 
-  /// Indices of filled blocks
-  int **hz_block_number_array;
+  /// Filled blocks, bit b is set when block b (b > 0) is in the layout.
+  /// Block 0 holds all the levels up to bits_per_block and is implied by resolution_from.
+  uint64_t block_count;
+  uint64_t word_count;
+  uint64_t *hz_block_bitmap;
+  uint32_t *hz_block_rank;  /// set bits before every word of hz_block_bitmap, NULL until PIDX_blocks_build_rank
 };
 typedef struct PIDX_block_layout_struct* PIDX_block_layout;
 
@@ -95,7 +99,7 @@ int PIDX_blocks_is_block_present(int block_number, int bits_per_block, PIDX_bloc
 
 
 ///
-/// \brief PIDX_blocks_find_negative_offset
+/// \brief PIDX_blocks_find_negative_offset Number of missing blocks before block_number in its file
 /// \param blocks_per_file
 /// \param bits_per_block
 /// \param block_number
@@ -105,6 +109,58 @@ int PIDX_blocks_is_block_present(int block_number, int bits_per_block, PIDX_bloc
 int PIDX_blocks_find_negative_offset(int blocks_per_file, int bits_per_block, int block_number, PIDX_block_layout layout);
 
 
+///
+/// \brief PIDX_blocks_level_first_block First block number of HZ level, every level up to
+/// bits_per_block + 1 starts at block 1 (the levels below live in block 0)
+/// \param level
+/// \param bits_per_block
+/// \return
+///
+uint64_t PIDX_blocks_level_first_block(int level, int bits_per_block);
+
+
+///
+/// \brief PIDX_blocks_next_block Smallest block >= block_number set in the layout, block_count if none
+/// \param layout
+/// \param block_number
+/// \return
+///
+uint64_t PIDX_blocks_next_block(PIDX_block_layout layout, uint64_t block_number);
+
+
+///
+/// \brief PIDX_blocks_merge_levels Adds the blocks of src at levels [level_from, level_to) to dst
+/// \param dst
+/// \param src
+/// \param level_from
+/// \param level_to
+/// \param bits_per_block
+///
+void PIDX_blocks_merge_levels(PIDX_block_layout dst, PIDX_block_layout src, int level_from, int level_to, int bits_per_block);
+
+
+///
+/// \brief PIDX_blocks_reduce_levels Adds the union over comm of the blocks of src at levels
+/// [level_from, level_to) to dst
+/// \param dst
+/// \param src
+/// \param level_from
+/// \param level_to
+/// \param bits_per_block
+/// \param comm
+/// \return
+///
+int PIDX_blocks_reduce_levels(PIDX_block_layout dst, PIDX_block_layout src, int level_from, int level_to, int bits_per_block, MPI_Comm comm);
+
+
+///
+/// \brief PIDX_blocks_build_rank Builds the rank table used by PIDX_blocks_find_negative_offset,
+/// to be called once the layout is complete
+/// \param layout
+///
+void PIDX_blocks_build_rank(PIDX_block_layout layout);
+
+
 
 ///
 /// \brief PIDX_blocks_free_layout
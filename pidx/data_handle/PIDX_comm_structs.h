@@ -61,6 +61,21 @@ struct idx_comm_struct
   MPI_Comm partition_comm;      /// Communicator associated with every partition
   int partition_rank;           /// rank of a process within partition_comm
   int partition_nprocs;         /// number of processes in partition_comm
+
+
+  // communicators kept across flushes, split again only when their grouping changes
+  int is_rst_comm_cached;       /// 1 if cached_rst_comm holds a communicator
+  MPI_Comm cached_rst_comm;     /// rst_comm of the previous flush
+  MPI_Comm cached_rst_parent;   /// communicator cached_rst_comm was split from
+  int cached_rst_color;         /// color of this process when cached_rst_comm was split
+
+  int is_partition_comm_cached; /// 1 if cached_partition_comm holds a communicator
+  MPI_Comm cached_partition_comm; /// partition_comm of the previous flush, split from cached_rst_comm
+  int cached_partition_color;   /// color of this process when cached_partition_comm was split
+
+  int is_nbx_comm_cached;       /// 1 if nbx_comm holds a communicator
+  MPI_Comm nbx_comm;            /// duplicate of simulation_comm for the sparse exchange of patch extents
+  int nbx_round;                /// exchanges done on nbx_comm, picks the tag of the next one
 };
 typedef struct idx_comm_struct* idx_comm;
 
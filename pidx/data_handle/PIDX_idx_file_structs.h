@@ -47,6 +47,7 @@ struct idx_file_struct
 {
   int pidx_version;
   char metadata_version[8];
+  int chunk_component_planes;                       /// chunked buffers keep every component apart (files before metadata version 6.2)
 
 
   enum PIDX_io_type io_type;                        /// I/O format and layout we want to use
@@ -57,8 +58,9 @@ struct idx_file_struct
 
 
   int variable_pipe_length;                         /// pipes (combines) "variable_pipe_length" variables for io
-  int variable_tracker[PIDX_MAX_VARIABLE_COUNT];                        /// Which one of the 256 variables are present
-  PIDX_variable variable[PIDX_MAX_VARIABLE_COUNT];                      /// pointer to variable
+  int variable_capacity;                                                /// Number of slots in variable and variable_tracker
+  int *variable_tracker;                                                /// Which one of the variables are present
+  PIDX_variable *variable;                                              /// pointer to variable, grown with PIDX_variable_table_reserve
   uint32_t variable_count;                          /// The number of variables contained in the dataset
   uint32_t particles_position_variable_index;       /// The index of the variable containing the particles position
 
@@ -93,7 +95,12 @@ struct idx_file_struct
   int compression_type;
   int compression_factor;
   float compression_bit_rate;
+  int compression_mode;                             /// PIDX_ZFP_FIXED_RATE, PIDX_ZFP_FIXED_ACCURACY or PIDX_ZFP_FIXED_PRECISION
+  double compression_tolerance;                     /// absolute error bound with PIDX_ZFP_FIXED_ACCURACY
+  int compression_precision;                        /// uncompressed bit planes kept with PIDX_ZFP_FIXED_PRECISION
+  int compression_thread_count;                     /// threads running the ZFP encoder and decoder (0 and 1 use the calling thread)
   uint64_t chunk_size[PIDX_MAX_DIMENSIONS];
+  uint64_t *compressed_file_size;                   /// bytes of compressed blocks written so far to every file (PIDX_CHUNKING_ZFP_BLOCK)
 
   int particle_res_base;
   int particle_res_factor;
@@ -111,6 +118,11 @@ struct idx_file_struct
 
 
   int cached_ts;                                    /// used for raw io, to cache meta data (1) or not (0)
+  int restart_read;                                 /// 1 reads idx data with the N-to-M restart path (no restructuring)
+  int read_thread_count;                            /// threads of the serial reader (0 uses one per core)
+  int read_precision;                               /// most significant bytes of every value read from PIDX_PRECISION_BLOCK blocks (0 reads them all)
+  int sparse_rst_meta_data;                         /// 1 routes patch extents to the restructured box owners instead of an Allgather
+  int rst_overlap;                                  /// 1 places restructured patches as they arrive (MPI_Waitsome)
 };
 typedef struct idx_file_struct* idx_dataset;
 
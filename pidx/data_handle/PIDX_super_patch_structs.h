@@ -64,6 +64,7 @@ struct PIDX_super_patch_struct
   PIDX_source_patch_index *source_patch;                ///< Rank and index of all the patches
   int max_patch_rank;                                   ///< Rank of the process that holds this super patch
   PIDX_patch restructured_patch;                        ///< Pointer to the restructured (super) patch
+  uint8_t is_user_buffer;                               ///< 1 if restructured_patch->buffer aliases the simulation buffer
 };
 typedef struct PIDX_super_patch_struct* PIDX_super_patch;
 
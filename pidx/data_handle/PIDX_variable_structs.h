@@ -53,9 +53,19 @@ struct PIDX_variable_struct
   PIDX_data_layout data_layout;                              ///< Row major or column major
 
 
+  // compression settings of the variable (block compression types only), see PIDX_set_variable_compression_type
+  int compression_override;                                  ///< 1 when the variable has its own settings, 0 when it uses the ones of the file
+  int compression_type;                                      ///< PIDX_NO_COMPRESSION or a block compression type
+  int compression_mode;                                      ///< ZFP mode (PIDX_ZFP_FIXED_RATE, PIDX_ZFP_FIXED_ACCURACY or PIDX_ZFP_FIXED_PRECISION)
+  float compression_bit_rate;                                ///< bits per value in fixed rate mode
+  double compression_tolerance;                              ///< absolute error bound in fixed accuracy mode
+  int compression_precision;                                 ///< bit planes kept in fixed precision mode
+
+
   // buffer (before, after HZ encoding phase)
   int sim_patch_count;                                       ///< Number of patches/blocks that the simulation feeds to PIDX (application layout)
-  PIDX_patch sim_patch[PIDX_FILE_PATH_LENGTH];                                ///< Pointer to the patches
+  int sim_patch_capacity;                                    ///< Number of slots in sim_patch
+  PIDX_patch *sim_patch;                                     ///< Pointer to the patches, grown with PIDX_variable_reserve_patches
 
 
   // buffer after restructuring
@@ -0,0 +1,129 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#include "../PIDX_inc.h"
+
+
+static int grown_capacity(int capacity, int count)
+{
+  int new_capacity = (capacity > 0) ? capacity : 8;
+  while (new_capacity < count)
+    new_capacity = new_capacity * 2;
+
+  return new_capacity;
+}
+
+
+
+PIDX_return_code PIDX_variable_table_reserve(idx_dataset idx, int count)
+{
+  if (count <= idx->variable_capacity)
+    return PIDX_success;
+
+  int capacity = grown_capacity(idx->variable_capacity, count);
+
+  PIDX_variable *variable = realloc(idx->variable, capacity * sizeof (*variable));
+  if (variable == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_variable;
+  }
+  memset(variable + idx->variable_capacity, 0, (capacity - idx->variable_capacity) * sizeof (*variable));
+  idx->variable = variable;
+
+  int *variable_tracker = realloc(idx->variable_tracker, capacity * sizeof (*variable_tracker));
+  if (variable_tracker == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_variable;
+  }
+  memset(variable_tracker + idx->variable_capacity, 0, (capacity - idx->variable_capacity) * sizeof (*variable_tracker));
+  idx->variable_tracker = variable_tracker;
+
+  idx->variable_capacity = capacity;
+
+  return PIDX_success;
+}
+
+
+
+void PIDX_variable_table_free(idx_dataset idx)
+{
+  free(idx->variable);
+  idx->variable = NULL;
+
+  free(idx->variable_tracker);
+  idx->variable_tracker = NULL;
+
+  idx->variable_capacity = 0;
+}
+
+
+
+PIDX_return_code PIDX_variable_reserve_patches(PIDX_variable variable, int count)
+{
+  if (count <= variable->sim_patch_capacity)
+    return PIDX_success;
+
+  int capacity = grown_capacity(variable->sim_patch_capacity, count);
+
+  PIDX_patch *sim_patch = realloc(variable->sim_patch, capacity * sizeof (*sim_patch));
+  if (sim_patch == NULL)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_variable;
+  }
+  memset(sim_patch + variable->sim_patch_capacity, 0, (capacity - variable->sim_patch_capacity) * sizeof (*sim_patch));
+
+  variable->sim_patch = sim_patch;
+  variable->sim_patch_capacity = capacity;
+
+  return PIDX_success;
+}
+
+
+
+void PIDX_variable_free_patches(PIDX_variable variable)
+{
+  free(variable->sim_patch);
+  variable->sim_patch = NULL;
+  variable->sim_patch_capacity = 0;
+}
@@ -42,7 +42,7 @@
 
 #include "../PIDX_inc.h"
 
-PIDX_io PIDX_io_init( idx_dataset idx_meta_data, idx_comm idx_c, idx_debug idx_dbg, PIDX_metadata_cache meta_data_cache, idx_blocks idx_b, PIDX_restructured_grid restructured_grid, PIDX_time time, int fs_block_size, int variable_index_tracker)
+PIDX_io PIDX_io_init( idx_dataset idx_meta_data, idx_comm idx_c, idx_debug idx_dbg, PIDX_metadata_cache meta_data_cache, PIDX_block_cache block_cache, PIDX_time_step_prefetch prefetch, idx_blocks idx_b, PIDX_restructured_grid restructured_grid, PIDX_time time, int fs_block_size, int variable_index_tracker)
 {
   //Creating the restructuring ID
   PIDX_io idx_io_id;
@@ -54,6 +54,8 @@ PIDX_io PIDX_io_init( idx_dataset idx_meta_data, idx_comm idx_c, idx_debug idx_d
   idx_io_id->idx_c = idx_c;
   idx_io_id->idx_b = idx_b;
   idx_io_id->meta_data_cache = meta_data_cache;
+  idx_io_id->block_cache = block_cache;
+  idx_io_id->prefetch = prefetch;
   idx_io_id->fs_block_size = fs_block_size;
   idx_io_id->variable_index_tracker = variable_index_tracker;
   idx_io_id->restructured_grid = restructured_grid;
@@ -134,7 +136,15 @@ PIDX_return_code PIDX_read(PIDX_io file, int svi, int evi, int MODE)
 
 
   if (MODE == PIDX_IDX_IO)
-    ret = PIDX_idx_read(file, svi, evi);
+  {
+    // files opened with PIDX_serial_file_open have no communicator
+    if (file->idx_c->simulation_nprocs == 0)
+      ret = PIDX_serial_idx_read(file, svi, evi);
+    else if (file->idx->restart_read == 1)
+      ret = PIDX_idx_restart_read(file, svi, evi);
+    else
+      ret = PIDX_idx_read(file, svi, evi);
+  }
 
   else if (MODE == PIDX_LOCAL_PARTITION_IDX_IO)
   {
@@ -73,6 +73,10 @@ struct PIDX_io_descriptor
   // for caching HZ indices
   PIDX_metadata_cache meta_data_cache;              ///< enables caching across time steps
 
+  // for caching idx blocks and binary file headers across reads
+  PIDX_block_cache block_cache;                     ///< LRU block cache (NULL when disabled)
+  PIDX_time_step_prefetch prefetch;                 ///< reads the next time step into block_cache (NULL when disabled)
+
   // for restructuring and partitioning
   PIDX_restructured_grid restructured_grid;         ///< contains information of the restructured grid
 
@@ -88,6 +92,8 @@ typedef struct PIDX_io_descriptor* PIDX_io;
 /// \param idx_c
 /// \param idx_dbg
 /// \param meta_data_cache
+/// \param block_cache
+/// \param prefetch
 /// \param idx_b
 /// \param restructured_grid
 /// \param time
@@ -95,7 +101,7 @@ typedef struct PIDX_io_descriptor* PIDX_io;
 /// \param variable_index_tracker
 /// \return
 ///
-PIDX_io PIDX_io_init( idx_dataset idx_meta_data, idx_comm idx_c, idx_debug idx_dbg, PIDX_metadata_cache meta_data_cache, idx_blocks idx_b, PIDX_restructured_grid restructured_grid, PIDX_time time, int fs_block_size, int variable_index_tracker);
+PIDX_io PIDX_io_init( idx_dataset idx_meta_data, idx_comm idx_c, idx_debug idx_dbg, PIDX_metadata_cache meta_data_cache, PIDX_block_cache block_cache, PIDX_time_step_prefetch prefetch, idx_blocks idx_b, PIDX_restructured_grid restructured_grid, PIDX_time time, int fs_block_size, int variable_index_tracker);
 
 
 ///
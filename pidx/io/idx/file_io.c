@@ -40,6 +40,8 @@
  */
 #include "../../PIDX_inc.h"
 
+static PIDX_return_code compress_blocks(PIDX_io file, int svi);
+static PIDX_return_code pack_compressed_blocks(PIDX_io file, int svi);
 
 
 PIDX_return_code file_io(PIDX_io file, int svi, int mode)
@@ -48,13 +50,22 @@ PIDX_return_code file_io(PIDX_io file, int svi, int mode)
   assert(file->idx_b->file0_agg_group_from_index == 0);
   PIDX_time time = file->time;
 
+  if (mode == PIDX_WRITE && PIDX_compression_block_container(file->idx))
+  {
+    if (compress_blocks(file, svi) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_compress;
+    }
+  }
+
   time->io_start[svi] = PIDX_get_time();
   for (uint32_t j = file->idx_b->file0_agg_group_from_index; j < file->idx_b->agg_level; j++)
   {
     Agg_buffer temp_agg = file->idx->agg_buffer[svi][j];
     PIDX_block_layout temp_layout = file->idx_b->block_layout_by_agg_group[j];
 
-    file->io_id[svi][j] = PIDX_file_io_init(file->idx, file->idx_c, file->fs_block_size, svi, svi);
+    file->io_id[svi][j] = PIDX_file_io_init(file->idx, file->idx_c, file->fs_block_size, file->block_cache, file->prefetch, file->comp_id, svi, svi);
 
     if (file->idx_dbg->debug_do_io == 1)
     {
@@ -75,3 +86,90 @@ PIDX_return_code file_io(PIDX_io file, int svi, int mode)
 
   return PIDX_success;
 }
+
+
+
+// compresses the blocks of every aggregation buffer and places them in the file after the ones written so far
+static PIDX_return_code compress_blocks(PIDX_io file, int svi)
+{
+  PIDX_time time = file->time;
+
+  for (int j = file->idx_b->file0_agg_group_from_index; j < file->idx_b->agg_level; j++)
+  {
+    time->agg_compress_start[svi][j] = PIDX_get_time();
+    if (PIDX_compression_compress_blocks(file->comp_id, file->idx->agg_buffer[svi][j], file->idx_b->block_layout_by_agg_group[j]) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_compress;
+    }
+    time->agg_compress_end[svi][j] = PIDX_get_time();
+  }
+
+  return pack_compressed_blocks(file, svi);
+}
+
+
+
+// Places the compressed buffers of every file one after the other. The offset of a buffer is the running size of
+// its file (every process keeps the size of every file, later variables are placed after it) plus the sizes of the
+// buffers of the same file on lower ranks, obtained with an exclusive scan over per file sizes. The exchange is
+// proportional to the number of files rather than to the number of processes, and the file order of the
+// buffers does not matter since readers find every block through the block table.
+static PIDX_return_code pack_compressed_blocks(PIDX_io file, int svi)
+{
+  idx_dataset idx = file->idx;
+  int level_count = file->idx_b->agg_level - file->idx_b->file0_agg_group_from_index;
+  int file_count = idx->max_file_count;
+
+  int64_t *local_size = malloc(file_count * sizeof(*local_size));
+  int64_t *lower_rank_size = malloc(file_count * sizeof(*lower_rank_size));
+  int64_t *total_size = malloc(file_count * sizeof(*total_size));
+  memset(local_size, 0, file_count * sizeof(*local_size));
+  memset(lower_rank_size, 0, file_count * sizeof(*lower_rank_size));
+
+  for (int j = 0; j < level_count; j++)
+  {
+    Agg_buffer ab = idx->agg_buffer[svi][j + file->idx_b->file0_agg_group_from_index];
+    if (ab->file_number != -1 && ab->var_number != -1)
+      local_size[ab->file_number] = local_size[ab->file_number] + (int64_t)ab->buffer_size;
+  }
+
+  // the receive buffer of rank 0 is left undefined by MPI_Exscan
+  if (MPI_Exscan(local_size, lower_rank_size, file_count, MPI_INT64_T, MPI_SUM, file->idx_c->partition_comm) != MPI_SUCCESS ||
+      MPI_Allreduce(local_size, total_size, file_count, MPI_INT64_T, MPI_SUM, file->idx_c->partition_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    free(local_size);
+    free(lower_rank_size);
+    free(total_size);
+    return PIDX_err_io;
+  }
+  if (file->idx_c->partition_rank == 0)
+    memset(lower_rank_size, 0, file_count * sizeof(*lower_rank_size));
+
+  if (idx->compressed_file_size == NULL)
+  {
+    idx->compressed_file_size = malloc(file_count * sizeof(*idx->compressed_file_size));
+    memset(idx->compressed_file_size, 0, file_count * sizeof(*idx->compressed_file_size));
+  }
+
+  // buffers of the same file on this process follow each other
+  for (int j = 0; j < level_count; j++)
+  {
+    Agg_buffer ab = idx->agg_buffer[svi][j + file->idx_b->file0_agg_group_from_index];
+    if (ab->file_number == -1 || ab->var_number == -1)
+      continue;
+
+    ab->data_offset = idx->compressed_file_size[ab->file_number] + lower_rank_size[ab->file_number];
+    lower_rank_size[ab->file_number] = lower_rank_size[ab->file_number] + (int64_t)ab->buffer_size;
+  }
+
+  for (int f = 0; f < file_count; f++)
+    idx->compressed_file_size[f] = idx->compressed_file_size[f] + total_size[f];
+
+  free(local_size);
+  free(lower_rank_size);
+  free(total_size);
+
+  return PIDX_success;
+}
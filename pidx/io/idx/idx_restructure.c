@@ -57,8 +57,14 @@ PIDX_return_code idx_restructure_setup(PIDX_io file, int svi, int evi)
   time->rst_init_end[cvi] = PIDX_get_time();
 
 
-  // Populates the relevant meta-data
+  // Populates the relevant meta-data (replayed from the cached plan when the decomposition is unchanged)
   time->rst_meta_data_create_start[cvi] = PIDX_get_time();
+  if (PIDX_idx_rst_plan_attach(file->idx_rst_id, file->meta_data_cache) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_rst;
+  }
+
   if (PIDX_idx_rst_meta_data_create(file->idx_rst_id) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
@@ -112,9 +118,13 @@ PIDX_return_code idx_restructure(PIDX_io file, int mode)
       }
 
       // Aggregating in memory restructured buffers into one large buffer
+      // (already done while receiving with the overlapped restructuring)
       time->rst_buff_agg_start[cvi] = PIDX_get_time();
-      ret = PIDX_idx_rst_buf_aggregate(file->idx_rst_id, PIDX_WRITE);
-      if (ret != PIDX_success) {fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__); return PIDX_err_rst;}
+      if (file->idx->rst_overlap != 1 || file->idx_dbg->debug_file_output_state != PIDX_NO_META_DATA_DUMP || file->idx_dbg->debug_rst != 0)
+      {
+        ret = PIDX_idx_rst_buf_aggregate(file->idx_rst_id, PIDX_WRITE);
+        if (ret != PIDX_success) {fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__); return PIDX_err_rst;}
+      }
       time->rst_buff_agg_end[cvi] = PIDX_get_time();
 
       // Destroying the restructure buffers (as they are now combined into one large buffer)
@@ -248,10 +258,40 @@ PIDX_return_code idx_restructure_rst_comm_create(PIDX_io file, int svi)
 {
   PIDX_variable var0 = file->idx->variable[svi];
 
-  MPI_Comm_rank(file->idx_c->simulation_comm, &(file->idx_c->simulation_rank));
+  idx_comm idx_c = file->idx_c;
+  int color = var0->restructured_super_patch_count;
+
+  MPI_Comm_rank(idx_c->simulation_comm, &(idx_c->simulation_rank));
+
+  // the communicator of the previous flush is reused if no process changed its color
+  int unchanged = (idx_c->is_rst_comm_cached == 1 && idx_c->cached_rst_parent == idx_c->simulation_comm && idx_c->cached_rst_color == color);
+  int all_unchanged = 0;
+  if (MPI_Allreduce(&unchanged, &all_unchanged, 1, MPI_INT, MPI_LAND, idx_c->simulation_comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_rst;
+  }
+
+  if (all_unchanged == 0)
+  {
+    if (free_cached_communicators(idx_c) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+
+    // the processes that are holding the super patch are grouped into the communicator rst_comm
+    if (MPI_Comm_split(idx_c->simulation_comm, color, idx_c->simulation_rank, &(idx_c->cached_rst_comm)) != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+    idx_c->cached_rst_parent = idx_c->simulation_comm;
+    idx_c->cached_rst_color = color;
+    idx_c->is_rst_comm_cached = 1;
+  }
 
-  // the processes that are holding the super patch are grouped into the communicator rst_comm
-  MPI_Comm_split(file->idx_c->simulation_comm, var0->restructured_super_patch_count, file->idx_c->simulation_rank, &(file->idx_c->rst_comm));
+  file->idx_c->rst_comm = idx_c->cached_rst_comm;
   MPI_Comm_rank(file->idx_c->rst_comm, &(file->idx_c->rrank));
   MPI_Comm_size(file->idx_c->rst_comm, &(file->idx_c->rnprocs));
 
@@ -269,11 +309,48 @@ PIDX_return_code idx_restructure_rst_comm_create(PIDX_io file, int svi)
 
 PIDX_return_code free_restructured_communicators(PIDX_io file)
 {
-  if(MPI_Comm_free(&(file->idx_c->rst_comm)) != MPI_SUCCESS)
+  // rst_comm is owned by the communicator cache and released at file close
+  file->idx_c->rst_comm = MPI_COMM_NULL;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code free_cached_communicators(idx_comm idx_c)
+{
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+
+  if (idx_c->is_partition_comm_cached == 1 && !finalized)
   {
-    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-    return PIDX_err_rst;
+    if (MPI_Comm_free(&(idx_c->cached_partition_comm)) != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+  }
+  idx_c->is_partition_comm_cached = 0;
+
+  if (idx_c->is_rst_comm_cached == 1 && !finalized)
+  {
+    if (MPI_Comm_free(&(idx_c->cached_rst_comm)) != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+  }
+  idx_c->is_rst_comm_cached = 0;
+
+  if (idx_c->is_nbx_comm_cached == 1 && !finalized)
+  {
+    if (MPI_Comm_free(&(idx_c->nbx_comm)) != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
   }
+  idx_c->is_nbx_comm_cached = 0;
 
   return PIDX_success;
 }
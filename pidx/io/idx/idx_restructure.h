@@ -105,6 +105,14 @@ PIDX_return_code idx_restructure_copy_rst_comm_to_partition_comm(PIDX_io file, i
 PIDX_return_code free_restructured_communicators(PIDX_io file);
 
 
+///
+/// \brief free_cached_communicators Frees the rst and partition communicators kept across flushes
+/// \param idx_c
+/// \return
+///
+PIDX_return_code free_cached_communicators(idx_comm idx_c);
+
+
 
 
 #endif
@@ -143,5 +143,12 @@ PIDX_return_code find_agg_level(PIDX_io file, int svi, int evi)
   //if (file->idx_c->partition_rank == 0)
   //  fprintf(stderr, "agg level %d pipe length %d\n", file->idx_b->agg_level, file->idx->variable_pipe_length);
 
+  // compressed blocks are packed by the aggregators, there is no per process io path for them
+  if (PIDX_compression_block_container(file->idx) && file->idx_b->agg_level != file->idx_b->file0_agg_group_count + file->idx_b->nfile0_agg_group_count)
+  {
+    fprintf(stderr, "[%s] [%d] block compression needs one aggregator per file and variable (%d processes)\n", __FILE__, __LINE__, file->idx_c->partition_nprocs);
+    return PIDX_err_unsupported_compression_type;
+  }
+
   return PIDX_success;
 }
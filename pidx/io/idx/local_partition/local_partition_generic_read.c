@@ -150,7 +150,6 @@ PIDX_return_code PIDX_local_partition_idx_generic_read(PIDX_io file, int svi, in
           }
 
 
-          uint32_t ctr = 1;
           uint32_t block_number = 0;
 
           // read the first block, the first block contains data from a lot of hz levels, so just make one accumulated read
@@ -161,23 +160,17 @@ PIDX_return_code PIDX_local_partition_idx_generic_read(PIDX_io file, int svi, in
           }
 
           // Iterate through the blocks from HZ level file->idx->bits_per_block + 1 to per_patch_local_block_layout->resolution_to
-          for (uint32_t i = file->idx->bits_per_block + 1 ; i < per_patch_local_block_layout->resolution_to ; i++)
+          uint64_t last_block = PIDX_blocks_level_first_block(per_patch_local_block_layout->resolution_to, file->idx->bits_per_block);
+          for (uint64_t b = PIDX_blocks_next_block(per_patch_local_block_layout, 1); b < last_block; b = PIDX_blocks_next_block(per_patch_local_block_layout, b + 1))
           {
-            for (uint32_t j = 0 ; j < ctr ; j++)
+            block_number = b;
+
+            // Iterating through all other blocks
+            if (read_block(file, si, p, block_number, intersected_box_offset, intersected_box_size, intersected_box_buffer) != PIDX_success)
             {
-              if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
-              {
-                block_number = per_patch_local_block_layout->hz_block_number_array[i][j];
-
-                // Iterating through all other blocks
-                if (read_block(file, si, p, block_number, intersected_box_offset, intersected_box_size, intersected_box_buffer) != PIDX_success)
-                {
-                  fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-                  return PIDX_err_io;
-                }
-              }
+              fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+              return PIDX_err_io;
             }
-            ctr = ctr * 2;
           }
 
           // With the reads completed, free the block bitmap
@@ -314,9 +307,6 @@ static PIDX_return_code parse_local_partition_idx_file(PIDX_io file, int partiti
 
 static PIDX_return_code read_block(PIDX_io file, int vi, int p, int block_number, uint64_t* patch_offset, uint64_t* patch_size, unsigned char* patch_buffer)
 {
-  MPI_File fp = 0;
-  MPI_Status status;
-
   // populate the name of the binary file to read
   char file_name[PATH_MAX];
   int file_number = block_number / file->idx->blocks_per_file;
@@ -341,45 +331,43 @@ static PIDX_return_code read_block(PIDX_io file, int vi, int p, int block_number
     sprintf(full_path_file_name, "%s", file_name);
   }
 
-  // open the binary file
-  if (MPI_File_open(MPI_COMM_SELF, full_path_file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
-  {
-    fprintf(stderr, "[%s] [%d] MPI_File_open() block number %d file number %d filename %s failed.\n", __FILE__, __LINE__, block_number, file_number, full_path_file_name);
-    return PIDX_err_io;
-  }
-
-  // read the header
-  uint32_t *headers;
-  int total_header_size = (10 + (10 * file->idx->blocks_per_file)) * sizeof (uint32_t) * file->idx->variable_count;
-  headers = malloc(total_header_size);
-  memset(headers, 0, total_header_size);
-
-  if (MPI_File_read_at(fp, 0, headers, total_header_size , MPI_BYTE, &status) != MPI_SUCCESS)
-  {
-    fprintf(stderr, "Data offset = [%s] [%d] MPI_File_write_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
-    return PIDX_err_io;
-  }
+  // decoded (offset, size) of every block of every variable, the file is opened only if the header or the block is not cached
+  PIDX_return_code ret = PIDX_success;
+  MPI_File fp = 0;
+  int is_open = 0;
+  unsigned char* block_buffer = NULL;
+  uint64_t *block_table = malloc(sizeof(*block_table) * 2 * file->idx->blocks_per_file * file->idx->variable_count);
+  memset(block_table, 0, sizeof(*block_table) * 2 * file->idx->blocks_per_file * file->idx->variable_count);
 
-  int read_count = 0;
-  MPI_Get_count(&status, MPI_BYTE, &read_count);
-  if (read_count != total_header_size)
+  if (PIDX_block_cache_read_header(file->block_cache, full_path_file_name, file->idx->current_time_step, file->idx->blocks_per_file, file->idx->variable_count, &fp, &is_open, block_table) != PIDX_success)
   {
-    fprintf(stderr, "[%s] [%d] MPI_File_write_at() failed. %d != %dd\n", __FILE__, __LINE__, read_count, total_header_size);
-    return PIDX_err_io;
+    fprintf(stderr, "[%s] [%d] reading the header of block number %d file number %d filename %s failed.\n", __FILE__, __LINE__, block_number, file_number, full_path_file_name);
+    ret = PIDX_err_io;
+    goto cleanup;
   }
 
   // use the header to find the offset in file that contains data corresponding to block_number
-  uint64_t data_offset = htonl(headers[12 + (( (block_number % file->idx->blocks_per_file) + (file->idx->blocks_per_file * vi))*10 )]);
-  uint64_t data_size = htonl(headers[14 + (( (block_number % file->idx->blocks_per_file) + (file->idx->blocks_per_file * vi))*10 )]);
+  uint64_t data_offset = block_table[2 * ((block_number % file->idx->blocks_per_file) + (file->idx->blocks_per_file * vi))];
+  uint64_t data_size = block_table[2 * ((block_number % file->idx->blocks_per_file) + (file->idx->blocks_per_file * vi)) + 1];
   assert (data_size != 0);
 
-  // read the data
+  // a block larger than its samples comes from a damaged header, it would overrun the block buffer
   int bytes_for_datatype = ((file->idx->variable[vi]->bpv / 8) * file->idx->variable[vi]->vps);
-  unsigned char* block_buffer = malloc(file->idx->samples_per_block * bytes_for_datatype);
-  if (MPI_File_read_at(fp, data_offset, block_buffer, data_size, MPI_BYTE, &status) != MPI_SUCCESS)
+  uint64_t block_bytes = (uint64_t)file->idx->samples_per_block * bytes_for_datatype;
+  if (data_size > block_bytes)
   {
-    fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_write_at() failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
-    return PIDX_err_io;
+    fprintf(stderr, "[%s] [%d] block number %d of %s has %lld bytes, more than the %lld bytes of a block.\n", __FILE__, __LINE__, block_number, full_path_file_name, (long long) data_size, (long long) block_bytes);
+    ret = PIDX_err_io;
+    goto cleanup;
+  }
+
+  // read the data
+  block_buffer = malloc(block_bytes);
+  if (PIDX_block_cache_read_block(file->block_cache, full_path_file_name, vi, file->idx->current_time_step, block_number, data_offset, data_size, &fp, &is_open, block_buffer) != PIDX_success)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] reading block failed for filename %s.\n", (long long)  data_offset, __FILE__, __LINE__, file_name);
+    ret = PIDX_err_io;
+    goto cleanup;
   }
 
   // copy the data from the block space to the box space
@@ -398,12 +386,14 @@ static PIDX_return_code read_block(PIDX_io file, int vi, int p, int block_number
 
   }
 
-  MPI_File_close(&fp);
+cleanup:
+  if (is_open == 1)
+    MPI_File_close(&fp);
 
   // free buffers
-  free(headers);
+  free(block_table);
   free(block_buffer);
   free(directory_path);
 
-  return PIDX_success;
+  return ret;
 }
@@ -62,4 +62,16 @@ PIDX_return_code PIDX_idx_write(PIDX_io file, int svi, int evi);
 ///
 PIDX_return_code PIDX_idx_read(PIDX_io file, int svi, int evi);
 
+
+///
+/// \brief PIDX_idx_restart_read Reads without restructuring, for restarts on a different
+/// number of processes. Every needed block is read once and the samples are moved
+/// to their patches with a single all-to-all.
+/// \param file
+/// \param svi
+/// \param evi
+/// \return
+///
+PIDX_return_code PIDX_idx_restart_read(PIDX_io file, int svi, int evi);
+
 #endif
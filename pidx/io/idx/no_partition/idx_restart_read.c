@@ -0,0 +1,644 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file idx_restart_read.c
+ *
+ * N-to-M restart read. Every process computes, from the block layout of its
+ * own patches, the idx blocks it needs. Every needed binary file is assigned
+ * to one reader, which reads each needed block once and sends every process
+ * the samples that fall inside its patches. The data moves in a single
+ * all-to-all, no restructuring, HZ encoding or aggregation is involved.
+ *
+ */
+
+#include "../../../PIDX_inc.h"
+
+// A block requested by a process, processed by the reader in block order
+struct restart_block_request_struct
+{
+  uint64_t block_number;
+  int rank;
+};
+typedef struct restart_block_request_struct restart_block_request;
+
+static PIDX_return_code serve_requests(PIDX_io file, int svi, int evi, uint64_t* request_buffer, int* request_count, int* request_offset, PIDX_buffer* reply);
+static void append_box_samples(PIDX_buffer* reply, unsigned char* block, uint64_t* xyz, uint64_t spb, uint64_t* box, int bytes_per_sample);
+static PIDX_return_code exchange_replies(unsigned char* send_buffer, uint64_t* send_count, uint64_t* send_offset, unsigned char* recv_buffer, uint64_t* recv_count, uint64_t* recv_offset, int nprocs, MPI_Comm comm);
+static int compare_block_request(const void* a, const void* b);
+static void reverse_value_endian(unsigned char* buffer, uint64_t value_count, int value_size);
+
+
+PIDX_return_code PIDX_idx_restart_read(PIDX_io file, int svi, int evi)
+{
+  // the samples are addressed directly in HZ space, only possible for uncompressed data
+  if (file->idx->compression_type != PIDX_NO_COMPRESSION)
+    return PIDX_idx_read(file, svi, evi);
+
+  int nprocs = file->idx_c->simulation_nprocs;
+  MPI_Comm comm = file->idx_c->simulation_comm;
+
+  // binary file template of the current time step (same as write_headers)
+  strcpy(file->idx->filename_partition, file->idx->filename);
+  generate_file_name_template(file->idx->maxh, file->idx->bits_per_block, file->idx->filename_partition, file->idx->filename_time_template, file->idx->current_time_step, file->idx->filename_template_partition);
+
+  uint64_t spb = file->idx->samples_per_block;
+  uint64_t bpf = file->idx->blocks_per_file;
+  uint64_t block_count = ((uint64_t)1 << (file->idx->maxh - 1)) / spb;
+  if (block_count == 0)
+    block_count = 1;
+  uint64_t file_count = (block_count + bpf - 1) / bpf;
+
+  // Step 1: blocks needed by the local patches
+  uint64_t* needed_blocks = NULL;
+  uint64_t needed_block_count = 0;
+  if (find_sim_patch_blocks(file, svi, block_count, &needed_blocks, &needed_block_count) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
+  }
+
+  // Step 2: every needed file is read by exactly one process, the needed files are dealt round robin
+  int* file_bitmap = malloc(file_count * sizeof(*file_bitmap));
+  memset(file_bitmap, 0, file_count * sizeof(*file_bitmap));
+  int* global_file_bitmap = malloc(file_count * sizeof(*global_file_bitmap));
+  memset(global_file_bitmap, 0, file_count * sizeof(*global_file_bitmap));
+
+  for (uint64_t i = 0; i < needed_block_count; i++)
+    file_bitmap[needed_blocks[i] / bpf] = 1;
+
+  MPI_Allreduce(file_bitmap, global_file_bitmap, file_count, MPI_INT, MPI_BOR, comm);
+
+  int* file_reader = file_bitmap;
+  int existing_file_count = 0;
+  for (uint64_t f = 0; f < file_count; f++)
+  {
+    file_reader[f] = -1;
+    if (global_file_bitmap[f] == 1)
+    {
+      file_reader[f] = existing_file_count % nprocs;
+      existing_file_count++;
+    }
+  }
+  free(global_file_bitmap);
+
+  // Step 3: send the patches and the needed blocks to their readers
+  PIDX_variable var0 = file->idx->variable[svi];
+  int patch_count = var0->sim_patch_count;
+
+  int* send_count = malloc(nprocs * sizeof(*send_count));
+  memset(send_count, 0, nprocs * sizeof(*send_count));
+  int* send_offset = malloc(nprocs * sizeof(*send_offset));
+  memset(send_offset, 0, nprocs * sizeof(*send_offset));
+  int* recv_count = malloc(nprocs * sizeof(*recv_count));
+  memset(recv_count, 0, nprocs * sizeof(*recv_count));
+  int* recv_offset = malloc(nprocs * sizeof(*recv_offset));
+  memset(recv_offset, 0, nprocs * sizeof(*recv_offset));
+
+  // a request is [patch count, (offset, size) of every patch, block count, blocks]
+  for (uint64_t i = 0; i < needed_block_count; i++)
+    send_count[file_reader[needed_blocks[i] / bpf]]++;
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (send_count[r] != 0)
+      send_count[r] = send_count[r] + 2 + 6 * patch_count;
+    if (r != 0)
+      send_offset[r] = send_offset[r - 1] + send_count[r - 1];
+  }
+
+  MPI_Alltoall(send_count, 1, MPI_INT, recv_count, 1, MPI_INT, comm);
+
+  int total_send_count = send_offset[nprocs - 1] + send_count[nprocs - 1];
+  int total_recv_count = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    recv_offset[r] = total_recv_count;
+    total_recv_count = total_recv_count + recv_count[r];
+  }
+
+  uint64_t* send_buffer = malloc((total_send_count + 1) * sizeof(*send_buffer));
+  memset(send_buffer, 0, (total_send_count + 1) * sizeof(*send_buffer));
+  uint64_t* recv_buffer = malloc((total_recv_count + 1) * sizeof(*recv_buffer));
+  memset(recv_buffer, 0, (total_recv_count + 1) * sizeof(*recv_buffer));
+
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (send_count[r] == 0)
+      continue;
+
+    uint64_t* request = send_buffer + send_offset[r];
+    request[0] = patch_count;
+    for (int p = 0; p < patch_count; p++)
+    {
+      for (int d = 0; d < 3; d++)
+      {
+        request[1 + 6 * p + d] = var0->sim_patch[p]->offset[d];
+        request[1 + 6 * p + 3 + d] = var0->sim_patch[p]->size[d];
+      }
+    }
+    request[1 + 6 * patch_count] = send_count[r] - 2 - 6 * patch_count;
+  }
+
+  int* fill = malloc(nprocs * sizeof(*fill));
+  memset(fill, 0, nprocs * sizeof(*fill));
+  for (uint64_t i = 0; i < needed_block_count; i++)
+  {
+    int r = file_reader[needed_blocks[i] / bpf];
+    send_buffer[send_offset[r] + 2 + 6 * patch_count + fill[r]] = needed_blocks[i];
+    fill[r]++;
+  }
+  free(fill);
+  free(file_reader);
+
+  MPI_Alltoallv(send_buffer, send_count, send_offset, MPI_UNSIGNED_LONG_LONG, recv_buffer, recv_count, recv_offset, MPI_UNSIGNED_LONG_LONG, comm);
+
+  // Step 4: read every requested block once and extract the samples of every requester
+  PIDX_buffer* reply = malloc(nprocs * sizeof(*reply));
+  for (int r = 0; r < nprocs; r++)
+    reply[r] = PIDX_buffer_create_empty();
+
+  int error = 0;
+  if (serve_requests(file, svi, evi, recv_buffer, recv_count, recv_offset, reply) != PIDX_success)
+    error = 1;
+
+  int global_error = 0;
+  MPI_Allreduce(&error, &global_error, 1, MPI_INT, MPI_MAX, comm);
+  if (global_error != 0)
+  {
+    for (int r = 0; r < nprocs; r++)
+      PIDX_buffer_free(&reply[r]);
+    free(reply);
+    free(send_buffer);
+    free(recv_buffer);
+    free(send_count);
+    free(send_offset);
+    free(recv_count);
+    free(recv_offset);
+    free(needed_blocks);
+    return PIDX_err_io;
+  }
+  free(recv_buffer);
+
+  // Step 5: single all-to-all of the sample values
+  uint64_t* data_send_count = malloc(nprocs * sizeof(*data_send_count));
+  uint64_t* data_send_offset = malloc(nprocs * sizeof(*data_send_offset));
+  uint64_t* data_recv_count = malloc(nprocs * sizeof(*data_recv_count));
+  uint64_t* data_recv_offset = malloc(nprocs * sizeof(*data_recv_offset));
+
+  uint64_t total_data_send = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    data_send_count[r] = reply[r].size;
+    data_send_offset[r] = total_data_send;
+    total_data_send = total_data_send + reply[r].size;
+  }
+
+  MPI_Alltoall(data_send_count, 1, MPI_UNSIGNED_LONG_LONG, data_recv_count, 1, MPI_UNSIGNED_LONG_LONG, comm);
+
+  uint64_t total_data_recv = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    data_recv_offset[r] = total_data_recv;
+    total_data_recv = total_data_recv + data_recv_count[r];
+  }
+
+  unsigned char* data_send_buffer = malloc(total_data_send + 1);
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (reply[r].size != 0)
+      memcpy(data_send_buffer + data_send_offset[r], reply[r].buffer, reply[r].size);
+    PIDX_buffer_free(&reply[r]);
+  }
+  free(reply);
+
+  unsigned char* data_recv_buffer = malloc(total_data_recv + 1);
+  int ret = exchange_replies(data_send_buffer, data_send_count, data_send_offset, data_recv_buffer, data_recv_count, data_recv_offset, nprocs, comm);
+  free(data_send_buffer);
+
+  // Step 6: scatter the samples into the patches, walking the blocks in the order the readers packed them.
+  // A reply of the wrong length means the reader and this process disagree on the layout, nothing after
+  // that point can be trusted so all the loops stop.
+  uint64_t* xyz = malloc(spb * 3 * sizeof(*xyz));
+  for (int r = 0; r < nprocs && ret == PIDX_success; r++)
+  {
+    if (send_count[r] == 0)
+      continue;
+
+    unsigned char* data = data_recv_buffer + data_recv_offset[r];
+    uint64_t consumed = 0;
+    uint64_t* blocks = send_buffer + send_offset[r] + 2 + 6 * patch_count;
+    uint64_t request_block_count = send_count[r] - 2 - 6 * patch_count;
+
+    for (uint64_t b = 0; b < request_block_count && ret == PIDX_success; b++)
+    {
+      hz_block_xyz(file, blocks[b], xyz);
+      for (int v = svi; v < evi && ret == PIDX_success; v++)
+      {
+        PIDX_variable var = file->idx->variable[v];
+        int bytes_per_sample = (var->bpv / 8) * var->vps;
+        for (int p = 0; p < patch_count && ret == PIDX_success; p++)
+        {
+          uint64_t box[6];
+          for (int d = 0; d < 3; d++)
+          {
+            box[d] = var0->sim_patch[p]->offset[d];
+            box[3 + d] = var0->sim_patch[p]->size[d];
+          }
+
+          for (uint64_t s = 0; s < spb; s++)
+          {
+            if (!is_sample_in_box(xyz + 3 * s, box))
+              continue;
+
+            if (consumed + bytes_per_sample > data_recv_count[r])
+            {
+              fprintf(stderr, "[%s] [%d] reader %d sent fewer samples than expected.\n", __FILE__, __LINE__, r);
+              ret = PIDX_err_io;
+              break;
+            }
+
+            uint64_t index = (box[3] * box[4] * (xyz[3 * s + 2] - box[2])) + (box[3] * (xyz[3 * s + 1] - box[1])) + (xyz[3 * s] - box[0]);
+            memcpy(var->sim_patch[p]->buffer + index * bytes_per_sample, data + consumed, bytes_per_sample);
+            consumed = consumed + bytes_per_sample;
+          }
+        }
+      }
+    }
+
+    if (ret == PIDX_success && consumed != data_recv_count[r])
+    {
+      fprintf(stderr, "[%s] [%d] reader %d sent more samples than expected.\n", __FILE__, __LINE__, r);
+      ret = PIDX_err_io;
+    }
+  }
+  free(xyz);
+
+  // the patches of a process that failed are partially filled, every process returns the same code
+  error = (ret != PIDX_success);
+  MPI_Allreduce(&error, &global_error, 1, MPI_INT, MPI_MAX, comm);
+  if (global_error != 0)
+    ret = PIDX_err_io;
+
+  free(data_recv_buffer);
+  free(data_send_count);
+  free(data_send_offset);
+  free(data_recv_count);
+  free(data_recv_offset);
+  free(send_buffer);
+  free(send_count);
+  free(send_offset);
+  free(recv_count);
+  free(recv_offset);
+  free(needed_blocks);
+
+  if (ret != PIDX_success)
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+
+  return ret;
+}
+
+
+
+static PIDX_return_code serve_requests(PIDX_io file, int svi, int evi, uint64_t* request_buffer, int* request_count, int* request_offset, PIDX_buffer* reply)
+{
+  int nprocs = file->idx_c->simulation_nprocs;
+  uint64_t spb = file->idx->samples_per_block;
+  uint64_t bpf = file->idx->blocks_per_file;
+  int variable_count = file->idx->variable_count;
+
+  // all the (block, requester) pairs, walked in block order so that every file and block is read once
+  uint64_t pair_count = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (request_count[r] != 0)
+    {
+      uint64_t* request = request_buffer + request_offset[r];
+      pair_count = pair_count + request[1 + 6 * request[0]];
+    }
+  }
+  if (pair_count == 0)
+    return PIDX_success;
+
+  restart_block_request* pair = malloc(pair_count * sizeof(*pair));
+  uint64_t c = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (request_count[r] == 0)
+      continue;
+
+    uint64_t* request = request_buffer + request_offset[r];
+    uint64_t* blocks = request + 2 + 6 * request[0];
+    for (uint64_t b = 0; b < request[1 + 6 * request[0]]; b++)
+    {
+      pair[c].block_number = blocks[b];
+      pair[c].rank = r;
+      c++;
+    }
+  }
+  qsort(pair, pair_count, sizeof(*pair), compare_block_request);
+
+  int max_bytes_per_sample = 0;
+  for (int v = svi; v < evi; v++)
+  {
+    int bytes_per_sample = (file->idx->variable[v]->bpv / 8) * file->idx->variable[v]->vps;
+    if (bytes_per_sample > max_bytes_per_sample)
+      max_bytes_per_sample = bytes_per_sample;
+  }
+
+  uint64_t* block_table = malloc(2 * bpf * variable_count * sizeof(*block_table));
+  unsigned char** block_buffer = malloc((evi - svi) * sizeof(*block_buffer));
+  for (int v = 0; v < evi - svi; v++)
+    block_buffer[v] = malloc(spb * max_bytes_per_sample);
+  uint64_t* xyz = malloc(spb * 3 * sizeof(*xyz));
+
+  char file_name[PATH_MAX];
+  MPI_File fp;
+  int is_open = 0;
+  int64_t current_file = -1;
+  PIDX_return_code ret = PIDX_success;
+
+  for (uint64_t i = 0; i < pair_count && ret == PIDX_success; )
+  {
+    uint64_t block_number = pair[i].block_number;
+    uint64_t file_number = block_number / bpf;
+
+    if ((int64_t)file_number != current_file)
+    {
+      if (is_open == 1)
+      {
+        MPI_File_close(&fp);
+        is_open = 0;
+      }
+
+      if (generate_file_name(bpf, file->idx->filename_template_partition, (unsigned int) file_number, file_name, PATH_MAX) == 1)
+      {
+        fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+        ret = PIDX_err_io;
+        break;
+      }
+
+      if (PIDX_block_cache_read_header(file->block_cache, file_name, file->idx->current_time_step, bpf, variable_count, &fp, &is_open, block_table) != PIDX_success)
+      {
+        fprintf(stderr, "[%s] [%d] reading the header of %s failed.\n", __FILE__, __LINE__, file_name);
+        ret = PIDX_err_io;
+        break;
+      }
+      current_file = file_number;
+    }
+
+    // read the block of every variable, blocks that were never written read back as zeros
+    for (int v = svi; v < evi; v++)
+    {
+      PIDX_variable var = file->idx->variable[v];
+      int bytes_per_sample = (var->bpv / 8) * var->vps;
+      uint64_t block_in_file = block_number % bpf;
+      uint64_t data_offset = block_table[2 * (block_in_file + (bpf * v))];
+      uint64_t data_size = block_table[2 * (block_in_file + (bpf * v)) + 1];
+
+      if (data_size > spb * bytes_per_sample)
+      {
+        fprintf(stderr, "[%s] [%d] block %lld of %s is larger than expected.\n", __FILE__, __LINE__, (long long)block_number, file_name);
+        ret = PIDX_err_io;
+        break;
+      }
+
+      memset(block_buffer[v - svi], 0, spb * bytes_per_sample);
+      if (data_size != 0)
+      {
+        if (PIDX_block_cache_read_block(file->block_cache, file_name, v, file->idx->current_time_step, block_number, data_offset, data_size, &fp, &is_open, block_buffer[v - svi]) != PIDX_success)
+        {
+          fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+          ret = PIDX_err_io;
+          break;
+        }
+
+        // 12 and 24 byte values are triplets of floats and doubles
+        if (file->idx->flip_endian == 1)
+        {
+          int value_size = (var->bpv/8 == 12 || var->bpv/8 == 24) ? var->bpv/24 : var->bpv/8;
+          reverse_value_endian(block_buffer[v - svi], data_size / value_size, value_size);
+        }
+      }
+    }
+    if (ret != PIDX_success)
+      break;
+
+    // the coordinates of the samples of the block are shared by all the requesters
+    hz_block_xyz(file, block_number, xyz);
+
+    for (; i < pair_count && pair[i].block_number == block_number; i++)
+    {
+      uint64_t* request = request_buffer + request_offset[pair[i].rank];
+      int requester_patch_count = request[0];
+
+      for (int v = svi; v < evi; v++)
+      {
+        PIDX_variable var = file->idx->variable[v];
+        int bytes_per_sample = (var->bpv / 8) * var->vps;
+        for (int p = 0; p < requester_patch_count; p++)
+          append_box_samples(&reply[pair[i].rank], block_buffer[v - svi], xyz, spb, request + 1 + 6 * p, bytes_per_sample);
+      }
+    }
+  }
+
+  if (is_open == 1)
+    MPI_File_close(&fp);
+
+  free(xyz);
+  for (int v = 0; v < evi - svi; v++)
+    free(block_buffer[v]);
+  free(block_buffer);
+  free(block_table);
+  free(pair);
+
+  return ret;
+}
+
+
+
+// Appends the samples of a block that fall inside box, every run of consecutive samples in one piece
+static void append_box_samples(PIDX_buffer* reply, unsigned char* block, uint64_t* xyz, uint64_t spb, uint64_t* box, int bytes_per_sample)
+{
+  uint64_t run_start = 0;
+  uint64_t run_length = 0;
+  for (uint64_t s = 0; s < spb; s++)
+  {
+    if (is_sample_in_box(xyz + 3 * s, box))
+    {
+      if (run_length == 0)
+        run_start = s;
+      run_length++;
+      continue;
+    }
+
+    if (run_length != 0)
+      PIDX_buffer_append(reply, block + run_start * bytes_per_sample, run_length * bytes_per_sample);
+    run_length = 0;
+  }
+
+  if (run_length != 0)
+    PIDX_buffer_append(reply, block + run_start * bytes_per_sample, run_length * bytes_per_sample);
+
+  return;
+}
+
+
+
+// The sample values go in a single MPI_Alltoallv when every count and offset fits its int arguments.
+// Past 2 GiB the replies go point to point instead, in messages of at most INT_MAX bytes (the messages
+// of a pair of processes are received in the order they were sent).
+static PIDX_return_code exchange_replies(unsigned char* send_buffer, uint64_t* send_count, uint64_t* send_offset, unsigned char* recv_buffer, uint64_t* recv_count, uint64_t* recv_offset, int nprocs, MPI_Comm comm)
+{
+  int fits = 1;
+  uint64_t message_count = 0;
+  for (int r = 0; r < nprocs; r++)
+  {
+    if (send_offset[r] + send_count[r] > INT_MAX || recv_offset[r] + recv_count[r] > INT_MAX)
+      fits = 0;
+    message_count = message_count + (send_count[r] + INT_MAX - 1) / INT_MAX + (recv_count[r] + INT_MAX - 1) / INT_MAX;
+  }
+
+  int all_fit = 0;
+  if (MPI_Allreduce(&fits, &all_fit, 1, MPI_INT, MPI_LAND, comm) != MPI_SUCCESS)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_mpi;
+  }
+
+  if (all_fit == 1)
+  {
+    int* count = malloc(4 * nprocs * sizeof(*count));
+    for (int r = 0; r < nprocs; r++)
+    {
+      count[r] = (int)send_count[r];
+      count[nprocs + r] = (int)send_offset[r];
+      count[2 * nprocs + r] = (int)recv_count[r];
+      count[3 * nprocs + r] = (int)recv_offset[r];
+    }
+
+    int ret = MPI_Alltoallv(send_buffer, count, count + nprocs, MPI_BYTE, recv_buffer, count + 2 * nprocs, count + 3 * nprocs, MPI_BYTE, comm);
+    free(count);
+    if (ret != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_mpi;
+    }
+
+    return PIDX_success;
+  }
+
+  MPI_Request* req = malloc((message_count + 1) * sizeof(*req));
+  int req_count = 0;
+  int ret = MPI_SUCCESS;
+  for (int r = 0; r < nprocs && ret == MPI_SUCCESS; r++)
+  {
+    for (uint64_t o = 0; o < recv_count[r] && ret == MPI_SUCCESS; o = o + INT_MAX)
+    {
+      int length = (recv_count[r] - o > INT_MAX) ? INT_MAX : (int)(recv_count[r] - o);
+      ret = MPI_Irecv(recv_buffer + recv_offset[r] + o, length, MPI_BYTE, r, 0, comm, &req[req_count]);
+      if (ret == MPI_SUCCESS)
+        req_count++;
+    }
+  }
+
+  for (int r = 0; r < nprocs && ret == MPI_SUCCESS; r++)
+  {
+    for (uint64_t o = 0; o < send_count[r] && ret == MPI_SUCCESS; o = o + INT_MAX)
+    {
+      int length = (send_count[r] - o > INT_MAX) ? INT_MAX : (int)(send_count[r] - o);
+      ret = MPI_Isend(send_buffer + send_offset[r] + o, length, MPI_BYTE, r, 0, comm, &req[req_count]);
+      if (ret == MPI_SUCCESS)
+        req_count++;
+    }
+  }
+
+  // the messages already posted are cancelled if one could not be, their buffers go away after the read
+  if (ret != MPI_SUCCESS)
+  {
+    for (int n = 0; n < req_count; n++)
+      MPI_Cancel(&req[n]);
+    MPI_Waitall(req_count, req, MPI_STATUSES_IGNORE);
+  }
+  else
+    ret = MPI_Waitall(req_count, req, MPI_STATUSES_IGNORE);
+  free(req);
+
+  if (ret != MPI_SUCCESS)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_mpi;
+  }
+
+  return PIDX_success;
+}
+
+
+
+static int compare_block_request(const void* a, const void* b)
+{
+  const restart_block_request* x = a;
+  const restart_block_request* y = b;
+
+  if (x->block_number != y->block_number)
+    return (x->block_number < y->block_number) ? -1 : 1;
+  if (x->rank != y->rank)
+    return (x->rank < y->rank) ? -1 : 1;
+
+  return 0;
+}
+
+
+
+static void reverse_value_endian(unsigned char* buffer, uint64_t value_count, int value_size)
+{
+  for (uint64_t v = 0; v < value_count; v++)
+  {
+    unsigned char* value = buffer + v * value_size;
+    for (int i = 0; i < value_size / 2; i++)
+    {
+      unsigned char temp = value[i];
+      value[i] = value[value_size - 1 - i];
+      value[value_size - 1 - i] = temp;
+    }
+  }
+
+  return;
+}
@@ -253,13 +253,42 @@ static PIDX_return_code partition_setup(PIDX_io file, int svi)
 
 static PIDX_return_code create_partition_comm(PIDX_io file)
 {
-  // Grouping processes with same color and creating a partition for them
-  if (MPI_Comm_split(file->idx_c->rst_comm, file->idx_c->color, file->idx_c->rrank, &(file->idx_c->partition_comm)) != MPI_SUCCESS)
+  idx_comm idx_c = file->idx_c;
+
+  // the partition communicator of the previous flush is reused if rst_comm was reused and no
+  // process changed its partition
+  int unchanged = (idx_c->is_partition_comm_cached == 1 && idx_c->cached_partition_color == idx_c->color);
+  int all_unchanged = 0;
+  if (MPI_Allreduce(&unchanged, &all_unchanged, 1, MPI_INT, MPI_LAND, idx_c->rst_comm) != MPI_SUCCESS)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_file;
   }
 
+  if (all_unchanged == 0)
+  {
+    if (idx_c->is_partition_comm_cached == 1)
+    {
+      if (MPI_Comm_free(&(idx_c->cached_partition_comm)) != MPI_SUCCESS)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_file;
+      }
+      idx_c->is_partition_comm_cached = 0;
+    }
+
+    // Grouping processes with same color and creating a partition for them
+    if (MPI_Comm_split(idx_c->rst_comm, idx_c->color, idx_c->rrank, &(idx_c->cached_partition_comm)) != MPI_SUCCESS)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+    idx_c->cached_partition_color = idx_c->color;
+    idx_c->is_partition_comm_cached = 1;
+  }
+
+  file->idx_c->partition_comm = idx_c->cached_partition_comm;
+
   MPI_Comm_size(file->idx_c->partition_comm, &(file->idx_c->partition_nprocs));
   MPI_Comm_rank(file->idx_c->partition_comm, &(file->idx_c->partition_rank));
 
@@ -273,12 +302,8 @@ PIDX_return_code partition_cleanup(PIDX_io file)
   PIDX_time time = file->time;
 
   time->partition_cleanup_start = MPI_Wtime();
-  // freeing the partitined comm
-  if (MPI_Comm_free(&(file->idx_c->partition_comm)) != MPI_SUCCESS)
-  {
-    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
-    return PIDX_err_file;
-  }
+  // the partitioned comm is owned by the communicator cache and released at file close
+  file->idx_c->partition_comm = MPI_COMM_NULL;
   time->partition_cleanup_end = MPI_Wtime();
 
   return PIDX_success;
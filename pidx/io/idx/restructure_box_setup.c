@@ -40,10 +40,19 @@
  */
 
 #include "../../PIDX_inc.h"
-static PIDX_return_code populate_restructured_grid(PIDX_io file);
+static PIDX_return_code populate_restructured_grid(PIDX_io file, const int* box_rank);
 static void guess_restructured_box_size(PIDX_io file, int svi);
 static void adjust_restructured_box_size(PIDX_io file);
 static PIDX_return_code set_reg_patch_size_from_bit_string(PIDX_io file);
+static int is_decomposition_uneven(PIDX_io file, int svi, uint64_t* min_size);
+static PIDX_return_code select_load_aware_box(PIDX_io file, int svi, uint64_t* min_size);
+static double assign_box_ranks(PIDX_io file, int svi, const uint64_t* ps, int* box_rank);
+
+struct box_load
+{
+  double bytes;
+  int rank;
+};
 
 
 PIDX_return_code set_rst_box_size_for_write(PIDX_io file, int svi)
@@ -51,6 +60,21 @@ PIDX_return_code set_rst_box_size_for_write(PIDX_io file, int svi)
   PIDX_time time = file->time;
   time->set_reg_box_start = PIDX_get_time();
 
+  // Uneven (multi patch, AMR like or non uniform) decompositions pick the box size and the
+  // owner of every box from an estimate of the bytes each box receives
+  uint64_t min_size[PIDX_MAX_DIMENSIONS];
+  if (is_decomposition_uneven(file, svi, min_size))
+  {
+    if (select_load_aware_box(file, svi, min_size) != PIDX_success)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_rst;
+    }
+
+    time->set_reg_box_end = MPI_Wtime();
+    return PIDX_success;
+  }
+
   // Guess the initial restrucuting box size
   // Compute the largest box length in each dimension (requires MPI reduce)
   // The restructuring box size is the closest power of two of the largest box
@@ -61,7 +85,7 @@ PIDX_return_code set_rst_box_size_for_write(PIDX_io file, int svi)
   adjust_restructured_box_size(file);
 
   // Assign rank to each of the restructured super patch
-  if (populate_restructured_grid(file) != PIDX_success)
+  if (populate_restructured_grid(file, NULL) != PIDX_success)
   {
     fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
     return PIDX_err_rst;
@@ -85,7 +109,7 @@ PIDX_return_code set_rst_box_size_for_read(PIDX_io file, int svi)
   // box bigger to make sure that a process holding only one patch at a time.
   set_reg_patch_size_from_bit_string(file);
 
-  populate_restructured_grid(file);
+  populate_restructured_grid(file, NULL);
 
   time->set_reg_box_end = MPI_Wtime();
 
@@ -98,13 +122,15 @@ static void guess_restructured_box_size(PIDX_io file, int svi)
   int patch_size_x = 0, patch_size_y = 0, patch_size_z = 0;
   int max_patch_size_x = 0, max_patch_size_y = 0, max_patch_size_z = 0;
 
-  // check if the procee at least have on patch
-  // TODO for multi patch runs, pick the patch with maximum length
-  if (file->idx->variable[svi]->sim_patch_count != 0)
+  // for multi patch runs, pick the maximum length over all the patches
+  for (int p = 0; p < file->idx->variable[svi]->sim_patch_count; p++)
   {
-    patch_size_x = file->idx->variable[svi]->sim_patch[0]->size[0];
-    patch_size_y = file->idx->variable[svi]->sim_patch[0]->size[1];
-    patch_size_z = file->idx->variable[svi]->sim_patch[0]->size[2];
+    if (file->idx->variable[svi]->sim_patch[p]->size[0] > patch_size_x)
+      patch_size_x = file->idx->variable[svi]->sim_patch[p]->size[0];
+    if (file->idx->variable[svi]->sim_patch[p]->size[1] > patch_size_y)
+      patch_size_y = file->idx->variable[svi]->sim_patch[p]->size[1];
+    if (file->idx->variable[svi]->sim_patch[p]->size[2] > patch_size_z)
+      patch_size_z = file->idx->variable[svi]->sim_patch[p]->size[2];
   }
 
   // compute the maximum box length in each dimension
@@ -164,7 +190,242 @@ static void adjust_restructured_box_size(PIDX_io file)
 
 
 
-static PIDX_return_code populate_restructured_grid(PIDX_io file)
+static int is_decomposition_uneven(PIDX_io file, int svi, uint64_t* min_size)
+{
+  PIDX_variable var = file->idx->variable[svi];
+
+  // [min size x, y, z, patch count] reduced with min and max
+  uint64_t local_min[PIDX_MAX_DIMENSIONS + 1], local_max[PIDX_MAX_DIMENSIONS + 1];
+  uint64_t global_min[PIDX_MAX_DIMENSIONS + 1], global_max[PIDX_MAX_DIMENSIONS + 1];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    local_min[d] = UINT64_MAX;
+    local_max[d] = 0;
+  }
+  local_min[PIDX_MAX_DIMENSIONS] = var->sim_patch_count;
+  local_max[PIDX_MAX_DIMENSIONS] = var->sim_patch_count;
+
+  for (int p = 0; p < var->sim_patch_count; p++)
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    {
+      if (var->sim_patch[p]->size[d] != 0 && var->sim_patch[p]->size[d] < local_min[d])
+        local_min[d] = var->sim_patch[p]->size[d];
+      if (var->sim_patch[p]->size[d] > local_max[d])
+        local_max[d] = var->sim_patch[p]->size[d];
+    }
+
+  MPI_Allreduce(local_min, global_min, PIDX_MAX_DIMENSIONS + 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, file->idx_c->simulation_comm);
+  MPI_Allreduce(local_max, global_max, PIDX_MAX_DIMENSIONS + 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, file->idx_c->simulation_comm);
+
+  int uneven = (global_min[PIDX_MAX_DIMENSIONS] != global_max[PIDX_MAX_DIMENSIONS] || global_max[PIDX_MAX_DIMENSIONS] > 1);
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    if (global_min[d] == UINT64_MAX)
+      return 0;
+
+    if (global_min[d] != global_max[d])
+      uneven = 1;
+    min_size[d] = global_min[d];
+  }
+
+  return uneven;
+}
+
+
+
+static PIDX_return_code select_load_aware_box(PIDX_io file, int svi, uint64_t* min_size)
+{
+  // HZ encoding and aggregation need one power of two box size for the whole grid, so the
+  // candidates are uniform: starting from the smallest patch, one dimension is doubled at a
+  // time. The first three sizes giving at most one box per process are evaluated together
+  // with the size the uniform guess would pick, and the one with the smallest maximum
+  // receive volume (fewer boxes on near ties) wins.
+  uint64_t candidate[4][PIDX_MAX_DIMENSIONS];
+  int candidate_count = 0;
+
+  uint64_t ps[PIDX_MAX_DIMENSIONS];
+  uint64_t bound[PIDX_MAX_DIMENSIONS];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+  {
+    ps[d] = getPowerOf2(min_size[d]);
+    bound[d] = getPowerOf2(file->idx->box_bounds[d]);
+  }
+
+  int counter = 0;
+  while (candidate_count < 3)
+  {
+    uint64_t box_count = 1;
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+      box_count = box_count * (uint64_t)ceil((double)file->idx->box_bounds[d] / ps[d]);
+
+    if (box_count <= file->idx_c->simulation_nprocs)
+      memcpy(candidate[candidate_count++], ps, sizeof(ps));
+
+    if (ps[0] >= bound[0] && ps[1] >= bound[1] && ps[2] >= bound[2])
+      break;
+
+    // double the next dimension that is still smaller than the domain
+    while (ps[counter % PIDX_MAX_DIMENSIONS] >= bound[counter % PIDX_MAX_DIMENSIONS])
+      counter++;
+    ps[counter % PIDX_MAX_DIMENSIONS] = ps[counter % PIDX_MAX_DIMENSIONS] * 2;
+    counter++;
+  }
+
+  guess_restructured_box_size(file, svi);
+  adjust_restructured_box_size(file);
+  memcpy(candidate[candidate_count++], file->restructured_grid->patch_size, sizeof(ps));
+
+  int* box_rank = malloc(sizeof(*box_rank) * file->idx_c->simulation_nprocs);
+  int* best_rank = malloc(sizeof(*best_rank) * file->idx_c->simulation_nprocs);
+  int best = -1;
+  uint64_t best_box_count = 0;
+  double best_cost = 0;
+
+  for (int c = 0; c < candidate_count; c++)
+  {
+    uint64_t box_count = 1;
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+      box_count = box_count * (uint64_t)ceil((double)file->idx->box_bounds[d] / candidate[c][d]);
+
+    double cost = assign_box_ranks(file, svi, candidate[c], box_rank);
+    if (best == -1 || cost < 0.95 * best_cost || (cost <= 1.05 * best_cost && box_count < best_box_count))
+    {
+      best = c;
+      best_cost = cost;
+      best_box_count = box_count;
+      memcpy(best_rank, box_rank, sizeof(*box_rank) * box_count);
+    }
+  }
+
+  uint64_t *tpc = file->restructured_grid->total_patch_count;
+  memcpy(file->restructured_grid->patch_size, candidate[best], sizeof(ps));
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    tpc[d] = ceil((double)file->idx->box_bounds[d] / candidate[best][d]);
+
+  PIDX_return_code ret = populate_restructured_grid(file, best_rank);
+
+  free(box_rank);
+  free(best_rank);
+
+  return ret;
+}
+
+
+
+static int compare_box_load(const void* a, const void* b)
+{
+  const struct box_load* la = a;
+  const struct box_load* lb = b;
+
+  if (la->bytes != lb->bytes)
+    return (la->bytes > lb->bytes) ? -1 : 1;
+
+  return (la->rank < lb->rank) ? -1 : (la->rank > lb->rank);
+}
+
+
+
+// Assigns every box of size ps to a process (at most one box per process), preferring the
+// process that already holds most of the box. Returns the largest number of bytes a box
+// owner receives from the other processes.
+static double assign_box_ranks(PIDX_io file, int svi, const uint64_t* ps, int* box_rank)
+{
+  PIDX_variable var = file->idx->variable[svi];
+  int nprocs = file->idx_c->simulation_nprocs;
+  double bytes_per_sample = (var->bpv / 8) * var->vps;
+
+  uint64_t tpc[PIDX_MAX_DIMENSIONS];
+  for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    tpc[d] = ceil((double)file->idx->box_bounds[d] / ps[d]);
+  uint64_t box_count = tpc[0] * tpc[1] * tpc[2];
+
+  // bytes of my patches in every box, reduced to the total per box and to the largest holder
+  double* local_bytes = malloc(sizeof(*local_bytes) * box_count);
+  double* total_bytes = malloc(sizeof(*total_bytes) * box_count);
+  struct box_load* local_held = malloc(sizeof(*local_held) * box_count);
+  struct box_load* max_held = malloc(sizeof(*max_held) * box_count);
+  memset(local_bytes, 0, sizeof(*local_bytes) * box_count);
+
+  for (int p = 0; p < var->sim_patch_count; p++)
+  {
+    uint64_t *o = var->sim_patch[p]->offset;
+    uint64_t *s = var->sim_patch[p]->size;
+    if (s[0] == 0 || s[1] == 0 || s[2] == 0)
+      continue;
+
+    for (uint64_t k = o[2] / ps[2]; k <= (o[2] + s[2] - 1) / ps[2] && k < tpc[2]; k++)
+      for (uint64_t j = o[1] / ps[1]; j <= (o[1] + s[1] - 1) / ps[1] && j < tpc[1]; j++)
+        for (uint64_t i = o[0] / ps[0]; i <= (o[0] + s[0] - 1) / ps[0] && i < tpc[0]; i++)
+        {
+          uint64_t box_index[PIDX_MAX_DIMENSIONS] = {i, j, k};
+          double volume = 1;
+          for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+          {
+            uint64_t from = (o[d] > box_index[d] * ps[d]) ? o[d] : box_index[d] * ps[d];
+            uint64_t to = ((o[d] + s[d]) < (box_index[d] + 1) * ps[d]) ? (o[d] + s[d]) : (box_index[d] + 1) * ps[d];
+            volume = volume * (to - from);
+          }
+          local_bytes[(k * tpc[0] * tpc[1]) + (j * tpc[0]) + i] += volume * bytes_per_sample;
+        }
+  }
+
+  for (uint64_t b = 0; b < box_count; b++)
+  {
+    local_held[b].bytes = local_bytes[b];
+    local_held[b].rank = file->idx_c->simulation_rank;
+  }
+
+  MPI_Allreduce(local_bytes, total_bytes, box_count, MPI_DOUBLE, MPI_SUM, file->idx_c->simulation_comm);
+  MPI_Allreduce(local_held, max_held, box_count, MPI_DOUBLE_INT, MPI_MAXLOC, file->idx_c->simulation_comm);
+
+  // every process runs the same deterministic assignment on the reduced arrays:
+  // heaviest boxes first, each to its largest holder if still free
+  struct box_load* order = malloc(sizeof(*order) * box_count);
+  for (uint64_t b = 0; b < box_count; b++)
+  {
+    order[b].bytes = total_bytes[b];
+    order[b].rank = b;
+  }
+  qsort(order, box_count, sizeof(*order), compare_box_load);
+
+  char* taken = malloc(nprocs);
+  memset(taken, 0, nprocs);
+
+  double cost = 0;
+  for (uint64_t n = 0; n < box_count; n++)
+  {
+    uint64_t b = order[n].rank;
+    int rank = max_held[b].rank;
+    double received = total_bytes[b] - max_held[b].bytes;
+
+    if (max_held[b].bytes <= 0 || taken[rank])
+    {
+      // fall back to the evenly spread rank of the uniform layout, or the next free one
+      rank = b * (nprocs / box_count);
+      while (taken[rank])
+        rank = (rank + 1) % nprocs;
+      received = total_bytes[b];
+    }
+
+    taken[rank] = 1;
+    box_rank[b] = rank;
+    if (received > cost)
+      cost = received;
+  }
+
+  free(taken);
+  free(order);
+  free(local_bytes);
+  free(total_bytes);
+  free(local_held);
+  free(max_held);
+
+  return cost;
+}
+
+
+
+static PIDX_return_code populate_restructured_grid(PIDX_io file, const int* box_rank)
 {
   // TODO: cache computation
   // This function assigns the logical extents (offset and size) of each of the super patch in the restructured grid
@@ -235,8 +496,11 @@ static PIDX_return_code populate_restructured_grid(PIDX_io file)
         if (patch[index]->size[2] % file->idx->chunk_size[2] != 0)
           patch[index]->size[2] = (ceil((float)patch[index]->size[2] / file->idx->chunk_size[2])) * file->idx->chunk_size[2];
 
-        // assign rank to super patch
-        patch[index]->rank = rank_count * (file->idx_c->simulation_nprocs / (total_patch_count));
+        // assign rank to super patch (spread evenly unless the owners were chosen by load)
+        if (box_rank != NULL)
+          patch[index]->rank = box_rank[index];
+        else
+          patch[index]->rank = rank_count * (file->idx_c->simulation_nprocs / (total_patch_count));
         rank_count++;
       }
 
@@ -96,7 +96,6 @@ PIDX_return_code populate_rst_block_layouts(PIDX_io file, int svi, int hz_file0_
 
 static PIDX_return_code populate_idx_layout(PIDX_io file, int start_var_index, PIDX_block_layout block_layout, int lower_hz_level, int higher_hz_level)
 {
-  uint32_t ctr = 1;
   PIDX_return_code ret_code;
   int lvi = start_var_index;
 
@@ -145,77 +144,16 @@ static PIDX_return_code populate_idx_layout(PIDX_io file, int start_var_index, P
     return PIDX_err_file;
   }
 
-  if (all_patch_local_block_layout->resolution_from <= file->idx->bits_per_block)
-  {
-    for (uint32_t i = all_patch_local_block_layout->resolution_from ; i <=   file->idx->bits_per_block ; i++)
-    {
-      if (per_patch_local_block_layout->hz_block_number_array[i][0] == 0)
-      {
-        all_patch_local_block_layout->hz_block_number_array[i][0] = per_patch_local_block_layout->hz_block_number_array[i][0];
-        break;
-      }
-    }
-
-    ctr = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1 ; i < all_patch_local_block_layout->resolution_to ; i++)
-    {
-      for (uint32_t j = 0 ; j < ctr ; j++)
-      {
-        if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
-          all_patch_local_block_layout->hz_block_number_array[i][j] = per_patch_local_block_layout->hz_block_number_array[i][j];
-      }
-      ctr = ctr * 2;
-    }
-  }
-  else
-  {
-    ctr = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1 ; i < all_patch_local_block_layout->resolution_to ; i++)
-    {
-      if (i >= all_patch_local_block_layout->resolution_from)
-      {
-        for (uint32_t j = 0 ; j < ctr ; j++)
-        {
-          if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
-            all_patch_local_block_layout->hz_block_number_array[i][j] = per_patch_local_block_layout->hz_block_number_array[i][j];
-        }
-      }
-      ctr = ctr * 2;
-    }
-  }
+  PIDX_blocks_merge_levels(all_patch_local_block_layout, per_patch_local_block_layout, all_patch_local_block_layout->resolution_from, all_patch_local_block_layout->resolution_to, file->idx->bits_per_block);
 
   PIDX_blocks_free_layout(file->idx->bits_per_block, file->idx->maxh, per_patch_local_block_layout);
   free(per_patch_local_block_layout);
   per_patch_local_block_layout = 0;
 
-  if (block_layout->resolution_from <= file->idx->bits_per_block)
+  if (PIDX_blocks_reduce_levels(block_layout, all_patch_local_block_layout, block_layout->resolution_from, block_layout->resolution_to, file->idx->bits_per_block, file->idx_c->partition_comm) != PIDX_success)
   {
-    uint32_t level_count = 1;
-    for (uint32_t i = block_layout->resolution_from; i <= file->idx->bits_per_block; i++)
-    {
-      //if (i >= file->idx->maxh)
-      //  continue;
-
-      MPI_Allreduce(all_patch_local_block_layout->hz_block_number_array[i], block_layout->hz_block_number_array[i], level_count, MPI_INT, MPI_BOR, file->idx_c->partition_comm);
-    }
-
-    for (uint32_t i = file->idx->bits_per_block + 1; i < (block_layout->resolution_to); i++)
-    {
-      MPI_Allreduce(all_patch_local_block_layout->hz_block_number_array[i], block_layout->hz_block_number_array[i], level_count, MPI_INT, MPI_BOR, file->idx_c->partition_comm);
-      level_count = level_count * 2;
-    }
-  }
-  else
-  {
-    int level_count = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1; i < (block_layout->resolution_to); i++)
-    {
-      if (i >= block_layout->resolution_from)
-      {
-        MPI_Allreduce(all_patch_local_block_layout->hz_block_number_array[i], block_layout->hz_block_number_array[i], level_count, MPI_INT, MPI_BOR, file->idx_c->partition_comm);
-      }
-      level_count = level_count * 2;
-    }
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
   }
 
   //if (rank == 4)
@@ -238,63 +176,26 @@ static PIDX_return_code populate_idx_layout(PIDX_io file, int start_var_index, P
   memset(block_layout->lbi, 0, sizeof(int) * (file->idx->max_file_count));
 
   uint32_t file_number = 0;
-  if (block_layout->resolution_from <=   file->idx->bits_per_block)
+  if (block_layout->resolution_from <= file->idx->bits_per_block)
   {
-    for (uint32_t i = block_layout->resolution_from ; i <= file->idx->bits_per_block ; i++)
-    {
-      if (block_layout->hz_block_number_array[i][0] == 0)
-      {
-        file_number = block_layout->hz_block_number_array[i][0] / file->idx->blocks_per_file;
-        block_layout->file_bitmap[file_number] = 1;
-        block_layout->file_index[file_number] = 1;
-        block_layout->bcpf[file_number]++;
-        block_layout->lbi[file_number] = 0;
-        break;
-      }
-    }
-
-    ctr = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      for (uint32_t j = 0; j < ctr; j++)
-      {
-        if (block_layout->hz_block_number_array[i][j] != 0)
-        {
-          file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-          block_layout->file_bitmap[file_number] = 1;
-          block_layout->file_index[file_number] = 1;
-          block_layout->bcpf[file_number]++;
-          block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-        }
-      }
-      ctr = ctr * 2;
-    }
-
-    //if (file->idx_c->partition_nprocsrank == 4)
-    //  PIDX_blocks_print_layout(block_layout);
+    // block 0 holds all the levels up to bits_per_block
+    block_layout->file_bitmap[0] = 1;
+    block_layout->file_index[0] = 1;
+    block_layout->bcpf[0]++;
+    block_layout->lbi[0] = 0;
   }
-  else
+
+  uint64_t last_block = PIDX_blocks_level_first_block(block_layout->resolution_to, file->idx->bits_per_block);
+  for (uint64_t b = PIDX_blocks_next_block(block_layout, PIDX_blocks_level_first_block(block_layout->resolution_from, file->idx->bits_per_block)); b < last_block; b = PIDX_blocks_next_block(block_layout, b + 1))
   {
-    ctr = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      if (i >= block_layout->resolution_from)
-      {
-        for (uint32_t j = 0; j < ctr; j++)
-        {
-          if (block_layout->hz_block_number_array[i][j] != 0)
-          {
-            file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-            block_layout->file_bitmap[file_number] = 1;
-            block_layout->file_index[file_number] = 1;
-            block_layout->bcpf[file_number]++;
-            block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-          }
-        }
-      }
-      ctr = ctr * 2;
-    }
+    file_number = b / file->idx->blocks_per_file;
+    block_layout->file_bitmap[file_number] = 1;
+    block_layout->file_index[file_number] = 1;
+    block_layout->bcpf[file_number]++;
+    block_layout->lbi[file_number] = b % file->idx->blocks_per_file;
   }
+  PIDX_blocks_build_rank(block_layout);
+
   block_layout->efc = 0;
   for (uint32_t i = 0; i < file->idx->max_file_count; i++)
     if (block_layout->file_index[i] == 1)
@@ -330,7 +231,7 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
 
   PIDX_return_code ret_code;
 
-  int ctr, file_number = 0;
+  int file_number = 0;
 
   int lower_hz_level = 0, higher_hz_level = 0;
   int lower_level_low_layout = 0, higher_level_low_layout = 0;
@@ -368,23 +269,10 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
       return PIDX_err_file;
     }
 
-    for (uint32_t j = lower_hz_level ; j < file->idx->bits_per_block + 1 ; j++)
-    {
-      if (j >= file->idx->maxh)
-        continue;
-
-      memcpy(block_layout->hz_block_number_array[j], layout_by_level[0]->hz_block_number_array[j], sizeof(int));
-    }
-
-    ctr = 1;
     int temp_level = file->idx->bits_per_block + log2(file->idx->blocks_per_file) + 1;
     if (temp_level >= higher_hz_level)
       temp_level = higher_hz_level;
-    for (uint32_t j = file->idx->bits_per_block + 1 ; j < temp_level ; j++)
-    {
-      memcpy(block_layout->hz_block_number_array[j], layout_by_level[0]->hz_block_number_array[j], sizeof(int) * ctr);
-      ctr = ctr * 2;
-    }
+    PIDX_blocks_merge_levels(block_layout, layout_by_level[0], lower_hz_level, temp_level, file->idx->bits_per_block);
 
     for (uint32_t i = 1; i < layout_count; i++)
     {
@@ -405,20 +293,11 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
         return PIDX_err_file;
       }
 
-      memcpy(block_layout->hz_block_number_array[lower_level_higher_layout], layout_by_level[i]->hz_block_number_array[lower_level_higher_layout], sizeof(int) * ctr);
-      ctr = ctr * 2;
+      PIDX_blocks_merge_levels(block_layout, layout_by_level[i], lower_level_higher_layout, higher_level_higher_layout, file->idx->bits_per_block);
     }
   }
   else
   {
-    ctr = 1;
-    int temp_level = file->idx->bits_per_block + log2(file->idx->blocks_per_file) + 1;
-    if (temp_level >= higher_hz_level)
-      temp_level = higher_hz_level;
-    for (uint32_t j = file->idx->bits_per_block + 1 ; j < temp_level ; j++)
-      ctr = ctr * 2;
-
-    ctr = (int)pow(2, start_layout_index - 1) * file->idx->blocks_per_file;
     for (uint32_t i = start_layout_index; i < end_layout_index; i++)
     {
       lower_level_higher_layout = file->idx->bits_per_block + log2(file->idx->blocks_per_file) + 1 + (i - 1);
@@ -438,8 +317,7 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
         return PIDX_err_file;
       }
 
-      memcpy(block_layout->hz_block_number_array[lower_level_higher_layout], layout_by_level[i - start_layout_index]->hz_block_number_array[lower_level_higher_layout], sizeof(int) * ctr);
-      ctr = ctr * 2;
+      PIDX_blocks_merge_levels(block_layout, layout_by_level[i - start_layout_index], lower_level_higher_layout, higher_level_higher_layout, file->idx->bits_per_block);
     }
   }
 
@@ -455,62 +333,26 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
   block_layout->lbi = malloc(sizeof(int) * (file->idx->max_file_count));
   memset(block_layout->lbi, 0, sizeof(int) * (file->idx->max_file_count));
 
-  if (block_layout->resolution_from <=   file->idx->bits_per_block)
+  if (block_layout->resolution_from <= file->idx->bits_per_block)
   {
-    for (uint32_t i = block_layout->resolution_from ; i <= file->idx->bits_per_block ; i++)
-    {
-      if (block_layout->hz_block_number_array[i][0] == 0)
-      {
-        file_number = block_layout->hz_block_number_array[i][0] / file->idx->blocks_per_file;
-        block_layout->file_bitmap[file_number] = 1;
-        file->idx_b->block_bitmap[file_number][block_layout->hz_block_number_array[i][0] % file->idx->blocks_per_file] = 1;
-        block_layout->file_index[file_number] = 1;
-        block_layout->bcpf[file_number]++;
-        break;
-      }
-    }
-
-    ctr = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      for (uint32_t j = 0; j < ctr; j++)
-      {
-        if (block_layout->hz_block_number_array[i][j] != 0)
-        {
-          file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-          block_layout->file_bitmap[file_number] = 1;
-          file->idx_b->block_bitmap[file_number][block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file] = 1;
-          block_layout->file_index[file_number] = 1;
-          block_layout->bcpf[file_number]++;
-          block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-        }
-      }
-      ctr = ctr * 2;
-    }
+    // block 0 holds all the levels up to bits_per_block
+    block_layout->file_bitmap[0] = 1;
+    file->idx_b->block_bitmap[0][0] = 1;
+    block_layout->file_index[0] = 1;
+    block_layout->bcpf[0]++;
   }
-  else
+
+  uint64_t last_block = PIDX_blocks_level_first_block(block_layout->resolution_to, file->idx->bits_per_block);
+  for (uint64_t b = PIDX_blocks_next_block(block_layout, PIDX_blocks_level_first_block(block_layout->resolution_from, file->idx->bits_per_block)); b < last_block; b = PIDX_blocks_next_block(block_layout, b + 1))
   {
-    ctr = 1;
-    for (uint32_t i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      if (i >= block_layout->resolution_from)
-      {
-        for (uint32_t j = 0; j < ctr; j++)
-        {
-          if (block_layout->hz_block_number_array[i][j] != 0)
-          {
-            file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-            block_layout->file_bitmap[file_number] = 1;
-            file->idx_b->block_bitmap[file_number][block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file] = 1;
-            block_layout->file_index[file_number] = 1;
-            block_layout->bcpf[file_number]++;
-            block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-          }
-        }
-      }
-      ctr = ctr * 2;
-    }
+    file_number = b / file->idx->blocks_per_file;
+    block_layout->file_bitmap[file_number] = 1;
+    file->idx_b->block_bitmap[file_number][b % file->idx->blocks_per_file] = 1;
+    block_layout->file_index[file_number] = 1;
+    block_layout->bcpf[file_number]++;
+    block_layout->lbi[file_number] = b % file->idx->blocks_per_file;
   }
+  PIDX_blocks_build_rank(block_layout);
 
   block_layout->efc = 0;
   for (uint32_t i = 0; i < file->idx->max_file_count; i++)
@@ -580,3 +422,112 @@ PIDX_return_code destroy_block_layout(PIDX_io file)
 
   return PIDX_success;
 }
+
+
+
+PIDX_return_code find_sim_patch_blocks(PIDX_io file, int svi, uint64_t block_count, uint64_t** needed_blocks, uint64_t* needed_block_count)
+{
+  PIDX_variable var0 = file->idx->variable[svi];
+
+  int bounding_box[2][5] = {
+    {0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0}
+  };
+
+  PIDX_block_layout layout = malloc(sizeof (*layout));
+  memset(layout, 0, sizeof (*layout));
+  if (PIDX_blocks_initialize_layout(layout, 0, file->idx->maxh, file->idx->maxh, file->idx->bits_per_block) != PIDX_success)
+  {
+    fprintf(stderr, "[%s] [%d ]Error in PIDX_blocks_initialize_layout", __FILE__, __LINE__);
+    return PIDX_err_file;
+  }
+
+  // the layout is the union of the layouts of all the local patches
+  for (int p = 0; p < var0->sim_patch_count; p++)
+  {
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+    {
+      bounding_box[0][d] = var0->sim_patch[p]->offset[d];
+      bounding_box[1][d] = var0->sim_patch[p]->offset[d] + var0->sim_patch[p]->size[d];
+    }
+
+    if (PIDX_blocks_create_layout(bounding_box, file->idx->maxh, file->idx->bits_per_block, file->idx->bitPattern, layout, 0) != PIDX_success)
+    {
+      fprintf(stderr, "[%s] [%d ]Error in PIDX_blocks_create_layout", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+  }
+
+  // levels up to bits_per_block all live in block 0, which is needed only if one of its samples is local
+  uint64_t capacity = 64;
+  *needed_block_count = 0;
+  *needed_blocks = malloc(sizeof(**needed_blocks) * capacity);
+
+  uint64_t spb = file->idx->samples_per_block;
+  uint64_t* xyz = malloc(spb * 3 * sizeof(*xyz));
+  hz_block_xyz(file, 0, xyz);
+  for (uint64_t s = 0; s < spb && *needed_block_count == 0; s++)
+  {
+    for (int p = 0; p < var0->sim_patch_count; p++)
+    {
+      uint64_t box[6];
+      for (int d = 0; d < 3; d++)
+      {
+        box[d] = var0->sim_patch[p]->offset[d];
+        box[3 + d] = var0->sim_patch[p]->size[d];
+      }
+      if (is_sample_in_box(xyz + 3 * s, box))
+      {
+        (*needed_blocks)[0] = 0;
+        *needed_block_count = 1;
+        break;
+      }
+    }
+  }
+  free(xyz);
+
+  // finer levels: every intersecting block is set in the layout
+  for (uint64_t b = PIDX_blocks_next_block(layout, 1); b < block_count && b < layout->block_count; b = PIDX_blocks_next_block(layout, b + 1))
+  {
+    if (*needed_block_count == capacity)
+    {
+      capacity = capacity * 2;
+      *needed_blocks = realloc(*needed_blocks, sizeof(**needed_blocks) * capacity);
+    }
+    (*needed_blocks)[*needed_block_count] = b;
+    (*needed_block_count)++;
+  }
+
+  PIDX_blocks_free_layout(file->idx->bits_per_block, file->idx->maxh, layout);
+  free(layout);
+
+  return PIDX_success;
+}
+
+
+
+void hz_block_xyz(PIDX_io file, uint64_t block_number, uint64_t* xyz)
+{
+  uint64_t spb = file->idx->samples_per_block;
+  uint64_t point[PIDX_MAX_DIMENSIONS];
+
+  for (uint64_t s = 0; s < spb; s++)
+  {
+    memset(point, 0, sizeof(point));
+    Hz_to_xyz(file->idx->bitPattern, file->idx->maxh - 1, block_number * spb + s, point);
+    xyz[3 * s] = point[0];
+    xyz[3 * s + 1] = point[1];
+    xyz[3 * s + 2] = point[2];
+  }
+
+  return;
+}
+
+
+
+int is_sample_in_box(const uint64_t* xyz, const uint64_t* box)
+{
+  return (xyz[0] >= box[0] && xyz[0] < box[0] + box[3] &&
+          xyz[1] >= box[1] && xyz[1] < box[1] + box[4] &&
+          xyz[2] >= box[2] && xyz[2] < box[2] + box[5]);
+}
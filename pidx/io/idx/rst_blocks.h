@@ -46,4 +46,13 @@ PIDX_return_code delete_rst_block_layout(PIDX_io file);
 
 PIDX_return_code populate_rst_block_layouts(PIDX_io file, int svi, int hz_file0_from, int hz_n_file0_to);
 
+// Ascending list of the blocks (out of block_count) holding at least one sample of the simulation patches of variable svi
+PIDX_return_code find_sim_patch_blocks(PIDX_io file, int svi, uint64_t block_count, uint64_t** blocks, uint64_t* count);
+
+// xyz (3 values per sample) of all the samples of an idx block
+void hz_block_xyz(PIDX_io file, uint64_t block_number, uint64_t* xyz);
+
+// 1 if xyz lies inside box = (offset[3], size[3])
+int is_sample_in_box(const uint64_t* xyz, const uint64_t* box);
+
 #endif
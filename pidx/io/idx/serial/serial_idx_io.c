@@ -264,8 +264,7 @@ static PIDX_return_code populate_sim_block_layouts(PIDX_io file, int svi, int hz
 
 static PIDX_return_code populate_idx_layout_serial(PIDX_io file, int start_var_index, PIDX_block_layout block_layout, int lower_hz_level, int higher_hz_level)
 {
-  int i, j;
-  int p = 0, ctr = 1;
+  int i;
   PIDX_return_code ret_code;
 
   int bounding_box[2][5] = {
@@ -288,7 +287,7 @@ static PIDX_return_code populate_idx_layout_serial(PIDX_io file, int start_var_i
   PIDX_variable var = file->idx->variable[lvi];
 
 
-    for (p = 0 ; p < var->sim_patch_count ; p++)
+    for (int p = 0 ; p < var->sim_patch_count ; p++)
     {
       for (i = 0; i < PIDX_MAX_DIMENSIONS; i++)
       {
@@ -319,44 +318,7 @@ static PIDX_return_code populate_idx_layout_serial(PIDX_io file, int start_var_i
         return PIDX_err_file;
       }
 
-      if (all_patch_local_block_layout->resolution_from <= file->idx->bits_per_block)
-      {
-        for (i = all_patch_local_block_layout->resolution_from ; i <= file->idx->bits_per_block ; i++)
-        {
-          if (per_patch_local_block_layout->hz_block_number_array[i][0] == 0)
-          {
-            all_patch_local_block_layout->hz_block_number_array[i][0] = per_patch_local_block_layout->hz_block_number_array[i][0];
-            break;
-          }
-        }
-
-        ctr = 1;
-        for (i = file->idx->bits_per_block + 1 ; i < all_patch_local_block_layout->resolution_to ; i++)
-        {
-          for (j = 0 ; j < ctr ; j++)
-          {
-            if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
-              all_patch_local_block_layout->hz_block_number_array[i][j] = per_patch_local_block_layout->hz_block_number_array[i][j];
-          }
-          ctr = ctr * 2;
-        }
-      }
-      else
-      {
-        ctr = 1;
-        for (i = file->idx->bits_per_block + 1 ; i < all_patch_local_block_layout->resolution_to ; i++)
-        {
-          if (i >= all_patch_local_block_layout->resolution_from)
-          {
-            for (j = 0 ; j < ctr ; j++)
-            {
-              if (per_patch_local_block_layout->hz_block_number_array[i][j] != 0)
-                all_patch_local_block_layout->hz_block_number_array[i][j] = per_patch_local_block_layout->hz_block_number_array[i][j];
-            }
-          }
-          ctr = ctr * 2;
-        }
-      }
+      PIDX_blocks_merge_levels(all_patch_local_block_layout, per_patch_local_block_layout, all_patch_local_block_layout->resolution_from, all_patch_local_block_layout->resolution_to, file->idx->bits_per_block);
 
       PIDX_blocks_free_layout(file->idx->bits_per_block, file->idx->maxh, per_patch_local_block_layout);
       free(per_patch_local_block_layout);
@@ -364,35 +326,12 @@ static PIDX_return_code populate_idx_layout_serial(PIDX_io file, int start_var_i
     }
 
 
-  if (block_layout->resolution_from <=   file->idx->bits_per_block)
-  {
-    int level_count = 1;
-    for (i = block_layout->resolution_from; i <=   file->idx->bits_per_block; i++)
-    {
-      MPI_Allreduce(all_patch_local_block_layout->hz_block_number_array[i], block_layout->hz_block_number_array[i], level_count, MPI_INT, MPI_BOR, file->idx_c->partition_comm);
-    }
-
-    for (i =   file->idx->bits_per_block + 1; i < (block_layout->resolution_to); i++)
-    {
-      MPI_Allreduce(all_patch_local_block_layout->hz_block_number_array[i], block_layout->hz_block_number_array[i], level_count, MPI_INT, MPI_BOR, file->idx_c->partition_comm);
-      level_count = level_count * 2;
-    }
-  }
-  else
+  if (PIDX_blocks_reduce_levels(block_layout, all_patch_local_block_layout, block_layout->resolution_from, block_layout->resolution_to, file->idx->bits_per_block, file->idx_c->partition_comm) != PIDX_success)
   {
-    int level_count = 1;
-    for (i =   file->idx->bits_per_block + 1; i < (block_layout->resolution_to); i++)
-    {
-      if (i >= block_layout->resolution_from)
-      {
-        MPI_Allreduce(all_patch_local_block_layout->hz_block_number_array[i], block_layout->hz_block_number_array[i], level_count, MPI_INT, MPI_BOR, file->idx_c->partition_comm);
-
-      }
-      level_count = level_count * 2;
-    }
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
   }
 
-
   PIDX_blocks_free_layout(file->idx->bits_per_block, file->idx->maxh, all_patch_local_block_layout);
   free(all_patch_local_block_layout);
   all_patch_local_block_layout = 0;
@@ -410,60 +349,26 @@ static PIDX_return_code populate_idx_layout_serial(PIDX_io file, int start_var_i
   memset(block_layout->lbi, 0, sizeof(int) * (file->idx->max_file_count));
 
   int file_number = 0;
-  if (block_layout->resolution_from <=   file->idx->bits_per_block)
+  if (block_layout->resolution_from <= file->idx->bits_per_block)
   {
-    for (i = block_layout->resolution_from ; i <= file->idx->bits_per_block ; i++)
-    {
-      if (block_layout->hz_block_number_array[i][0] == 0)
-      {
-        file_number = block_layout->hz_block_number_array[i][0] / file->idx->blocks_per_file;
-        block_layout->file_bitmap[file_number] = 1;
-        block_layout->file_index[file_number] = 1;
-        block_layout->bcpf[file_number]++;
-        block_layout->lbi[file_number] = 0;
-        break;
-      }
-    }
-
-    ctr = 1;
-    for (i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      for (j = 0; j < ctr; j++)
-      {
-        if (block_layout->hz_block_number_array[i][j] != 0)
-        {
-          file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-          block_layout->file_bitmap[file_number] = 1;
-          block_layout->file_index[file_number] = 1;
-          block_layout->bcpf[file_number]++;
-          block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-        }
-      }
-      ctr = ctr * 2;
-    }
+    // block 0 holds all the levels up to bits_per_block
+    block_layout->file_bitmap[0] = 1;
+    block_layout->file_index[0] = 1;
+    block_layout->bcpf[0]++;
+    block_layout->lbi[0] = 0;
   }
-  else
+
+  uint64_t last_block = PIDX_blocks_level_first_block(block_layout->resolution_to, file->idx->bits_per_block);
+  for (uint64_t b = PIDX_blocks_next_block(block_layout, PIDX_blocks_level_first_block(block_layout->resolution_from, file->idx->bits_per_block)); b < last_block; b = PIDX_blocks_next_block(block_layout, b + 1))
   {
-    ctr = 1;
-    for (i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      if (i >= block_layout->resolution_from)
-      {
-        for (j = 0; j < ctr; j++)
-        {
-          if (block_layout->hz_block_number_array[i][j] != 0)
-          {
-            file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-            block_layout->file_bitmap[file_number] = 1;
-            block_layout->file_index[file_number] = 1;
-            block_layout->bcpf[file_number]++;
-            block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-          }
-        }
-      }
-      ctr = ctr * 2;
-    }
+    file_number = b / file->idx->blocks_per_file;
+    block_layout->file_bitmap[file_number] = 1;
+    block_layout->file_index[file_number] = 1;
+    block_layout->bcpf[file_number]++;
+    block_layout->lbi[file_number] = b % file->idx->blocks_per_file;
   }
+  PIDX_blocks_build_rank(block_layout);
+
   block_layout->efc = 0;
   for (i = 0; i < file->idx->max_file_count; i++)
     if (block_layout->file_index[i] == 1)
@@ -498,7 +403,7 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
 
   PIDX_return_code ret_code;
 
-  int i = 0, j = 0, ctr, file_number = 0;
+  int i = 0, file_number = 0;
 
   int lower_hz_level = 0, higher_hz_level = 0;
   int lower_level_low_layout = 0, higher_level_low_layout = 0;
@@ -535,18 +440,10 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
       return PIDX_err_file;
     }
 
-    for (j = lower_hz_level ; j < file->idx->bits_per_block + 1 ; j++)
-      memcpy(block_layout->hz_block_number_array[j], layout_by_level[0]->hz_block_number_array[j], sizeof(int));
-
-    ctr = 1;
     int temp_level = file->idx->bits_per_block + log2(file->idx->blocks_per_file) + 1;
     if (temp_level >= higher_hz_level)
       temp_level = higher_hz_level;
-    for (j = file->idx->bits_per_block + 1 ; j < temp_level ; j++)
-    {
-      memcpy(block_layout->hz_block_number_array[j], layout_by_level[0]->hz_block_number_array[j], sizeof(int) * ctr);
-      ctr = ctr * 2;
-    }
+    PIDX_blocks_merge_levels(block_layout, layout_by_level[0], lower_hz_level, temp_level, file->idx->bits_per_block);
 
     for (i = 1; i < layout_count; i++)
     {
@@ -567,20 +464,11 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
         return PIDX_err_file;
       }
 
-      memcpy(block_layout->hz_block_number_array[lower_level_higher_layout], layout_by_level[i]->hz_block_number_array[lower_level_higher_layout], sizeof(int) * ctr);
-      ctr = ctr * 2;
+      PIDX_blocks_merge_levels(block_layout, layout_by_level[i], lower_level_higher_layout, higher_level_higher_layout, file->idx->bits_per_block);
     }
   }
   else
   {
-    ctr = 1;
-    int temp_level = file->idx->bits_per_block + log2(file->idx->blocks_per_file) + 1;
-    if (temp_level >= higher_hz_level)
-      temp_level = higher_hz_level;
-    for (j = file->idx->bits_per_block + 1 ; j < temp_level ; j++)
-      ctr = ctr * 2;
-
-    ctr = (int)pow(2, start_layout_index - 1) * file->idx->blocks_per_file;
     for (i = start_layout_index; i < end_layout_index; i++)
     {
       lower_level_higher_layout = file->idx->bits_per_block + log2(file->idx->blocks_per_file) + 1 + (i - 1);
@@ -600,8 +488,7 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
         return PIDX_err_file;
       }
 
-      memcpy(block_layout->hz_block_number_array[lower_level_higher_layout], layout_by_level[i - start_layout_index]->hz_block_number_array[lower_level_higher_layout], sizeof(int) * ctr);
-      ctr = ctr * 2;
+      PIDX_blocks_merge_levels(block_layout, layout_by_level[i - start_layout_index], lower_level_higher_layout, higher_level_higher_layout, file->idx->bits_per_block);
     }
   }
 
@@ -617,62 +504,26 @@ static PIDX_return_code populate_idx_block_layout(PIDX_io file, PIDX_block_layou
   block_layout->lbi = malloc(sizeof(int) * (file->idx->max_file_count));
   memset(block_layout->lbi, 0, sizeof(int) * (file->idx->max_file_count));
 
-  if (block_layout->resolution_from <=   file->idx->bits_per_block)
+  if (block_layout->resolution_from <= file->idx->bits_per_block)
   {
-    for (i = block_layout->resolution_from ; i <= file->idx->bits_per_block ; i++)
-    {
-      if (block_layout->hz_block_number_array[i][0] == 0)
-      {
-        file_number = block_layout->hz_block_number_array[i][0] / file->idx->blocks_per_file;
-        block_layout->file_bitmap[file_number] = 1;
-        file->idx_b->block_bitmap[file_number][block_layout->hz_block_number_array[i][0] % file->idx->blocks_per_file] = 1;
-        block_layout->file_index[file_number] = 1;
-        block_layout->bcpf[file_number]++;
-        break;
-      }
-    }
-
-    ctr = 1;
-    for (i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      for (j = 0; j < ctr; j++)
-      {
-        if (block_layout->hz_block_number_array[i][j] != 0)
-        {
-          file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-          block_layout->file_bitmap[file_number] = 1;
-          file->idx_b->block_bitmap[file_number][block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file] = 1;
-          block_layout->file_index[file_number] = 1;
-          block_layout->bcpf[file_number]++;
-          block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-        }
-      }
-      ctr = ctr * 2;
-    }
+    // block 0 holds all the levels up to bits_per_block
+    block_layout->file_bitmap[0] = 1;
+    file->idx_b->block_bitmap[0][0] = 1;
+    block_layout->file_index[0] = 1;
+    block_layout->bcpf[0]++;
   }
-  else
+
+  uint64_t last_block = PIDX_blocks_level_first_block(block_layout->resolution_to, file->idx->bits_per_block);
+  for (uint64_t b = PIDX_blocks_next_block(block_layout, PIDX_blocks_level_first_block(block_layout->resolution_from, file->idx->bits_per_block)); b < last_block; b = PIDX_blocks_next_block(block_layout, b + 1))
   {
-    ctr = 1;
-    for (i =   file->idx->bits_per_block + 1 ; i < block_layout->resolution_to ; i++)
-    {
-      if (i >= block_layout->resolution_from)
-      {
-        for (j = 0; j < ctr; j++)
-        {
-          if (block_layout->hz_block_number_array[i][j] != 0)
-          {
-            file_number = block_layout->hz_block_number_array[i][j] / file->idx->blocks_per_file;
-            block_layout->file_bitmap[file_number] = 1;
-            file->idx_b->block_bitmap[file_number][block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file] = 1;
-            block_layout->file_index[file_number] = 1;
-            block_layout->bcpf[file_number]++;
-            block_layout->lbi[file_number] = block_layout->hz_block_number_array[i][j] % file->idx->blocks_per_file;
-          }
-        }
-      }
-      ctr = ctr * 2;
-    }
+    file_number = b / file->idx->blocks_per_file;
+    block_layout->file_bitmap[file_number] = 1;
+    file->idx_b->block_bitmap[file_number][b % file->idx->blocks_per_file] = 1;
+    block_layout->file_index[file_number] = 1;
+    block_layout->bcpf[file_number]++;
+    block_layout->lbi[file_number] = b % file->idx->blocks_per_file;
   }
+  PIDX_blocks_build_rank(block_layout);
 
   block_layout->efc = 0;
   for (i = 0; i < file->idx->max_file_count; i++)
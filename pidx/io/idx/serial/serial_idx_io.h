@@ -52,6 +52,17 @@
 PIDX_return_code PIDX_serial_idx_write(PIDX_io file, int svi, int evi);
 
 
+///
+/// \brief PIDX_serial_idx_read Reads the patches of a serially opened file with a pool of
+/// threads (file->idx->read_thread_count, 0 uses one thread per core)
+/// \param file
+/// \param svi
+/// \param evi
+/// \return
+///
+PIDX_return_code PIDX_serial_idx_read(PIDX_io file, int svi, int evi);
+
+
 
 
 #endif
@@ -0,0 +1,338 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/**
+ * \file serial_idx_read.c
+ *
+ * Multithreaded box read for single process consumers (files opened with
+ * PIDX_serial_file_open). The blocks holding samples of the requested patches
+ * are split in tasks, every task reads its blocks with pread, fixes the
+ * endianness and scatters the samples (HZ to xyz) into the patch buffers.
+ * The tasks run on a thread pool, no MPI call is made.
+ *
+ */
+
+#include "../../../PIDX_inc.h"
+
+struct serial_read_struct
+{
+  PIDX_io file;
+  int svi;
+  int evi;
+
+  uint64_t* blocks;                   // needed blocks, ascending
+  uint64_t* task_from;                // first entry of blocks read by a task
+  uint64_t* task_to;                  // one past the last entry
+  int max_bytes_per_sample;
+};
+typedef struct serial_read_struct* serial_read;
+
+static PIDX_return_code read_task(void* context, uint64_t task_index);
+static PIDX_return_code read_block_table(PIDX_io file, const char* file_name, int fd, uint64_t* block_table);
+static int read_fully(int fd, unsigned char* buffer, uint64_t size, uint64_t offset);
+static void reverse_value_endian(unsigned char* buffer, uint64_t value_count, int value_size);
+
+
+PIDX_return_code PIDX_serial_idx_read(PIDX_io file, int svi, int evi)
+{
+  if (file->idx->compression_type != PIDX_NO_COMPRESSION)
+    return PIDX_err_unsupported_compression_type;
+
+  // binary file template of the current time step (same as write_headers)
+  strcpy(file->idx->filename_partition, file->idx->filename);
+  generate_file_name_template(file->idx->maxh, file->idx->bits_per_block, file->idx->filename_partition, file->idx->filename_time_template, file->idx->current_time_step, file->idx->filename_template_partition);
+
+  uint64_t spb = file->idx->samples_per_block;
+  uint64_t bpf = file->idx->blocks_per_file;
+  uint64_t block_count = ((uint64_t)1 << (file->idx->maxh - 1)) / spb;
+  if (block_count == 0)
+    block_count = 1;
+
+  struct serial_read_struct read;
+  memset(&read, 0, sizeof(read));
+  read.file = file;
+  read.svi = svi;
+  read.evi = evi;
+
+  uint64_t needed_block_count = 0;
+  if (find_sim_patch_blocks(file, svi, block_count, &read.blocks, &needed_block_count) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_file;
+  }
+
+  for (int v = svi; v < evi; v++)
+  {
+    int bytes_per_sample = (file->idx->variable[v]->bpv / 8) * file->idx->variable[v]->vps;
+    if (bytes_per_sample > read.max_bytes_per_sample)
+      read.max_bytes_per_sample = bytes_per_sample;
+  }
+
+  int thread_count = (file->idx->read_thread_count > 0) ? file->idx->read_thread_count : PIDX_get_core_count();
+
+  // a task never spans two files (one open per task), large files are split so that there
+  // are a few tasks per thread even when the box touches only a handful of files
+  uint64_t needed_file_count = 0;
+  for (uint64_t i = 0; i < needed_block_count; i++)
+    if (i == 0 || read.blocks[i] / bpf != read.blocks[i - 1] / bpf)
+      needed_file_count++;
+
+  uint64_t tasks_per_file = 1;
+  if (needed_file_count != 0 && needed_file_count < 4 * (uint64_t)thread_count)
+    tasks_per_file = (4 * (uint64_t)thread_count + needed_file_count - 1) / needed_file_count;
+
+  read.task_from = malloc(sizeof(*read.task_from) * (needed_file_count * tasks_per_file + 1));
+  read.task_to = malloc(sizeof(*read.task_to) * (needed_file_count * tasks_per_file + 1));
+
+  uint64_t task_count = 0;
+  for (uint64_t i = 0; i < needed_block_count; )
+  {
+    uint64_t j = i;
+    while (j < needed_block_count && read.blocks[j] / bpf == read.blocks[i] / bpf)
+      j++;
+
+    uint64_t per_task = ((j - i) + tasks_per_file - 1) / tasks_per_file;
+    for (uint64_t k = i; k < j; k = k + per_task)
+    {
+      read.task_from[task_count] = k;
+      read.task_to[task_count] = (k + per_task < j) ? k + per_task : j;
+      task_count++;
+    }
+    i = j;
+  }
+
+  PIDX_return_code ret = PIDX_thread_pool_run(thread_count, task_count, read_task, &read);
+  if (ret != PIDX_success)
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+
+  free(read.task_from);
+  free(read.task_to);
+  free(read.blocks);
+
+  return ret;
+}
+
+
+
+static PIDX_return_code read_task(void* context, uint64_t task_index)
+{
+  serial_read read = context;
+  PIDX_io file = read->file;
+  uint64_t spb = file->idx->samples_per_block;
+  uint64_t bpf = file->idx->blocks_per_file;
+  PIDX_variable var0 = file->idx->variable[read->svi];
+
+  uint64_t first = read->task_from[task_index];
+  uint64_t last = read->task_to[task_index];
+  uint64_t file_number = read->blocks[first] / bpf;
+
+  char file_name[PATH_MAX];
+  if (generate_file_name(bpf, file->idx->filename_template_partition, (unsigned int) file_number, file_name, PATH_MAX) == 1)
+  {
+    fprintf(stderr, "[%s] [%d] generate_file_name() failed.\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0)
+  {
+    fprintf(stderr, "[%s] [%d] open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  uint64_t* block_table = malloc(2 * bpf * file->idx->variable_count * sizeof(*block_table));
+  if (read_block_table(file, file_name, fd, block_table) != PIDX_success)
+  {
+    free(block_table);
+    close(fd);
+    return PIDX_err_io;
+  }
+
+  unsigned char* block_buffer = malloc(spb * read->max_bytes_per_sample);
+  uint64_t* xyz = malloc(spb * 3 * sizeof(*xyz));
+  PIDX_return_code ret = PIDX_success;
+
+  for (uint64_t i = first; i < last && ret == PIDX_success; i++)
+  {
+    uint64_t block_number = read->blocks[i];
+    uint64_t block_in_file = block_number % bpf;
+
+    hz_block_xyz(file, block_number, xyz);
+
+    for (int v = read->svi; v < read->evi; v++)
+    {
+      PIDX_variable var = file->idx->variable[v];
+      int bytes_per_sample = (var->bpv / 8) * var->vps;
+      uint64_t data_offset = block_table[2 * (block_in_file + (bpf * v))];
+      uint64_t data_size = block_table[2 * (block_in_file + (bpf * v)) + 1];
+
+      if (data_size > spb * bytes_per_sample)
+      {
+        fprintf(stderr, "[%s] [%d] block %lld of %s is larger than expected.\n", __FILE__, __LINE__, (long long)block_number, file_name);
+        ret = PIDX_err_io;
+        break;
+      }
+
+      // blocks that were never written read back as zeros
+      memset(block_buffer, 0, spb * bytes_per_sample);
+      if (data_size != 0)
+      {
+        if (file->block_cache == NULL || PIDX_block_cache_copy(file->block_cache, file_name, v, file->idx->current_time_step, block_number, block_buffer, data_size) == 0)
+        {
+          if (read_fully(fd, block_buffer, data_size, data_offset) != 0)
+          {
+            fprintf(stderr, "Data offset = %lld [%s] [%d] pread() failed for filename %s.\n", (long long) data_offset, __FILE__, __LINE__, file_name);
+            ret = PIDX_err_io;
+            break;
+          }
+
+          if (file->block_cache != NULL)
+            PIDX_block_cache_insert(file->block_cache, file_name, v, file->idx->current_time_step, block_number, block_buffer, data_size);
+        }
+
+        // 12 and 24 byte values are triplets of floats and doubles
+        if (file->idx->flip_endian == 1)
+        {
+          int value_size = (var->bpv/8 == 12 || var->bpv/8 == 24) ? var->bpv/24 : var->bpv/8;
+          reverse_value_endian(block_buffer, data_size / value_size, value_size);
+        }
+      }
+
+      // every sample belongs to exactly one block, so tasks never write the same bytes
+      for (int p = 0; p < var0->sim_patch_count; p++)
+      {
+        uint64_t box[6];
+        for (int d = 0; d < 3; d++)
+        {
+          box[d] = var0->sim_patch[p]->offset[d];
+          box[3 + d] = var0->sim_patch[p]->size[d];
+        }
+
+        for (uint64_t s = 0; s < spb; s++)
+        {
+          if (!is_sample_in_box(xyz + 3 * s, box))
+            continue;
+
+          uint64_t index = (box[3] * box[4] * (xyz[3 * s + 2] - box[2])) + (box[3] * (xyz[3 * s + 1] - box[1])) + (xyz[3 * s] - box[0]);
+          memcpy(var->sim_patch[p]->buffer + index * bytes_per_sample, block_buffer + s * bytes_per_sample, bytes_per_sample);
+        }
+      }
+    }
+  }
+
+  free(xyz);
+  free(block_buffer);
+  free(block_table);
+  close(fd);
+
+  return ret;
+}
+
+
+
+// decoded (offset, size) of every (variable, block) pair, from the block cache when possible
+static PIDX_return_code read_block_table(PIDX_io file, const char* file_name, int fd, uint64_t* block_table)
+{
+  uint64_t bpf = file->idx->blocks_per_file;
+  uint64_t table_size = 2 * bpf * file->idx->variable_count * sizeof(*block_table);
+
+  if (file->block_cache != NULL && PIDX_block_cache_copy(file->block_cache, file_name, -1, file->idx->current_time_step, -1, (unsigned char*)block_table, table_size) == 1)
+    return PIDX_success;
+
+  uint64_t total_header_size = (10 + (10 * bpf)) * sizeof (uint32_t) * file->idx->variable_count;
+  uint32_t* headers = malloc(total_header_size);
+  if (read_fully(fd, (unsigned char*)headers, total_header_size, 0) != 0)
+  {
+    fprintf(stderr, "[%s] [%d] reading the header of %s failed.\n", __FILE__, __LINE__, file_name);
+    free(headers);
+    return PIDX_err_io;
+  }
+
+  for (uint64_t i = 0; i < bpf * file->idx->variable_count; i++)
+  {
+    block_table[2 * i] = htonl(headers[12 + i * 10]);
+    block_table[2 * i + 1] = htonl(headers[14 + i * 10]);
+  }
+  free(headers);
+
+  if (file->block_cache != NULL)
+    PIDX_block_cache_insert(file->block_cache, file_name, -1, file->idx->current_time_step, -1, (unsigned char*)block_table, table_size);
+
+  return PIDX_success;
+}
+
+
+
+static int read_fully(int fd, unsigned char* buffer, uint64_t size, uint64_t offset)
+{
+  uint64_t done = 0;
+  while (done < size)
+  {
+    ssize_t count = pread(fd, buffer + done, size - done, offset + done);
+    if (count <= 0)
+    {
+      if (count < 0 && errno == EINTR)
+        continue;
+      return 1;
+    }
+    done = done + count;
+  }
+
+  return 0;
+}
+
+
+
+static void reverse_value_endian(unsigned char* buffer, uint64_t value_count, int value_size)
+{
+  for (uint64_t v = 0; v < value_count; v++)
+  {
+    unsigned char* value = buffer + v * value_size;
+    for (int i = 0; i < value_size / 2; i++)
+    {
+      unsigned char temp = value[i];
+      value[i] = value[value_size - 1 - i];
+      value[value_size - 1 - i] = temp;
+    }
+  }
+
+  return;
+}
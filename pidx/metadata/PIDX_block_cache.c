@@ -0,0 +1,443 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#include "../PIDX_inc.h"
+
+#define PIDX_BLOCK_CACHE_BUCKET_COUNT 4096
+
+static uint64_t hash_key(const char* file_name, int variable_index, int time_step, int64_t block_number);
+static void lru_unlink(PIDX_block_cache cache, PIDX_block_cache_entry entry);
+static void lru_push_front(PIDX_block_cache cache, PIDX_block_cache_entry entry);
+static void evict_entry(PIDX_block_cache cache, PIDX_block_cache_entry entry);
+static PIDX_block_cache_entry lookup(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number);
+static PIDX_return_code open_on_miss(const char* file_name, MPI_File* fp, int* is_open);
+
+#if PIDX_HAVE_PTHREADS
+  #define CACHE_LOCK(cache) pthread_mutex_lock(&((cache)->lock))
+  #define CACHE_UNLOCK(cache) pthread_mutex_unlock(&((cache)->lock))
+#else
+  #define CACHE_LOCK(cache)
+  #define CACHE_UNLOCK(cache)
+#endif
+
+
+PIDX_return_code PIDX_create_block_cache(uint64_t capacity, PIDX_block_cache* cache)
+{
+  *cache = malloc(sizeof (*(*cache)));
+  memset(*cache, 0, sizeof (*(*cache)));
+
+  (*cache)->capacity = capacity;
+  (*cache)->bucket_count = PIDX_BLOCK_CACHE_BUCKET_COUNT;
+  (*cache)->bucket = malloc(sizeof(*((*cache)->bucket)) * (*cache)->bucket_count);
+  memset((*cache)->bucket, 0, sizeof(*((*cache)->bucket)) * (*cache)->bucket_count);
+
+#if PIDX_HAVE_PTHREADS
+  pthread_mutex_init(&((*cache)->lock), NULL);
+#endif
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_set_block_cache_capacity(PIDX_block_cache cache, uint64_t capacity)
+{
+  if (!cache)
+    return PIDX_err_file;
+
+  CACHE_LOCK(cache);
+  cache->capacity = capacity;
+  while (cache->size > cache->capacity && cache->lru_tail != NULL)
+    evict_entry(cache, cache->lru_tail);
+  CACHE_UNLOCK(cache);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_free_block_cache(PIDX_block_cache cache)
+{
+  if (!cache)
+    return PIDX_err_file;
+
+  while (cache->lru_tail != NULL)
+    evict_entry(cache, cache->lru_tail);
+
+#if PIDX_HAVE_PTHREADS
+  pthread_mutex_destroy(&cache->lock);
+#endif
+
+  free(cache->bucket);
+  free(cache);
+
+  return PIDX_success;
+}
+
+
+
+int PIDX_block_cache_contains(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, uint64_t* size)
+{
+  int found = 0;
+
+  CACHE_LOCK(cache);
+  PIDX_block_cache_entry entry = lookup(cache, file_name, variable_index, time_step, block_number);
+  if (entry != NULL)
+  {
+    found = 1;
+    if (size != NULL)
+      *size = entry->size;
+  }
+  CACHE_UNLOCK(cache);
+
+  return found;
+}
+
+
+
+PIDX_return_code PIDX_block_cache_drop_dataset(PIDX_block_cache cache, const char* idx_file_name)
+{
+  if (!cache)
+    return PIDX_err_file;
+
+  // binary files live in the directory named after the .idx file (see generate_file_name_template),
+  // and partitioned datasets add _<partition> to it
+  size_t length = strlen(idx_file_name);
+  if (length > 4 && strcmp(idx_file_name + length - 4, ".idx") == 0)
+    length = length - 4;
+
+  CACHE_LOCK(cache);
+  PIDX_block_cache_entry entry = cache->lru_head;
+  while (entry != NULL)
+  {
+    PIDX_block_cache_entry next = entry->lru_next;
+    if (strncmp(entry->file_name, idx_file_name, length) == 0)
+    {
+      const char* rest = entry->file_name + length;
+      if (*rest == '_')
+      {
+        rest++;
+        while (*rest >= '0' && *rest <= '9')
+          rest++;
+      }
+      if (*rest == '/')
+        evict_entry(cache, entry);
+    }
+    entry = next;
+  }
+  CACHE_UNLOCK(cache);
+
+  return PIDX_success;
+}
+
+
+
+int PIDX_block_cache_copy(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, unsigned char* buffer, uint64_t size)
+{
+  int copied = 0;
+
+  CACHE_LOCK(cache);
+  PIDX_block_cache_entry entry = lookup(cache, file_name, variable_index, time_step, block_number);
+  if (entry != NULL && entry->size >= size)
+  {
+    memcpy(buffer, entry->buffer, size);
+    copied = 1;
+  }
+  CACHE_UNLOCK(cache);
+
+  return copied;
+}
+
+
+
+PIDX_return_code PIDX_block_cache_insert(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, const unsigned char* buffer, uint64_t size)
+{
+  // not worth evicting the whole cache for an entry that can not fit anyway
+  if (size > cache->capacity)
+    return PIDX_success;
+
+  uint64_t hash = hash_key(file_name, variable_index, time_step, block_number);
+
+  CACHE_LOCK(cache);
+
+  // replace an existing entry with the same key
+  PIDX_block_cache_entry entry = cache->bucket[hash % cache->bucket_count];
+  while (entry != NULL)
+  {
+    if (entry->hash == hash && entry->variable_index == variable_index && entry->time_step == time_step && entry->block_number == block_number && strcmp(entry->file_name, file_name) == 0)
+    {
+      evict_entry(cache, entry);
+      break;
+    }
+    entry = entry->hash_next;
+  }
+
+  while (cache->size + size > cache->capacity && cache->lru_tail != NULL)
+    evict_entry(cache, cache->lru_tail);
+
+  entry = malloc(sizeof (*entry));
+  memset(entry, 0, sizeof (*entry));
+
+  entry->file_name = malloc(strlen(file_name) + 1);
+  strcpy(entry->file_name, file_name);
+  entry->variable_index = variable_index;
+  entry->time_step = time_step;
+  entry->block_number = block_number;
+  entry->hash = hash;
+
+  entry->buffer = malloc(size + 1);
+  if (entry->buffer == NULL)
+  {
+    fprintf(stderr, "[%s] [%d] malloc() failed.\n", __FILE__, __LINE__);
+    free(entry->file_name);
+    free(entry);
+    CACHE_UNLOCK(cache);
+    return PIDX_err_file;
+  }
+  memcpy(entry->buffer, buffer, size);
+  entry->size = size;
+
+  entry->hash_next = cache->bucket[hash % cache->bucket_count];
+  cache->bucket[hash % cache->bucket_count] = entry;
+  lru_push_front(cache, entry);
+  cache->size = cache->size + size;
+
+  CACHE_UNLOCK(cache);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_block_cache_read_header(PIDX_block_cache cache, const char* file_name, int time_step, int blocks_per_file, int variable_count, MPI_File* fp, int* is_open, uint64_t* block_table)
+{
+  uint64_t table_size = 2 * (uint64_t)blocks_per_file * variable_count * sizeof(*block_table);
+
+  if (cache != NULL && PIDX_block_cache_copy(cache, file_name, -1, time_step, -1, (unsigned char*)block_table, table_size) == 1)
+    return PIDX_success;
+
+  if (open_on_miss(file_name, fp, is_open) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  MPI_Status status;
+  int total_header_size = (10 + (10 * blocks_per_file)) * sizeof (uint32_t) * variable_count;
+  uint32_t *headers = malloc(total_header_size);
+  memset(headers, 0, total_header_size);
+
+  if (MPI_File_read_at(*fp, 0, headers, total_header_size , MPI_BYTE, &status) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_read_at() failed for filename %s.\n", __FILE__, __LINE__, file_name);
+    free(headers);
+    return PIDX_err_io;
+  }
+
+  int read_count = 0;
+  MPI_Get_count(&status, MPI_BYTE, &read_count);
+  if (read_count != total_header_size)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_read_at() failed. %d != %d\n", __FILE__, __LINE__, read_count, total_header_size);
+    free(headers);
+    return PIDX_err_io;
+  }
+
+  // decode the (offset, size) pair of every block of every variable
+  for (uint64_t i = 0; i < (uint64_t)blocks_per_file * variable_count; i++)
+  {
+    block_table[2 * i] = htonl(headers[12 + i * 10]);
+    block_table[2 * i + 1] = htonl(headers[14 + i * 10]);
+  }
+  free(headers);
+
+  if (cache != NULL)
+    return PIDX_block_cache_insert(cache, file_name, -1, time_step, -1, (unsigned char*)block_table, table_size);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_block_cache_read_block(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, uint64_t data_offset, uint64_t data_size, MPI_File* fp, int* is_open, unsigned char* block_buffer)
+{
+  if (cache != NULL && PIDX_block_cache_copy(cache, file_name, variable_index, time_step, block_number, block_buffer, data_size) == 1)
+    return PIDX_success;
+
+  if (open_on_miss(file_name, fp, is_open) != PIDX_success)
+  {
+    fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+    return PIDX_err_io;
+  }
+
+  MPI_Status status;
+  if (MPI_File_read_at(*fp, data_offset, block_buffer, data_size, MPI_BYTE, &status) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "Data offset = %lld [%s] [%d] MPI_File_read_at() failed for filename %s.\n", (long long) data_offset, __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+
+  if (cache != NULL)
+    return PIDX_block_cache_insert(cache, file_name, variable_index, time_step, block_number, block_buffer, data_size);
+
+  return PIDX_success;
+}
+
+
+
+// callers hold the lock
+static PIDX_block_cache_entry lookup(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number)
+{
+  uint64_t hash = hash_key(file_name, variable_index, time_step, block_number);
+
+  PIDX_block_cache_entry entry = cache->bucket[hash % cache->bucket_count];
+  while (entry != NULL)
+  {
+    if (entry->hash == hash && entry->variable_index == variable_index && entry->time_step == time_step && entry->block_number == block_number && strcmp(entry->file_name, file_name) == 0)
+    {
+      // mark as most recently used
+      lru_unlink(cache, entry);
+      lru_push_front(cache, entry);
+
+      cache->hit_count++;
+      return entry;
+    }
+    entry = entry->hash_next;
+  }
+
+  cache->miss_count++;
+  return NULL;
+}
+
+
+
+static PIDX_return_code open_on_miss(const char* file_name, MPI_File* fp, int* is_open)
+{
+  if (*is_open == 1)
+    return PIDX_success;
+
+  if (MPI_File_open(MPI_COMM_SELF, (char*)file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, fp) != MPI_SUCCESS)
+  {
+    fprintf(stderr, "[%s] [%d] MPI_File_open() filename %s failed.\n", __FILE__, __LINE__, file_name);
+    return PIDX_err_io;
+  }
+  *is_open = 1;
+
+  return PIDX_success;
+}
+
+
+
+// FNV-1a over the file name, followed by the integer parts of the key
+static uint64_t hash_key(const char* file_name, int variable_index, int time_step, int64_t block_number)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char* c = (const unsigned char*)file_name; *c != 0; c++)
+  {
+    hash = hash ^ *c;
+    hash = hash * 1099511628211ULL;
+  }
+
+  hash = (hash ^ (uint64_t)(int64_t)variable_index) * 1099511628211ULL;
+  hash = (hash ^ (uint64_t)(int64_t)time_step) * 1099511628211ULL;
+  hash = (hash ^ (uint64_t)block_number) * 1099511628211ULL;
+
+  return hash;
+}
+
+
+
+static void lru_unlink(PIDX_block_cache cache, PIDX_block_cache_entry entry)
+{
+  if (entry->lru_prev != NULL)
+    entry->lru_prev->lru_next = entry->lru_next;
+  else
+    cache->lru_head = entry->lru_next;
+
+  if (entry->lru_next != NULL)
+    entry->lru_next->lru_prev = entry->lru_prev;
+  else
+    cache->lru_tail = entry->lru_prev;
+
+  entry->lru_prev = NULL;
+  entry->lru_next = NULL;
+
+  return;
+}
+
+
+
+static void lru_push_front(PIDX_block_cache cache, PIDX_block_cache_entry entry)
+{
+  entry->lru_prev = NULL;
+  entry->lru_next = cache->lru_head;
+
+  if (cache->lru_head != NULL)
+    cache->lru_head->lru_prev = entry;
+  cache->lru_head = entry;
+
+  if (cache->lru_tail == NULL)
+    cache->lru_tail = entry;
+
+  return;
+}
+
+
+
+static void evict_entry(PIDX_block_cache cache, PIDX_block_cache_entry entry)
+{
+  // remove from the hash chain
+  PIDX_block_cache_entry* link = &cache->bucket[entry->hash % cache->bucket_count];
+  while (*link != NULL && *link != entry)
+    link = &((*link)->hash_next);
+  if (*link == entry)
+    *link = entry->hash_next;
+
+  lru_unlink(cache, entry);
+
+  cache->size = cache->size - entry->size;
+
+  free(entry->buffer);
+  free(entry->file_name);
+  free(entry);
+
+  return;
+}
@@ -0,0 +1,210 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+ /**
+ * \file PIDX_block_cache.h
+ *
+ * In-process LRU cache of idx blocks and decoded binary file headers,
+ * bounded by a byte budget. Entries are keyed by (binary file, variable,
+ * time step, block). A cache can be shared by several file handles and
+ * outlive them, so repeated queries on the same dataset are served from
+ * memory. Lookups and inserts are serialized by a mutex so the cache can be
+ * filled by the time step prefetch threads while the flush reads from it.
+ *
+ */
+
+#ifndef __PIDX_BLOCK_CACHE_H
+#define __PIDX_BLOCK_CACHE_H
+
+
+struct PIDX_block_cache_entry_struct
+{
+  char* file_name;                                      /// binary file the entry was read from
+  int variable_index;                                   /// variable index (-1 for a file header)
+  int time_step;                                        /// time step of the binary file
+  int64_t block_number;                                 /// global block number (-1 for a file header)
+  uint64_t hash;                                        /// hash of the key
+
+  unsigned char* buffer;                                /// cached bytes
+  uint64_t size;                                        /// size of buffer in bytes
+
+  struct PIDX_block_cache_entry_struct* hash_next;      /// next entry in the same hash bucket
+  struct PIDX_block_cache_entry_struct* lru_prev;       /// more recently used entry
+  struct PIDX_block_cache_entry_struct* lru_next;       /// less recently used entry
+};
+typedef struct PIDX_block_cache_entry_struct* PIDX_block_cache_entry;
+
+
+struct PIDX_block_cache_struct
+{
+  uint64_t capacity;                                    /// byte budget of the cache
+  uint64_t size;                                        /// bytes currently held by the cache
+  uint64_t hit_count;                                   /// number of lookups served from memory
+  uint64_t miss_count;                                  /// number of lookups that went to the file system
+
+  int bucket_count;                                     /// number of hash buckets
+  PIDX_block_cache_entry* bucket;                       /// hash buckets (chained)
+
+  PIDX_block_cache_entry lru_head;                      /// most recently used entry
+  PIDX_block_cache_entry lru_tail;                      /// least recently used entry (evicted first)
+
+#if PIDX_HAVE_PTHREADS
+  pthread_mutex_t lock;                                 /// serializes access with the prefetch threads
+#endif
+};
+typedef struct PIDX_block_cache_struct* PIDX_block_cache;
+
+
+///
+/// \brief PIDX_create_block_cache Creates an empty block cache
+/// \param capacity Maximum number of bytes held by the cache
+/// \param cache
+/// \return
+///
+PIDX_return_code PIDX_create_block_cache(uint64_t capacity, PIDX_block_cache* cache);
+
+
+///
+/// \brief PIDX_set_block_cache_capacity Changes the byte budget, evicting entries if needed
+/// \param cache
+/// \param capacity
+/// \return
+///
+PIDX_return_code PIDX_set_block_cache_capacity(PIDX_block_cache cache, uint64_t capacity);
+
+
+///
+/// \brief PIDX_free_block_cache Frees all the entries and the cache itself
+/// \param cache
+/// \return
+///
+PIDX_return_code PIDX_free_block_cache(PIDX_block_cache cache);
+
+
+///
+/// \brief PIDX_block_cache_contains Looks up an entry and marks it as most recently used.
+/// The cached bytes are only handed out by PIDX_block_cache_copy, which copies them under the lock.
+/// \param cache
+/// \param file_name
+/// \param variable_index
+/// \param time_step
+/// \param block_number
+/// \param size Size of the entry in bytes (when found, can be NULL)
+/// \return 1 if the entry is cached, 0 otherwise
+///
+int PIDX_block_cache_contains(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, uint64_t* size);
+
+
+///
+/// \brief PIDX_block_cache_drop_dataset Evicts the headers and blocks of every binary file of a dataset,
+/// so that a dataset that is written again is not served stale data
+/// \param cache
+/// \param idx_file_name .idx file of the dataset
+/// \return
+///
+PIDX_return_code PIDX_block_cache_drop_dataset(PIDX_block_cache cache, const char* idx_file_name);
+
+
+///
+/// \brief PIDX_block_cache_copy Copies the first size bytes of an entry into buffer, a cached
+/// block also serves reads of its prefix (coarse precision reads)
+/// \param cache
+/// \param file_name
+/// \param variable_index
+/// \param time_step
+/// \param block_number
+/// \param buffer
+/// \param size
+/// \return 1 if an entry of at least size bytes was found and copied, 0 otherwise
+///
+int PIDX_block_cache_copy(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, unsigned char* buffer, uint64_t size);
+
+
+///
+/// \brief PIDX_block_cache_insert Copies buffer into the cache, evicting least recently used entries
+/// to stay within the byte budget. Entries larger than the budget are not cached.
+/// \param cache
+/// \param file_name
+/// \param variable_index
+/// \param time_step
+/// \param block_number
+/// \param buffer
+/// \param size
+/// \return
+///
+PIDX_return_code PIDX_block_cache_insert(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, const unsigned char* buffer, uint64_t size);
+
+
+///
+/// \brief PIDX_block_cache_read_header Fills block_table with the decoded (offset, size) pair of
+/// every (variable, block) of a binary file, from the cache if possible.
+/// The file is opened (and *is_open set) only on a cache miss. cache can be NULL.
+/// \param cache
+/// \param file_name
+/// \param time_step
+/// \param blocks_per_file
+/// \param variable_count
+/// \param fp
+/// \param is_open
+/// \param block_table 2 * blocks_per_file * variable_count entries, pair of (block + blocks_per_file * variable)
+/// \return
+///
+PIDX_return_code PIDX_block_cache_read_header(PIDX_block_cache cache, const char* file_name, int time_step, int blocks_per_file, int variable_count, MPI_File* fp, int* is_open, uint64_t* block_table);
+
+
+///
+/// \brief PIDX_block_cache_read_block Reads data_size bytes of a block at data_offset, from the cache if possible.
+/// The file is opened (and *is_open set) only on a cache miss. cache can be NULL.
+/// \param cache
+/// \param file_name
+/// \param variable_index
+/// \param time_step
+/// \param block_number
+/// \param data_offset
+/// \param data_size
+/// \param fp
+/// \param is_open
+/// \param block_buffer
+/// \return
+///
+PIDX_return_code PIDX_block_cache_read_block(PIDX_block_cache cache, const char* file_name, int variable_index, int time_step, int64_t block_number, uint64_t data_offset, uint64_t data_size, MPI_File* fp, int* is_open, unsigned char* block_buffer);
+
+#endif
@@ -61,6 +61,8 @@ PIDX_return_code PIDX_free_metadata_cache(PIDX_metadata_cache cache)
       free(cache->xyz_mapped_index);
   }
 
+  PIDX_idx_rst_free_plans(cache->rst_plan);
+
   free(cache);
   return PIDX_success;
 }
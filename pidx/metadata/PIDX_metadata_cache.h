@@ -59,6 +59,8 @@ struct PIDX_metadata_cache_struct
   int *xyz_mapped_index;    /// The xyz index (application row-order index)
   int *hz_level;            /// Corresponding HZ index to the xyz index
   int *index_level;         /// The hz index level
+
+  struct PIDX_idx_rst_plan_struct* rst_plan;  /// restructuring plans of previous time steps
 };
 typedef struct PIDX_metadata_cache_struct* PIDX_metadata_cache;
 
@@ -47,6 +47,8 @@ PIDX_return_code PIDX_metadata_parse_v6_0(FILE *fp, PIDX_file* file)
   char *pch, *pch1;
   char line [ 512 ];
 
+  (*file)->idx->chunk_component_planes = 1;
+
   while (fgets(line, sizeof (line), fp) != NULL)
   {
     line[strcspn(line, "\r\n")] = 0;
@@ -206,6 +208,9 @@ PIDX_return_code PIDX_metadata_parse_v6_0(FILE *fp, PIDX_file* file)
 
       while (line[0] != '(')
       {
+        if (PIDX_variable_table_reserve((*file)->idx, variable_counter + 1) != PIDX_success)
+          return PIDX_err_file;
+
         (*file)->idx->variable[variable_counter] = malloc(sizeof (*((*file)->idx->variable[variable_counter])));
         if ((*file)->idx->variable[variable_counter] == NULL)
           return PIDX_err_file;
@@ -237,6 +242,29 @@ PIDX_return_code PIDX_metadata_parse_v6_0(FILE *fp, PIDX_file* file)
             (*file)->idx->variable[variable_counter]->bpv = bits_per_sample;
             (*file)->idx->variable[variable_counter]->vps = 1;
           }
+
+          // compression settings of the variable, see PIDX_set_variable_compression_type
+          if (count >= 2 && strncmp(pch1, "pidx_compression(", 17) == 0)
+          {
+            PIDX_variable var = (*file)->idx->variable[variable_counter];
+            double value = 0;
+            if (sscanf(pch1, "pidx_compression(%d,%d,%lf)", &var->compression_type, &var->compression_mode, &value) != 3)
+              return PIDX_err_file;
+
+            if (!PIDX_compression_variable_codec(var->compression_type))
+            {
+              fprintf(stderr, "Unsupported compression type %d of variable %s\n", var->compression_type, var->var_name);
+              return PIDX_err_file;
+            }
+
+            var->compression_override = 1;
+            if (var->compression_mode == PIDX_ZFP_FIXED_ACCURACY)
+              var->compression_tolerance = value;
+            else if (var->compression_mode == PIDX_ZFP_FIXED_PRECISION)
+              var->compression_precision = (int)value;
+            else
+              var->compression_bit_rate = (float)value;
+          }
           count++;
           pch1 = strtok(NULL, " +");
         }
@@ -273,7 +301,7 @@ PIDX_return_code PIDX_metadata_parse_v6_0(FILE *fp, PIDX_file* file)
         return PIDX_err_file;
       line[strcspn(line, "\r\n")] = 0;
       (*file)->idx->compression_type = atoi(line);
-      if ((*file)->idx->compression_type != PIDX_NO_COMPRESSION)
+      if ((*file)->idx->compression_type != PIDX_NO_COMPRESSION && (*file)->idx->compression_type != PIDX_ZFP_BLOCK && (*file)->idx->compression_type != PIDX_LOSSLESS_BLOCK && (*file)->idx->compression_type != PIDX_PRECISION_BLOCK)
       {
         int i1 = 0;
         for (i1 = 0; i1 < PIDX_MAX_DIMENSIONS; i1++)
@@ -308,6 +336,30 @@ PIDX_return_code PIDX_metadata_parse_v6_0(FILE *fp, PIDX_file* file)
       (*file)->idx->compression_bit_rate = atof(line);
     }
 
+    if (strcmp(line, "(compression mode)") == 0)
+    {
+      if (fgets(line, sizeof line, fp) == NULL)
+        return PIDX_err_file;
+      line[strcspn(line, "\r\n")] = 0;
+      (*file)->idx->compression_mode = atoi(line);
+    }
+
+    if (strcmp(line, "(compression tolerance)") == 0)
+    {
+      if (fgets(line, sizeof line, fp) == NULL)
+        return PIDX_err_file;
+      line[strcspn(line, "\r\n")] = 0;
+      (*file)->idx->compression_tolerance = atof(line);
+    }
+
+    if (strcmp(line, "(compression precision)") == 0)
+    {
+      if (fgets(line, sizeof line, fp) == NULL)
+        return PIDX_err_file;
+      line[strcspn(line, "\r\n")] = 0;
+      (*file)->idx->compression_precision = atoi(line);
+    }
+
     if (strcmp(line, "(blocksperfile)") == 0)
     {
       if ( fgets(line, sizeof line, fp) == NULL)
@@ -0,0 +1,383 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+#include "../PIDX_inc.h"
+
+#if PIDX_HAVE_PTHREADS
+struct PIDX_prefetch_thread_arg_struct
+{
+  PIDX_time_step_prefetch prefetch;
+  int thread_id;
+};
+
+static void* prefetch_thread(void* arg);
+static void prefetch_file(PIDX_time_step_prefetch prefetch, int file_group);
+static int read_fully(int fd, unsigned char* buffer, uint64_t size, uint64_t offset);
+static int compare_prefetch_block(const void* a, const void* b);
+#endif
+static void prefetch_wait(PIDX_time_step_prefetch prefetch);
+
+
+PIDX_return_code PIDX_create_time_step_prefetch(int thread_count, PIDX_time_step_prefetch* prefetch)
+{
+  if (thread_count < 1)
+    return PIDX_err_file;
+
+  *prefetch = malloc(sizeof (*(*prefetch)));
+  memset(*prefetch, 0, sizeof (*(*prefetch)));
+
+  (*prefetch)->thread_count = thread_count;
+  (*prefetch)->plan_time_step = -1;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_free_time_step_prefetch(PIDX_time_step_prefetch prefetch)
+{
+  if (!prefetch)
+    return PIDX_err_file;
+
+  prefetch_wait(prefetch);
+
+  free(prefetch->block);
+  free(prefetch->partition);
+  free(prefetch);
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_time_step_prefetch_begin(PIDX_time_step_prefetch prefetch, int time_step)
+{
+  // the blocks of this time step are either in the cache or being read, waiting is cheaper than reading twice
+  prefetch_wait(prefetch);
+
+  if (time_step == prefetch->plan_time_step)
+    return PIDX_success;
+
+  // a stride is trusted only after two equal consecutive deltas
+  if (prefetch->plan_time_step != -1)
+  {
+    int delta = time_step - prefetch->plan_time_step;
+    prefetch->stride = (delta == prefetch->delta) ? delta : 0;
+    prefetch->delta = delta;
+  }
+
+  prefetch->plan_time_step = time_step;
+  prefetch->block_count = 0;
+  prefetch->partition_count = 0;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_time_step_prefetch_record(PIDX_time_step_prefetch prefetch, idx_dataset idx, int file_number, int variable_index, int block_number)
+{
+  // a flush can read from several partitions, every one is replayed with its own layout
+  int partition = 0;
+  while (partition < prefetch->partition_count && strcmp(prefetch->partition[partition].filename, idx->filename_partition) != 0)
+    partition++;
+
+  if (partition == prefetch->partition_count)
+  {
+    if (prefetch->partition_count == prefetch->partition_capacity)
+    {
+      int capacity = (prefetch->partition_capacity == 0) ? 4 : 2 * prefetch->partition_capacity;
+      PIDX_prefetch_partition* partition_array = realloc(prefetch->partition, capacity * sizeof(*partition_array));
+      if (partition_array == NULL)
+      {
+        fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+        return PIDX_err_file;
+      }
+      prefetch->partition = partition_array;
+      prefetch->partition_capacity = capacity;
+    }
+
+    PIDX_prefetch_partition* p = &prefetch->partition[partition];
+    memset(p, 0, sizeof(*p));
+    strncpy(p->filename, idx->filename_partition, PIDX_FILE_PATH_LENGTH - 1);
+    p->maxh = idx->maxh;
+    p->bits_per_block = idx->bits_per_block;
+    p->blocks_per_file = idx->blocks_per_file;
+    prefetch->partition_count++;
+  }
+
+  if (prefetch->block_count == prefetch->block_capacity)
+  {
+    int capacity = (prefetch->block_capacity == 0) ? 64 : 2 * prefetch->block_capacity;
+    PIDX_prefetch_block* block = realloc(prefetch->block, capacity * sizeof(*block));
+    if (block == NULL)
+    {
+      fprintf(stderr,"File %s Line %d\n", __FILE__, __LINE__);
+      return PIDX_err_file;
+    }
+    prefetch->block = block;
+    prefetch->block_capacity = capacity;
+  }
+
+  prefetch->block[prefetch->block_count].partition = partition;
+  prefetch->block[prefetch->block_count].file_number = file_number;
+  prefetch->block[prefetch->block_count].variable_index = variable_index;
+  prefetch->block[prefetch->block_count].block_number = block_number;
+  prefetch->block_count++;
+
+  return PIDX_success;
+}
+
+
+
+PIDX_return_code PIDX_time_step_prefetch_launch(PIDX_time_step_prefetch prefetch, idx_dataset idx, PIDX_block_cache cache)
+{
+#if PIDX_HAVE_PTHREADS
+  if (prefetch->stride == 0 || prefetch->block_count == 0 || cache == NULL)
+    return PIDX_success;
+
+  int time_step = prefetch->plan_time_step + prefetch->stride;
+  if (time_step < 0)
+    return PIDX_success;
+
+  prefetch->cache = cache;
+  prefetch->time_step = time_step;
+  prefetch->variable_count = idx->variable_count;
+  for (int p = 0; p < prefetch->partition_count; p++)
+    generate_file_name_template(prefetch->partition[p].maxh, prefetch->partition[p].bits_per_block, prefetch->partition[p].filename, idx->filename_time_template, time_step, prefetch->partition[p].filename_template);
+
+  // group the recorded blocks by partition and file, every file is read by one thread
+  qsort(prefetch->block, prefetch->block_count, sizeof(*prefetch->block), compare_prefetch_block);
+
+  prefetch->file_group_offset = malloc((prefetch->block_count + 1) * sizeof(*prefetch->file_group_offset));
+  prefetch->file_group_count = 0;
+  for (int i = 0; i < prefetch->block_count; i++)
+  {
+    if (i == 0 || prefetch->block[i].partition != prefetch->block[i - 1].partition || prefetch->block[i].file_number != prefetch->block[i - 1].file_number)
+    {
+      prefetch->file_group_offset[prefetch->file_group_count] = i;
+      prefetch->file_group_count++;
+    }
+  }
+  prefetch->file_group_offset[prefetch->file_group_count] = prefetch->block_count;
+
+  int thread_count = PIDX_MIN(prefetch->thread_count, prefetch->file_group_count);
+  prefetch->thread = malloc(thread_count * sizeof(*prefetch->thread));
+  prefetch->thread_arg = malloc(thread_count * sizeof(*prefetch->thread_arg));
+  prefetch->running = thread_count;
+
+  for (int t = 0; t < thread_count; t++)
+  {
+    prefetch->thread_arg[t].prefetch = prefetch;
+    prefetch->thread_arg[t].thread_id = t;
+    if (pthread_create(&prefetch->thread[t], NULL, prefetch_thread, &prefetch->thread_arg[t]) != 0)
+    {
+      // no thread left, the remaining files are simply not prefetched
+      fprintf(stderr, "[%s] [%d] pthread_create() failed.\n", __FILE__, __LINE__);
+      prefetch->running = t;
+      break;
+    }
+  }
+#endif
+
+  return PIDX_success;
+}
+
+
+
+static void prefetch_wait(PIDX_time_step_prefetch prefetch)
+{
+#if PIDX_HAVE_PTHREADS
+  if (prefetch->thread == NULL)
+    return;
+
+  for (int t = 0; t < prefetch->running; t++)
+    pthread_join(prefetch->thread[t], NULL);
+
+  free(prefetch->thread);
+  prefetch->thread = NULL;
+  free(prefetch->thread_arg);
+  prefetch->thread_arg = NULL;
+  free(prefetch->file_group_offset);
+  prefetch->file_group_offset = NULL;
+  prefetch->file_group_count = 0;
+  prefetch->running = 0;
+#endif
+
+  return;
+}
+
+
+
+#if PIDX_HAVE_PTHREADS
+static void* prefetch_thread(void* arg)
+{
+  struct PIDX_prefetch_thread_arg_struct* thread_arg = arg;
+  PIDX_time_step_prefetch prefetch = thread_arg->prefetch;
+
+  // files are dealt round robin, the stride is the number of started threads
+  int thread_count = PIDX_MIN(prefetch->thread_count, prefetch->file_group_count);
+  for (int g = thread_arg->thread_id; g < prefetch->file_group_count; g = g + thread_count)
+    prefetch_file(prefetch, g);
+
+  return NULL;
+}
+
+
+
+// reads the header and the recorded blocks of one binary file of the next time step into the cache.
+// Failures are silent: the next flush reads whatever is missing from the file system.
+static void prefetch_file(PIDX_time_step_prefetch prefetch, int file_group)
+{
+  char file_name[PATH_MAX];
+  PIDX_prefetch_block* first = &prefetch->block[prefetch->file_group_offset[file_group]];
+  int block_count = prefetch->file_group_offset[file_group + 1] - prefetch->file_group_offset[file_group];
+  int blocks_per_file = prefetch->partition[first->partition].blocks_per_file;
+
+  if (generate_file_name(blocks_per_file, prefetch->partition[first->partition].filename_template, first->file_number, file_name, PATH_MAX) == 1)
+    return;
+
+  // the series may simply end here
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0)
+    return;
+
+  uint64_t table_count = 2 * (uint64_t)blocks_per_file * prefetch->variable_count;
+  uint64_t* block_table = malloc(table_count * sizeof(*block_table));
+  if (PIDX_block_cache_copy(prefetch->cache, file_name, -1, prefetch->time_step, -1, (unsigned char*)block_table, table_count * sizeof(*block_table)) == 0)
+  {
+    uint64_t total_header_size = (10 + (10 * (uint64_t)blocks_per_file)) * sizeof (uint32_t) * prefetch->variable_count;
+    uint32_t* headers = malloc(total_header_size);
+    if (read_fully(fd, (unsigned char*)headers, total_header_size, 0) != 0)
+    {
+      free(headers);
+      free(block_table);
+      close(fd);
+      return;
+    }
+
+    for (uint64_t i = 0; i < (uint64_t)blocks_per_file * prefetch->variable_count; i++)
+    {
+      block_table[2 * i] = htonl(headers[12 + i * 10]);
+      block_table[2 * i + 1] = htonl(headers[14 + i * 10]);
+    }
+    free(headers);
+
+    PIDX_block_cache_insert(prefetch->cache, file_name, -1, prefetch->time_step, -1, (unsigned char*)block_table, table_count * sizeof(*block_table));
+  }
+
+  unsigned char* block_buffer = NULL;
+  uint64_t block_buffer_size = 0;
+  for (int b = 0; b < block_count; b++)
+  {
+    // the same block can be recorded by several flushes of one time step
+    if (b > 0 && first[b].variable_index == first[b - 1].variable_index && first[b].block_number == first[b - 1].block_number)
+      continue;
+
+    uint64_t entry = first[b].block_number + (uint64_t)blocks_per_file * first[b].variable_index;
+    uint64_t data_offset = block_table[2 * entry];
+    uint64_t data_size = block_table[2 * entry + 1];
+    if (data_size == 0)
+      continue;
+
+    int64_t block_number = (int64_t)first[b].file_number * blocks_per_file + first[b].block_number;
+    if (PIDX_block_cache_contains(prefetch->cache, file_name, first[b].variable_index, prefetch->time_step, block_number, NULL) == 1)
+      continue;
+
+    if (data_size > block_buffer_size)
+    {
+      free(block_buffer);
+      block_buffer = malloc(data_size);
+      block_buffer_size = data_size;
+    }
+
+    if (read_fully(fd, block_buffer, data_size, data_offset) != 0)
+      break;
+
+    PIDX_block_cache_insert(prefetch->cache, file_name, first[b].variable_index, prefetch->time_step, block_number, block_buffer, data_size);
+  }
+
+  free(block_buffer);
+  free(block_table);
+  close(fd);
+
+  return;
+}
+
+
+
+static int read_fully(int fd, unsigned char* buffer, uint64_t size, uint64_t offset)
+{
+  uint64_t done = 0;
+  while (done < size)
+  {
+    ssize_t count = pread(fd, buffer + done, size - done, offset + done);
+    if (count <= 0)
+    {
+      if (count < 0 && errno == EINTR)
+        continue;
+      return 1;
+    }
+    done = done + count;
+  }
+
+  return 0;
+}
+
+
+
+static int compare_prefetch_block(const void* a, const void* b)
+{
+  const PIDX_prefetch_block* x = a;
+  const PIDX_prefetch_block* y = b;
+
+  if (x->partition != y->partition)
+    return (x->partition < y->partition) ? -1 : 1;
+  if (x->file_number != y->file_number)
+    return (x->file_number < y->file_number) ? -1 : 1;
+  if (x->variable_index != y->variable_index)
+    return (x->variable_index < y->variable_index) ? -1 : 1;
+  if (x->block_number != y->block_number)
+    return (x->block_number < y->block_number) ? -1 : 1;
+
+  return 0;
+}
+#endif
@@ -0,0 +1,158 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+ /**
+ * \file PIDX_time_step_prefetch.h
+ *
+ * Opt-in prefetcher for post-processing loops that read the same box at
+ * consecutive time steps. The blocks read during a time step are recorded;
+ * once a time step stride is detected, background I/O threads read the same
+ * blocks of the next time step into the block cache, so the following
+ * PIDX_flush is served from memory.
+ *
+ */
+
+#ifndef __PIDX_TIME_STEP_PREFETCH_H
+#define __PIDX_TIME_STEP_PREFETCH_H
+
+
+struct PIDX_prefetch_partition_struct
+{
+  char filename[PIDX_FILE_PATH_LENGTH];                 /// .idx file name of the dataset (or of the partition)
+  char filename_template[PIDX_FILE_PATH_LENGTH];        /// binary file template of the prefetched time step
+  int maxh;                                             /// partitions have their own bit string and block layout
+  int bits_per_block;
+  int blocks_per_file;
+};
+typedef struct PIDX_prefetch_partition_struct PIDX_prefetch_partition;
+
+
+struct PIDX_prefetch_block_struct
+{
+  int partition;                                        /// index in the partition array
+  int file_number;                                      /// binary file number
+  int variable_index;                                   /// variable index
+  int block_number;                                     /// block number within the binary file
+};
+typedef struct PIDX_prefetch_block_struct PIDX_prefetch_block;
+
+
+struct PIDX_time_step_prefetch_struct
+{
+  int thread_count;                                     /// number of background I/O threads
+  int delta;                                            /// difference between the last two time steps read
+  int stride;                                           /// detected time step stride (0 until two equal deltas are seen)
+  int plan_time_step;                                   /// time step the recorded blocks belong to (-1 before the first read)
+
+  // blocks read during plan_time_step, replayed at plan_time_step + stride
+  int block_count;
+  int block_capacity;
+  PIDX_prefetch_block* block;
+  int partition_count;                                  /// datasets (or partitions) the recorded blocks belong to
+  int partition_capacity;
+  PIDX_prefetch_partition* partition;
+
+  // state shared with the background threads while a prefetch is in flight
+  PIDX_block_cache cache;
+  int time_step;                                        /// prefetched time step
+  int variable_count;
+  int file_group_count;                                 /// number of distinct (partition, file) pairs in block
+  int* file_group_offset;                               /// first entry of every file in block (sorted by partition and file)
+  int running;                                          /// 1 while threads are in flight
+#if PIDX_HAVE_PTHREADS
+  pthread_t* thread;
+  struct PIDX_prefetch_thread_arg_struct* thread_arg;
+#endif
+};
+typedef struct PIDX_time_step_prefetch_struct* PIDX_time_step_prefetch;
+
+
+///
+/// \brief PIDX_create_time_step_prefetch Creates an idle prefetcher
+/// \param thread_count Number of background I/O threads (at least 1)
+/// \param prefetch
+/// \return
+///
+PIDX_return_code PIDX_create_time_step_prefetch(int thread_count, PIDX_time_step_prefetch* prefetch);
+
+
+///
+/// \brief PIDX_free_time_step_prefetch Waits for the in flight reads and frees the prefetcher
+/// \param prefetch
+/// \return
+///
+PIDX_return_code PIDX_free_time_step_prefetch(PIDX_time_step_prefetch prefetch);
+
+
+///
+/// \brief PIDX_time_step_prefetch_begin Called before a read flush. Waits for the in flight reads
+/// (their blocks are then in the cache), and starts a new plan when the time step changed,
+/// updating the detected stride.
+/// \param prefetch
+/// \param time_step
+/// \return
+///
+PIDX_return_code PIDX_time_step_prefetch_begin(PIDX_time_step_prefetch prefetch, int time_step);
+
+
+///
+/// \brief PIDX_time_step_prefetch_record Records a block read by the current flush
+/// \param prefetch
+/// \param idx Dataset (or partition) the block was read from
+/// \param file_number
+/// \param variable_index
+/// \param block_number Block number within the binary file
+/// \return
+///
+PIDX_return_code PIDX_time_step_prefetch_record(PIDX_time_step_prefetch prefetch, idx_dataset idx, int file_number, int variable_index, int block_number);
+
+
+///
+/// \brief PIDX_time_step_prefetch_launch Called after a read flush. When a stride is known,
+/// starts the background reads of the recorded blocks at the next time step.
+/// \param prefetch
+/// \param idx
+/// \param cache Block cache receiving the prefetched blocks
+/// \return
+///
+PIDX_return_code PIDX_time_step_prefetch_launch(PIDX_time_step_prefetch prefetch, idx_dataset idx, PIDX_block_cache cache);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+#include "../PIDX_inc.h"
+
+struct thread_pool_struct
+{
+  PIDX_thread_task task;
+  void* context;
+  uint64_t task_count;
+  uint64_t next_task;
+  PIDX_return_code ret;
+#if PIDX_HAVE_PTHREADS
+  pthread_mutex_t lock;
+#endif
+};
+
+#if PIDX_HAVE_PTHREADS
+static void* worker(void* arg);
+#endif
+
+
+PIDX_return_code PIDX_thread_pool_run(int thread_count, uint64_t task_count, PIDX_thread_task task, void* context)
+{
+  if (task_count == 0)
+    return PIDX_success;
+
+#if PIDX_HAVE_PTHREADS
+  if (thread_count > 1 && task_count > 1)
+  {
+    if ((uint64_t)thread_count > task_count)
+      thread_count = task_count;
+
+    struct thread_pool_struct pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.task = task;
+    pool.context = context;
+    pool.task_count = task_count;
+    pool.ret = PIDX_success;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    // the calling thread is the first worker
+    pthread_t* thread = malloc(sizeof(*thread) * thread_count);
+    int started = 0;
+    for (int t = 1; t < thread_count; t++)
+    {
+      if (pthread_create(&thread[t], NULL, worker, &pool) != 0)
+        break;
+      started++;
+    }
+
+    worker(&pool);
+
+    for (int t = 1; t <= started; t++)
+      pthread_join(thread[t], NULL);
+
+    free(thread);
+    pthread_mutex_destroy(&pool.lock);
+
+    return pool.ret;
+  }
+#endif
+
+  for (uint64_t i = 0; i < task_count; i++)
+  {
+    PIDX_return_code ret = task(context, i);
+    if (ret != PIDX_success)
+      return ret;
+  }
+
+  return PIDX_success;
+}
+
+
+
+int PIDX_get_core_count()
+{
+#if defined _MSC_VER
+  return 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count < 1) ? 1 : (int)count;
+#endif
+}
+
+
+
+#if PIDX_HAVE_PTHREADS
+static void* worker(void* arg)
+{
+  struct thread_pool_struct* pool = arg;
+
+  while (1)
+  {
+    // stop handing out tasks after the first failure
+    pthread_mutex_lock(&pool->lock);
+    uint64_t i = pool->next_task;
+    int failed = (pool->ret != PIDX_success);
+    pool->next_task++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (i >= pool->task_count || failed)
+      break;
+
+    PIDX_return_code ret = pool->task(pool->context, i);
+    if (ret != PIDX_success)
+    {
+      pthread_mutex_lock(&pool->lock);
+      if (pool->ret == PIDX_success)
+        pool->ret = ret;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+
+  return NULL;
+}
+#endif
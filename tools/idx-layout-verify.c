@@ -0,0 +1,353 @@
+/*
+ * BSD 3-Clause License
+ * 
+ * Copyright (c) 2010-2019 ViSUS L.L.C., 
+ * Scientific Computing and Imaging Institute of the University of Utah
+ * 
+ * ViSUS L.L.C., 50 W. Broadway, Ste. 300, 84101-2044 Salt Lake City, UT
+ * University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+ *  
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * For additional information about this project contact: pascucci@acm.org
+ * For support: support@visus.net
+ * 
+ */
+
+/*
+  Checks the analytic block layout of PIDX_blocks_create_layout against the
+  reference implementation that probes the first and last sample of every
+  block with Hz_to_xyz (the layout code up to PIDX 1.x).
+
+  For a set of bit strings (cubic, non-cubic and 2D), bits per block, level
+  ranges and boxes that do not fall on block boundaries, it compares
+  PIDX_blocks_is_block_present for every block and
+  PIDX_blocks_find_negative_offset for every block and a few blocks per file
+  (with and without the rank table) for 1, 8 and 64 blocks per file.
+
+  Usage: ./idx_layout_verify [-n boxes per configuration] [-s seed]
+*/
+
+#include <PIDX.h>
+#include <unistd.h>
+
+static const char* bit_strings[] = {
+  "V012012012012",         // 16x16x16
+  "V0120120120122",        // 16x16x32
+  "V0011220120",           // 8x8x8, unbalanced prefix
+  "V21012012012",          // 16x8x8 (z first)
+  "V000111222012",         // 16x16x16, grouped
+  "V0101010101010",        // 128x64 (2D)
+  "V01010101",             // 16x16 (2D)
+  "V1111000",              // 16x8 (2D, grouped)
+  "V00000000"              // 256 (1D)
+};
+
+// Block layout of the reference implementation, block numbers per level
+struct reference_layout_struct
+{
+  int resolution_from;
+  int resolution_to;
+  int maxh;
+  int bits_per_block;
+  int** hz_block_number_array;
+};
+typedef struct reference_layout_struct reference_layout;
+
+static void reference_initialize(reference_layout* layout, int resolution_from, int resolution_to, int maxh, int bits_per_block);
+static void reference_create(reference_layout* layout, int bounding_box[2][5], const char* bitPattern, int res_to);
+static int reference_is_block_present(reference_layout* layout, int block_number);
+static int reference_find_negative_offset(int* absent_before, int blocks_per_file, int block_number);
+static void reference_free(reference_layout* layout);
+static int verify_box(const char* bitPattern, int maxh, int bits_per_block, int resolution_from, int resolution_to, int res_to, int bounding_box[2][5]);
+static int random_int(int n);
+
+
+int main(int argc, char **argv)
+{
+  int box_count = 20;
+  unsigned int seed = 1;
+  int one_opt = 0;
+  while ((one_opt = getopt(argc, argv, "n:s:")) != EOF)
+  {
+    switch (one_opt)
+    {
+    case('n'):
+      box_count = atoi(optarg);
+      break;
+
+    case('s'):
+      seed = (unsigned int)atoi(optarg);
+      break;
+
+    default:
+      fprintf(stderr, "Usage: %s [-n boxes per configuration] [-s seed]\n", argv[0]);
+      return 1;
+    }
+  }
+  srand(seed);
+
+  int test_count = 0, failed_count = 0;
+  for (uint32_t s = 0; s < sizeof(bit_strings) / sizeof(bit_strings[0]); s++)
+  {
+    const char* bit_string = bit_strings[s];
+    int maxh = strlen(bit_string);
+
+    char bitPattern[512];
+    memset(bitPattern, 0, sizeof(bitPattern));
+    for (int i = 0; i <= maxh; i++)
+      bitPattern[i] = RegExBitmaskBit(bit_string, i);
+
+    // extent of the domain along every axis
+    int extent[PIDX_MAX_DIMENSIONS];
+    for (int d = 0; d < PIDX_MAX_DIMENSIONS; d++)
+      extent[d] = 1;
+    for (int i = 1; i < maxh; i++)
+      extent[(int)bitPattern[i]] = extent[(int)bitPattern[i]] * 2;
+
+    for (int bits_per_block = 0; bits_per_block <= maxh - 2; bits_per_block++)
+    {
+      for (int b = 0; b < box_count; b++)
+      {
+        int bounding_box[2][5] = {{0, 0, 0, 0, 0}, {1, 1, 1, 1, 1}};
+        for (int d = 0; d < 3; d++)
+        {
+          if (b == 0)
+          {
+            // the whole domain
+            bounding_box[0][d] = 0;
+            bounding_box[1][d] = extent[d];
+          }
+          else if (b == 1)
+          {
+            // a single sample
+            bounding_box[0][d] = random_int(extent[d]);
+            bounding_box[1][d] = bounding_box[0][d] + 1;
+          }
+          else
+          {
+            int lo = random_int(extent[d]);
+            int hi = random_int(extent[d]);
+            if (lo > hi)
+            {
+              int tmp = lo;
+              lo = hi;
+              hi = tmp;
+            }
+            bounding_box[0][d] = lo;
+            bounding_box[1][d] = hi + 1;
+          }
+        }
+
+        // full range, a range starting below and above bits_per_block, and a reduced resolution
+        int resolution_from[4] = {0, random_int(bits_per_block + 1), bits_per_block + 1 + random_int(maxh - bits_per_block - 1), 0};
+        int resolution_to[4] = {maxh, maxh, maxh, maxh};
+        int res_to[4] = {0, 0, 0, 1 + random_int(2)};
+        resolution_to[1] = resolution_from[1] + random_int(maxh - resolution_from[1] + 1);
+
+        for (int r = 0; r < 4; r++)
+        {
+          test_count++;
+          if (verify_box(bitPattern, maxh, bits_per_block, resolution_from[r], resolution_to[r], res_to[r], bounding_box) != 0)
+          {
+            failed_count++;
+            if (failed_count <= 10)
+              fprintf(stderr, "Layout mismatch: bits %s bits per block %d levels [%d %d) reduced %d box [%d %d %d] - [%d %d %d]\n", bit_string, bits_per_block, resolution_from[r], resolution_to[r], res_to[r], bounding_box[0][0], bounding_box[0][1], bounding_box[0][2], bounding_box[1][0], bounding_box[1][1], bounding_box[1][2]);
+          }
+        }
+      }
+    }
+  }
+
+  fprintf(stdout, "Correct Layout Count %d Incorrect Layout Count %d\n", test_count - failed_count, failed_count);
+
+  return (failed_count == 0) ? 0 : 1;
+}
+
+
+static int verify_box(const char* bitPattern, int maxh, int bits_per_block, int resolution_from, int resolution_to, int res_to, int bounding_box[2][5])
+{
+  int ret = 0;
+
+  struct PIDX_block_layout_struct layout;
+  memset(&layout, 0, sizeof(layout));
+  PIDX_blocks_initialize_layout(&layout, resolution_from, resolution_to, maxh, bits_per_block);
+  PIDX_blocks_create_layout(bounding_box, maxh, bits_per_block, bitPattern, &layout, res_to);
+
+  reference_layout reference;
+  reference_initialize(&reference, resolution_from, resolution_to, maxh, bits_per_block);
+  reference_create(&reference, bounding_box, bitPattern, res_to);
+
+  // absent_before[b] is the number of blocks missing from the reference layout in [0, b)
+  int block_count = 1 << (maxh - 1 - bits_per_block);
+  int* absent_before = malloc(sizeof(*absent_before) * (block_count + 1));
+  absent_before[0] = 0;
+  for (int b = 0; b < block_count; b++)
+  {
+    int present = reference_is_block_present(&reference, b);
+    if (PIDX_blocks_is_block_present(b, bits_per_block, &layout) != present)
+      ret = 1;
+    absent_before[b + 1] = absent_before[b] + (present ? 0 : 1);
+  }
+
+  // the negative offsets are checked by scanning the bitmap, then through the rank table
+  int blocks_per_file[3] = {1, 8, 64};
+  for (int with_rank = 0; with_rank < 2 && ret == 0; with_rank++)
+  {
+    if (with_rank == 1)
+      PIDX_blocks_build_rank(&layout);
+
+    for (int f = 0; f < 3 && ret == 0; f++)
+    {
+      for (int b = 0; b < block_count && ret == 0; b++)
+      {
+        if (PIDX_blocks_find_negative_offset(blocks_per_file[f], bits_per_block, b, &layout) != reference_find_negative_offset(absent_before, blocks_per_file[f], b))
+          ret = 1;
+      }
+    }
+  }
+
+  free(absent_before);
+  PIDX_blocks_free_layout(bits_per_block, maxh, &layout);
+  reference_free(&reference);
+
+  return ret;
+}
+
+
+static int random_int(int n)
+{
+  if (n <= 0)
+    return 0;
+
+  return rand() % n;
+}
+
+
+static void reference_initialize(reference_layout* layout, int resolution_from, int resolution_to, int maxh, int bits_per_block)
+{
+  int ctr = 1, j;
+
+  layout->resolution_from = resolution_from;
+  layout->resolution_to = resolution_to;
+  layout->maxh = maxh;
+  layout->bits_per_block = bits_per_block;
+
+  layout->hz_block_number_array = malloc(sizeof(int*) * maxh);
+  memset(layout->hz_block_number_array, 0, sizeof(int*) * maxh);
+
+  for (j = 0 ; j < PIDX_MIN(maxh, bits_per_block + 1) ; j++)
+  {
+    layout->hz_block_number_array[j] = malloc(sizeof(int));
+    memset(layout->hz_block_number_array[j], 0, sizeof(int));
+  }
+
+  ctr = 1;
+  for (j = bits_per_block + 1 ; j < maxh ; j++)
+  {
+    layout->hz_block_number_array[j] = malloc(sizeof(int) * ctr);
+    memset(layout->hz_block_number_array[j], 0, sizeof(int) * ctr);
+    ctr = ctr * 2;
+  }
+}
+
+
+// A block is in the layout when the box spanned by its first and last sample intersects bounding_box
+static void reference_create(reference_layout* layout, int bounding_box[2][5], const char* bitPattern, int res_to)
+{
+  int maxH = layout->maxh;
+  int bits_per_block = layout->bits_per_block;
+  int m = 0, n_blocks = 1, t = 0, block_number = 1;
+  uint64_t hz_from = 0, hz_to = 0;
+  uint64_t ZYX_from[PIDX_MAX_DIMENSIONS], ZYX_to[PIDX_MAX_DIMENSIONS];
+
+  int adjusted_res_to = layout->resolution_to;
+  if (layout->resolution_to > maxH - res_to)
+    adjusted_res_to = maxH - res_to;
+
+  for (m = bits_per_block + 1 ; m < adjusted_res_to; m++)
+  {
+    n_blocks = pow(2, (m - (bits_per_block + 1)));
+    if (m >= layout->resolution_from)
+    {
+      for (t = 0 ; t < n_blocks ; t++)
+      {
+        hz_from = (uint64_t)(block_number) * pow(2, bits_per_block);
+        hz_to = (uint64_t)((block_number + 1) * pow(2, bits_per_block)) - 1;
+
+        memset(ZYX_to, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+        memset(ZYX_from, 0, sizeof(uint64_t) * PIDX_MAX_DIMENSIONS);
+
+        Hz_to_xyz(bitPattern, maxH - 1, hz_from, ZYX_from);
+        Hz_to_xyz(bitPattern, maxH - 1, hz_to, ZYX_to);
+
+        if (ZYX_to[0] >= (uint64_t)bounding_box[0][0] && ZYX_from[0] < (uint64_t)bounding_box[1][0] && ZYX_to[1] >= (uint64_t)bounding_box[0][1] && ZYX_from[1] < (uint64_t)bounding_box[1][1] && ZYX_to[2] >= (uint64_t)bounding_box[0][2] && ZYX_from[2] < (uint64_t)bounding_box[1][2])
+          layout->hz_block_number_array[m][t] = block_number;
+
+        block_number++;
+      }
+    }
+    else
+      block_number = block_number + n_blocks;
+  }
+}
+
+
+static int reference_is_block_present(reference_layout* layout, int block_number)
+{
+  int res_level = 0, res_index = 0;
+
+  if (block_number == 0)
+    return (layout->resolution_from <= layout->bits_per_block) ? 1 : 0;
+
+  res_level = log2 (block_number) + 1 + layout->bits_per_block;
+  res_index = block_number % ((int) pow(2, (res_level - 1 - layout->bits_per_block)));
+
+  if (res_level < layout->resolution_from || res_level >= layout->resolution_to)
+    return 0;
+
+  return (layout->hz_block_number_array[res_level][res_index] == block_number) ? 1 : 0;
+}
+
+
+// Number of blocks missing from the layout between the first block of the file and block_number
+static int reference_find_negative_offset(int* absent_before, int blocks_per_file, int block_number)
+{
+  int file_no = block_number / blocks_per_file;
+
+  return absent_before[block_number] - absent_before[file_no * blocks_per_file];
+}
+
+
+static void reference_free(reference_layout* layout)
+{
+  for (int j = 0 ; j < layout->maxh ; j++)
+    free(layout->hz_block_number_array[j]);
+  free(layout->hz_block_number_array);
+  layout->hz_block_number_array = NULL;
+}
@@ -86,6 +86,28 @@ def verify_read(filename, count):
 
   return -1
 
+# Verify output file of the layout verify tool
+def verify_layout(filename):
+  file = open(filename, "r")
+
+  correct = 0
+  incorrect = -1
+
+  for line in file:
+    if 'Correct Layout Count' in line:
+      words = line.split()
+      correct = int(words[3])
+      incorrect = int(words[7])
+
+  file.close()
+
+  if correct > 0 and incorrect == 0:
+    return 0
+
+  print "Layout test FAILED: correct " + str(correct) + " incorrect " + str(incorrect)
+
+  return -1
+
 # Generate variables list
 def generate_vars(n_vars, *type):
   try:
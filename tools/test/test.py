@@ -58,6 +58,7 @@ if platform.system() == "Darwin":
   read_idx_executable = read_idx_executable+".app/Contents/MacOS/idx_read"
   write_compressed_executable = write_compressed_executable+".app/Contents/MacOS/idx_write_compressed"
   write_partitioned_executable = write_partitioned_executable+".app/Contents/MacOS/idx_write_partitioned"
+  layout_verify_executable = layout_verify_executable+".app/Contents/MacOS/idxlayoutverify"
 
 if not(os.path.isfile(write_idx_executable)):
   print "ERROR: write executable not found!", write_idx_executable
@@ -73,7 +74,7 @@ profile_file_read = "pidx_read.prof"
 
 vars_file = "./VARS"
 
-def execute_test(n_cores, n_cores_read, g_box_n, l_box_n, r_box_n, n_ts, n_vars, var_type, exec_type):
+def execute_test(n_cores, n_cores_read, g_box_n, l_box_n, r_box_n, n_ts, n_vars, var_type, exec_type, write_args, read_args):
 
   g_box = "%dx%dx%d" % (g_box_n[0], g_box_n[1], g_box_n[2])
   l_box = "%dx%dx%d" % (l_box_n[0], l_box_n[1], l_box_n[2])
@@ -118,7 +119,7 @@ def execute_test(n_cores, n_cores_read, g_box_n, l_box_n, r_box_n, n_ts, n_vars,
     n_tests = 0
 
     generate_vars(n_vars, var_type, var_type)
-    test_str = mpirun+" -np "+str(n_cores)+" "+write_executable+" -g "+g_box+" -l "+l_box+" -t "+str(n_ts)+" -v "+vars_file+" -f data"
+    test_str = mpirun+" -np "+str(n_cores)+" "+write_executable+" -g "+g_box+" -l "+l_box+" -t "+str(n_ts)+" -v "+vars_file+" -f data"+write_args
     #test_str = mpirun+" -np "+str(n_cores)+" "+write_executable+" -g "+g_box+" -l "+l_box+" -r "+r_box+" -t "+str(n_ts)+" -v "+vars_file+" -f data"
     
     if(debug_print>0):
@@ -136,7 +137,7 @@ def execute_test(n_cores, n_cores_read, g_box_n, l_box_n, r_box_n, n_ts, n_vars,
       for vr in range(0, n_vars):
         n_tests = n_tests + 1
 
-        test_str= mpirun+" -np "+str(n_cores_read)+" "+read_executable+" -g "+g_box+" -l "+l_box_read+" -t "+str(t-1)+" -v "+str(vr)+" -f data"
+        test_str= mpirun+" -np "+str(n_cores_read)+" "+read_executable+" -g "+g_box+" -l "+l_box_read+" -t "+str(t-1)+" -v "+str(vr)+" -f data"+read_args
 
         if(debug_print>0):
           print "EXECUTE read:", test_str
@@ -168,7 +169,7 @@ def execute_test(n_cores, n_cores_read, g_box_n, l_box_n, r_box_n, n_ts, n_vars,
 
   return n_tests - success
 
-def run_tests(n_cores, n_cores_read, var_type, n_vars, n_ts, exec_type):
+def run_tests(n_cores, n_cores_read, var_type, n_vars, n_ts, exec_type, write_args="", read_args=""):
   print "---RUN TESTS---"
   
   #even_factor = int(n_cores ** (1. / 3))
@@ -182,7 +183,7 @@ def run_tests(n_cores, n_cores_read, var_type, n_vars, n_ts, exec_type):
     r_box = l_box
     #print "r == l", r_box
     
-    succ = execute_test(n_cores, n_cores_read, g_box, l_box, r_box, n_ts, n_vars, var_type, exec_type)
+    succ = execute_test(n_cores, n_cores_read, g_box, l_box, r_box, n_ts, n_vars, var_type, exec_type, write_args, read_args)
 
   #r_box = (l_box[0]/2, l_box[1]/2, l_box[2]/2)
   #print "r < l", r_box
@@ -197,6 +198,26 @@ def run_tests(n_cores, n_cores_read, var_type, n_vars, n_ts, exec_type):
   
   return succ
 
+# Compare the block layouts against the Hz_to_xyz probing reference
+def run_layout_test():
+  print "---RUN LAYOUT TEST---"
+
+  if not(os.path.isfile(layout_verify_executable)):
+    print "WARNING: layout verify executable not found (build with PIDX_BUILD_TOOLS)", layout_verify_executable
+    return 0
+
+  test_str = layout_verify_executable
+
+  if(debug_print>0):
+    print "EXECUTE layout:", test_str
+
+  if(travis_mode > 0):
+    append_travis(test_str)
+    return 0
+
+  os.popen(test_str+" > _out_layout.txt 2>&1")
+  return verify_layout("_out_layout.txt")
+
 def print_usage():
   print 'test.py -w <wcores> -r <rcores> -p <profilefile> -m <mpirun>'
 
@@ -256,6 +277,12 @@ def main(argv):
   
   failed = 0
 
+  if(run_layout_test() == 0):
+    print "***** LAYOUT test SUCCESS *****"
+  else:
+    print "***** LAYOUT test FAILED *****"
+    failed = 1
+
   for var in var_types:
     succ = succ + run_tests(n_cores, n_cores_read, var, n_ts, n_vars, ExecType.idx)
     if(travis_mode == 0):
@@ -282,20 +309,59 @@ def main(argv):
   if(travis_mode == 0):
     os.popen("rm -R data*")
 
+  # same files, read back with PIDX_read_points
+  succ = 0
+  for var in var_types:
+    succ = succ + run_tests(n_cores, n_cores_read, var, n_ts, n_vars, ExecType.idx, read_args=" -q")
+    if(travis_mode == 0):
+      os.popen("rm -R data*")
+
+  if(succ == 0):
+    print "***** POINT_QUERY test SUCCESS *****"
+  else:
+    print "***** POINT_QUERY test FAILED *****"
+    failed = 1
+
+  # written by n_cores, read back by n_cores_read with the restart read
   succ = 0
+  for var in var_types:
+    succ = succ + run_tests(n_cores, n_cores_read, var, n_ts, n_vars, ExecType.idx, read_args=" -r")
+    if(travis_mode == 0):
+      os.popen("rm -R data*")
+
+  if(succ == 0):
+    print "***** RESTART_READ test SUCCESS *****"
+  else:
+    print "***** RESTART_READ test FAILED *****"
+    failed = 1
+
+  # same files, every reading process opens them with PIDX_serial_file_open and reads
+  # its box with 4 threads, twice, the second time from the block cache
+  succ = 0
+  for var in var_types:
+    succ = succ + run_tests(n_cores, n_cores_read, var, n_ts, n_vars, ExecType.idx, read_args=" -m 4")
+    if(travis_mode == 0):
+      os.popen("rm -R data*")
 
-  # TODO fix compression
-  # for compression we use only float32 and float64 types
-  # integer types are not supported yet
-  # for var in var_types_compression:
-  #   succ = run_tests(n_cores, n_cores_read, var, n_ts, n_vars, ExecType.compressed)
-  #   os.popen("rm -R data*")
-
-  # if(succ == 0):
-  #   print "***** IDX_COMPRESSED test SUCCESS *****"
-  # else:
-  #   print "***** IDX_COMPRESSED test FAILED *****"
-  #   failed = 1
+  if(succ == 0):
+    print "***** SERIAL_READ test SUCCESS *****"
+  else:
+    print "***** SERIAL_READ test FAILED *****"
+    failed = 1
+
+  # zfp only gets float32 and float64 types, integer types are not supported yet
+  for conf in compression_confs:
+    succ = 0
+    for var in conf[3]:
+      succ = succ + run_tests(n_cores, n_cores_read, var, conf[4], n_ts, ExecType.compressed, conf[1], conf[2])
+      if(travis_mode == 0):
+        os.popen("rm -R data*")
+
+    if(succ == 0):
+      print "***** IDX_COMPRESSED "+conf[0]+" test SUCCESS *****"
+    else:
+      print "***** IDX_COMPRESSED "+conf[0]+" test FAILED *****"
+      failed = 1
 
   #print "latest outputs:"
   #os.popen("cat _out_write.txt")
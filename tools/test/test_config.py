@@ -42,6 +42,7 @@ write_idx_executable = "../../build/examples/idx_write"
 read_idx_executable = "../../build/examples/idx_read"
 write_compressed_executable = "../../build/examples/idx_write_compressed"
 write_partitioned_executable = "../../build/examples/idx_write_partitioned"
+layout_verify_executable = "../../build/tools/idxlayoutverify"
 
 mpirun="mpirun"
 
@@ -61,6 +62,23 @@ var_types_compression = ["1*float32", "1*float64",
                          "2*float32", "2*float64", 
                          "3*float32", "3*float64"]
 
+# compressed tests: name, options of the compressed write (-c is the PIDX compression type, -m the one of
+# the odd variables), largest error accepted by the read, types written and number of variables.
+# -c 2 is PIDX_CHUNKING_ZFP, 3 PIDX_CHUNKING_ZFP_BLOCK, 4 PIDX_ZFP_BLOCK, 5 PIDX_LOSSLESS_BLOCK and 6 PIDX_PRECISION_BLOCK
+compression_confs = [("CHUNKING_ZFP", " -c 2", " -e 0.5", var_types_compression, 1),
+                     ("ZFP_ACCURACY", " -c 4 -a 0.5", " -e 0.5", var_types_compression, 1),
+                     ("ZFP_PRECISION", " -c 4 -p 64", " -e 0.5", var_types_compression, 1),
+                     ("ZFP_BLOCK", " -c 4", " -e 0.5", var_types_compression, 1),
+                     ("CHUNKING_ZFP_BLOCK", " -c 3", " -e 0.5", var_types_compression, 1),
+                     ("LOSSLESS_BLOCK", " -c 5", "", var_types, 1),
+                     ("PRECISION_BLOCK", " -c 6", "", var_types, 1),
+                     ("PRECISION_BLOCK_COARSE", " -c 6", " -s 3 -e 2048", ["1*float64", "2*float64", "3*float64"], 1),
+                     ("MIXED_BLOCK", " -c 5 -m 4 -n 32", " -e 0.5", var_types_compression, 2)]
+
+# PRECISION_BLOCK_COARSE reads 3 bytes of every float64, 12 bits of mantissa: the error stays below 2048 for the values
+# of the test grids (below 2^24)
+# MIXED_BLOCK stores the first variable lossless and the second one with ZFP at 32 bits per value
+
 
 vars_file = "VARS"
 